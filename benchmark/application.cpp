@@ -0,0 +1,329 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "application.h"
+
+namespace {
+
+    using namespace benchmark::application;
+    using namespace openxr_api_layer::utils::graphics;
+
+    // How many frames may be queued on the GPU before paceFrame() blocks.
+    constexpr uint32_t FramesInFlight = 2;
+
+    constexpr float ClearColor[] = {0.f, 0.f, 0.f, 1.f};
+
+    struct D3D11Application : IApplication {
+        D3D11Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel) {
+            CHECK_HRCMD(D3D11CreateDevice(adapter,
+                                          D3D_DRIVER_TYPE_UNKNOWN,
+                                          nullptr,
+                                          0,
+                                          &featureLevel,
+                                          1,
+                                          D3D11_SDK_VERSION,
+                                          m_device.ReleaseAndGetAddressOf(),
+                                          nullptr,
+                                          m_context.ReleaseAndGetAddressOf()));
+            m_graphicsBinding.device = m_device.Get();
+
+            D3D11_QUERY_DESC queryDesc{};
+            queryDesc.Query = D3D11_QUERY_EVENT;
+            for (ComPtr<ID3D11Query>& query : m_frameQueries) {
+                CHECK_HRCMD(m_device->CreateQuery(&queryDesc, query.ReleaseAndGetAddressOf()));
+            }
+        }
+
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+
+        const void* getGraphicsBinding() const override {
+            return &m_graphicsBinding;
+        }
+
+        void setSwapchain(PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages, XrSwapchain swapchain) override {
+            uint32_t imageCount;
+            CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+            std::vector<XrSwapchainImageD3D11KHR> images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
+            CHECK_XRCMD(xrEnumerateSwapchainImages(
+                swapchain, imageCount, &imageCount, reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())));
+
+            m_swapchainImages.clear();
+            for (const XrSwapchainImageD3D11KHR& image : images) {
+                m_swapchainImages.push_back(getRenderTargetView(image.texture));
+            }
+        }
+
+        void clearSwapchainImage(uint32_t index) override {
+            m_context->ClearRenderTargetView(m_swapchainImages[index], ClearColor);
+        }
+
+        void clearTexture(IGraphicsTexture* texture) override {
+            m_context->ClearRenderTargetView(getRenderTargetView(texture->getNativeTexture<D3D11>()), ClearColor);
+        }
+
+        void paceFrame() override {
+            m_context->End(m_frameQueries[m_frameIndex % m_frameQueries.size()].Get());
+            m_frameIndex++;
+
+            // The next query to reuse is the one ending the oldest frame in flight.
+            if (m_frameIndex >= m_frameQueries.size()) {
+                ID3D11Query* const query = m_frameQueries[m_frameIndex % m_frameQueries.size()].Get();
+                while (m_context->GetData(query, nullptr, 0, 0) == S_FALSE) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // The views are created once per texture. The texture is kept alive along with its view, so that its address
+        // cannot be reused by another texture.
+        ID3D11RenderTargetView* getRenderTargetView(ID3D11Texture2D* texture) {
+            auto it = m_renderTargetViews.find(texture);
+            if (it == m_renderTargetViews.end()) {
+                D3D11_TEXTURE2D_DESC desc;
+                texture->GetDesc(&desc);
+
+                D3D11_RENDER_TARGET_VIEW_DESC rtvDesc{};
+                rtvDesc.Format = desc.Format;
+                rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+                rtvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+                RenderTarget renderTarget{texture};
+                CHECK_HRCMD(
+                    m_device->CreateRenderTargetView(texture, &rtvDesc, renderTarget.view.ReleaseAndGetAddressOf()));
+                it = m_renderTargetViews.insert_or_assign(texture, std::move(renderTarget)).first;
+            }
+            return it->second.view.Get();
+        }
+
+        struct RenderTarget {
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID3D11RenderTargetView> view;
+        };
+
+        ComPtr<ID3D11Device> m_device;
+        ComPtr<ID3D11DeviceContext> m_context;
+        XrGraphicsBindingD3D11KHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_D3D11_KHR};
+
+        std::unordered_map<ID3D11Texture2D*, RenderTarget> m_renderTargetViews;
+        std::vector<ID3D11RenderTargetView*> m_swapchainImages;
+
+        std::array<ComPtr<ID3D11Query>, FramesInFlight + 1> m_frameQueries;
+        uint64_t m_frameIndex{0};
+    };
+
+    struct D3D12Application : IApplication {
+        D3D12Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel) {
+            CHECK_HRCMD(D3D12CreateDevice(adapter, featureLevel, IID_PPV_ARGS(m_device.ReleaseAndGetAddressOf())));
+            D3D12_COMMAND_QUEUE_DESC queueDesc{};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+            CHECK_HRCMD(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_queue.ReleaseAndGetAddressOf())));
+            m_graphicsBinding.device = m_device.Get();
+            m_graphicsBinding.queue = m_queue.Get();
+
+            for (ComPtr<ID3D12CommandAllocator>& allocator : m_commandAllocators) {
+                CHECK_HRCMD(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                             IID_PPV_ARGS(allocator.ReleaseAndGetAddressOf())));
+            }
+            CHECK_HRCMD(m_device->CreateCommandList(0,
+                                                    D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                    m_commandAllocators[0].Get(),
+                                                    nullptr,
+                                                    IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(m_commandList->Close());
+
+            CHECK_HRCMD(
+                m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+            m_fenceEvent.reset(CreateEventA(nullptr, false, false, nullptr));
+
+            D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+            heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+            heapDesc.NumDescriptors = MaxRenderTargets;
+            CHECK_HRCMD(m_device->CreateDescriptorHeap(
+                &heapDesc, IID_PPV_ARGS(m_renderTargetViewHeap.ReleaseAndGetAddressOf())));
+            m_renderTargetViewSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        }
+
+        ~D3D12Application() override {
+            waitOnCpu(m_fenceValue);
+        }
+
+        Api getApi() const override {
+            return Api::D3D12;
+        }
+
+        const void* getGraphicsBinding() const override {
+            return &m_graphicsBinding;
+        }
+
+        void setSwapchain(PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages, XrSwapchain swapchain) override {
+            uint32_t imageCount;
+            CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+            std::vector<XrSwapchainImageD3D12KHR> images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
+            CHECK_XRCMD(xrEnumerateSwapchainImages(
+                swapchain, imageCount, &imageCount, reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())));
+
+            m_swapchainImages.clear();
+            for (const XrSwapchainImageD3D12KHR& image : images) {
+                m_swapchainImages.push_back(image.texture);
+            }
+        }
+
+        void clearSwapchainImage(uint32_t index) override {
+            // XR_KHR_D3D12_enable mandates that color swapchain images are render targets when acquired.
+            clear(m_swapchainImages[index], D3D12_RESOURCE_STATE_RENDER_TARGET);
+        }
+
+        void clearTexture(IGraphicsTexture* texture) override {
+            ID3D12Resource* const resource = texture->getNativeTexture<D3D12>();
+
+            // The composition framework opens the textures it shares with another device from a handle, which leaves
+            // them in the COMMON state. The textures it creates on our device are render targets.
+            D3D12_HEAP_FLAGS heapFlags;
+            CHECK_HRCMD(resource->GetHeapProperties(nullptr, &heapFlags));
+            clear(resource,
+                  (heapFlags & D3D12_HEAP_FLAG_SHARED) ? D3D12_RESOURCE_STATE_COMMON
+                                                       : D3D12_RESOURCE_STATE_RENDER_TARGET);
+        }
+
+        void paceFrame() override {
+            m_frameFenceValues[m_frameIndex % m_frameFenceValues.size()] = signal();
+            m_frameIndex++;
+
+            // The next value to reuse is the one ending the oldest frame in flight.
+            if (m_frameIndex >= m_frameFenceValues.size()) {
+                waitOnCpu(m_frameFenceValues[m_frameIndex % m_frameFenceValues.size()]);
+            }
+        }
+
+        void clear(ID3D12Resource* resource, D3D12_RESOURCE_STATES state) {
+            const D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView = getRenderTargetView(resource);
+
+            const size_t slot = m_nextCommandList;
+            waitOnCpu(m_commandListFenceValues[slot]);
+            CHECK_HRCMD(m_commandAllocators[slot]->Reset());
+            CHECK_HRCMD(m_commandList->Reset(m_commandAllocators[slot].Get(), nullptr));
+
+            D3D12_RESOURCE_BARRIER barrier{};
+            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            barrier.Transition.pResource = resource;
+            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            barrier.Transition.StateBefore = state;
+            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+            if (state != D3D12_RESOURCE_STATE_RENDER_TARGET) {
+                m_commandList->ResourceBarrier(1, &barrier);
+            }
+            m_commandList->ClearRenderTargetView(renderTargetView, ClearColor, 0, nullptr);
+            if (state != D3D12_RESOURCE_STATE_RENDER_TARGET) {
+                std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+                m_commandList->ResourceBarrier(1, &barrier);
+            }
+
+            CHECK_HRCMD(m_commandList->Close());
+            ID3D12CommandList* const commandLists[] = {m_commandList.Get()};
+            m_queue->ExecuteCommandLists(1, commandLists);
+            m_commandListFenceValues[slot] = signal();
+            m_nextCommandList = (slot + 1) % m_commandAllocators.size();
+        }
+
+        // The views are created once per texture. The texture is kept alive along with its view, so that its address
+        // cannot be reused by another texture.
+        D3D12_CPU_DESCRIPTOR_HANDLE getRenderTargetView(ID3D12Resource* resource) {
+            auto it = m_renderTargetViews.find(resource);
+            if (it == m_renderTargetViews.end()) {
+                if (m_renderTargetViews.size() >= MaxRenderTargets) {
+                    throw std::runtime_error("Too many render targets");
+                }
+
+                const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+                D3D12_RENDER_TARGET_VIEW_DESC rtvDesc{};
+                rtvDesc.Format = desc.Format;
+                rtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DARRAY;
+                rtvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+                RenderTarget renderTarget{resource, m_renderTargetViewHeap->GetCPUDescriptorHandleForHeapStart()};
+                renderTarget.view.ptr += m_renderTargetViews.size() * m_renderTargetViewSize;
+                m_device->CreateRenderTargetView(resource, &rtvDesc, renderTarget.view);
+                it = m_renderTargetViews.insert_or_assign(resource, std::move(renderTarget)).first;
+            }
+            return it->second.view;
+        }
+
+        uint64_t signal() {
+            CHECK_HRCMD(m_queue->Signal(m_fence.Get(), ++m_fenceValue));
+            return m_fenceValue;
+        }
+
+        void waitOnCpu(uint64_t value) {
+            if (m_fence->GetCompletedValue() < value) {
+                CHECK_HRCMD(m_fence->SetEventOnCompletion(value, m_fenceEvent.get()));
+                WaitForSingleObject(m_fenceEvent.get(), INFINITE);
+            }
+        }
+
+        static constexpr uint32_t MaxRenderTargets = 16;
+
+        struct RenderTarget {
+            ComPtr<ID3D12Resource> resource;
+            D3D12_CPU_DESCRIPTOR_HANDLE view;
+        };
+
+        ComPtr<ID3D12Device> m_device;
+        ComPtr<ID3D12CommandQueue> m_queue;
+        XrGraphicsBindingD3D12KHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_D3D12_KHR};
+
+        // A few frames of clears may be in flight, each uses its own allocator.
+        std::array<ComPtr<ID3D12CommandAllocator>, 4 * (FramesInFlight + 1)> m_commandAllocators;
+        std::array<uint64_t, 4 * (FramesInFlight + 1)> m_commandListFenceValues{};
+        size_t m_nextCommandList{0};
+        ComPtr<ID3D12GraphicsCommandList> m_commandList;
+
+        ComPtr<ID3D12Fence> m_fence;
+        uint64_t m_fenceValue{0};
+        wil::unique_handle m_fenceEvent;
+
+        ComPtr<ID3D12DescriptorHeap> m_renderTargetViewHeap;
+        UINT m_renderTargetViewSize{0};
+        std::unordered_map<ID3D12Resource*, RenderTarget> m_renderTargetViews;
+        std::vector<ID3D12Resource*> m_swapchainImages;
+
+        std::array<uint64_t, FramesInFlight + 1> m_frameFenceValues{};
+        uint64_t m_frameIndex{0};
+    };
+
+} // namespace
+
+namespace benchmark::application {
+
+    std::unique_ptr<IApplication> createD3D11Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel) {
+        return std::make_unique<D3D11Application>(adapter, featureLevel);
+    }
+
+    std::unique_ptr<IApplication> createD3D12Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel) {
+        return std::make_unique<D3D12Application>(adapter, featureLevel);
+    }
+
+} // namespace benchmark::application
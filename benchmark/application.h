@@ -0,0 +1,56 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace benchmark::application {
+
+    // The graphics of a minimal application: it clears the images of its own swapchain, and the images that the layer
+    // renders on the application's device. Every clear is submitted before returning, so that it is ordered before the
+    // synchronization points inserted by the composition framework.
+    struct IApplication {
+        virtual ~IApplication() = default;
+
+        virtual openxr_api_layer::utils::graphics::Api getApi() const = 0;
+
+        // The graphics binding to chain to XrSessionCreateInfo.
+        virtual const void* getGraphicsBinding() const = 0;
+
+        // Enumerate the images of the swapchain submitted by the application.
+        virtual void setSwapchain(PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages, XrSwapchain swapchain) = 0;
+        virtual void clearSwapchainImage(uint32_t index) = 0;
+
+        // Clear a texture created by the composition framework on the application's device.
+        virtual void clearTexture(openxr_api_layer::utils::graphics::IGraphicsTexture* texture) = 0;
+
+        // Let at most 2 frames be queued on the GPU, so that the CPU timings are not disturbed by the driver throttling
+        // the submissions at random points when the GPU falls behind.
+        virtual void paceFrame() = 0;
+    };
+
+    std::unique_ptr<IApplication> createD3D11Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel);
+    std::unique_ptr<IApplication> createD3D12Application(IDXGIAdapter1* adapter, D3D_FEATURE_LEVEL featureLevel);
+
+} // namespace benchmark::application
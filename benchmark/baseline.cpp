@@ -0,0 +1,82 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "baseline.h"
+
+namespace {
+
+    // Differences below this duration are within the noise of the scheduler and of the timers.
+    constexpr double MinimumRegressionUs = 5.0;
+
+} // namespace
+
+namespace benchmark::baseline {
+
+    Baseline load(const std::filesystem::path& path) {
+        Baseline baseline;
+
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            return baseline;
+        }
+
+        std::string line;
+        for (uint32_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream fields(line);
+            std::string key;
+            Reference reference;
+            if (!(fields >> key >> reference.p50 >> reference.p99)) {
+                throw std::runtime_error(fmt::format("{}({}): invalid baseline entry", path.string(), lineNumber));
+            }
+            baseline.insert_or_assign(key, reference);
+        }
+
+        return baseline;
+    }
+
+    void save(const std::filesystem::path& path, const Baseline& baseline) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+
+        file << "# Reference timings of the benchmark in microseconds: <scenario>/<metric> <p50> <p99>.\n";
+        file << "# Recorded with: benchmark.exe --update-baseline\n";
+        for (const auto& [key, reference] : baseline) {
+            file << fmt::format("{} {:.2f} {:.2f}\n", key, reference.p50, reference.p99);
+        }
+    }
+
+    bool isRegression(double value, double reference, double tolerance) {
+        return value > reference * (1.0 + tolerance) && value - reference > MinimumRegressionUs;
+    }
+
+} // namespace benchmark::baseline
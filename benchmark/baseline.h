@@ -0,0 +1,48 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace benchmark::baseline {
+
+    // The reference timings of one metric, in microseconds.
+    struct Reference {
+        double p50{0.0};
+        double p99{0.0};
+    };
+
+    // Keyed by "<scenario>/<metric>".
+    using Baseline = std::map<std::string, Reference>;
+
+    // The file holds one metric per line: "<scenario>/<metric> <p50> <p99>". Lines starting with '#' are comments.
+    // A missing file is an empty baseline.
+    Baseline load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path, const Baseline& baseline);
+
+    // A measurement regresses when it exceeds its reference by more than the tolerance (a fraction of the reference)
+    // and by more than a minimum duration, below which the differences are mostly noise.
+    bool isRegression(double value, double reference, double tolerance);
+
+} // namespace benchmark::baseline
@@ -0,0 +1,779 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "application.h"
+#include "baseline.h"
+#include "mock_runtime.h"
+
+// Replay a frame loop against a mock runtime, timing each call on the CPU and the composition work on the GPU, then
+// compare the timings to a stored baseline.
+// The "layer" scenario loads the API layer DLL and measures its dispatch. The other scenarios host the input and
+// composition frameworks in-process on a D3D11 or D3D12 application, and play the part of a layer in xrEndFrame():
+// they render into a layer-owned swapchain, copy it into a submitted swapchain on the composition device, and commit
+// it to the runtime.
+//
+// Usage: benchmark.exe [--frames <count>] [--scenario <name>]... [--warp]
+//                      [--baseline <file>] [--update-baseline] [--tolerance <percent>]
+//
+// The exit code is 2 when a metric regressed compared to the baseline.
+
+namespace {
+
+    using namespace openxr_api_layer::utils::graphics;
+    using namespace openxr_api_layer::utils::inputs;
+    using namespace benchmark::application;
+    namespace baseline = benchmark::baseline;
+    namespace mock_runtime = benchmark::mock_runtime;
+
+    constexpr uint32_t DefaultFrameCount = 5000;
+
+    // Frames to run before recording, so that lazily created resources are not accounted for.
+    constexpr uint32_t WarmupFrameCount = 100;
+
+    // How much slower than the baseline a metric may be before it is reported as a regression.
+    constexpr double DefaultTolerance = 0.25;
+
+    constexpr int RegressionExitCode = 2;
+
+    constexpr uint32_t ImageWidth = 1440;
+    constexpr uint32_t ImageHeight = 1584;
+
+    struct Scenario {
+        const char* name;
+
+        // Load the API layer DLL, instead of hosting the frameworks in-process.
+        bool throughApiLayer;
+
+        Api applicationApi;
+        CompositionApi compositionApi;
+
+        // Whether the runtime's swapchain images can be opened on the composition device.
+        bool shareableImages;
+    };
+
+    const std::array<Scenario, 5> Scenarios = {{
+        // The API layer as built, which only creates the frameworks for the applications whose profile requests them.
+        {"layer", true, Api::D3D11, CompositionApi::D3D11, true},
+
+        // The runtime's images are opened on the composition device.
+        {"d3d11", false, Api::D3D11, CompositionApi::D3D11, true},
+
+        // The runtime's images are copied through a bounce buffer upon commit.
+        {"d3d11-bounce", false, Api::D3D11, CompositionApi::D3D11, false},
+
+        // The composition device shares the application's device, and aliases the runtime's images.
+        {"d3d12", false, Api::D3D12, CompositionApi::D3D12, true},
+
+        // Composition on D3D11 for a D3D12 application. Unless the runtime is WMR, the framework does not trust the
+        // shareable flag of D3D12 images, and copies through a bounce buffer upon commit.
+        {"d3d12-bounce", false, Api::D3D12, CompositionApi::D3D11, true},
+    }};
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMicroseconds(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // The measurements of a single metric, one per frame.
+    struct Timings {
+        std::string name;
+        std::vector<double> microseconds;
+    };
+
+    // The measurements of a scenario, in the order the metrics were first recorded.
+    struct Results {
+        void record(const std::string_view& name, double microseconds) {
+            auto it = std::find_if(
+                timings.begin(), timings.end(), [&](const Timings& entry) { return entry.name == name; });
+            if (it == timings.end()) {
+                it = timings.insert(timings.end(), Timings{std::string(name)});
+            }
+            it->microseconds.push_back(microseconds);
+        }
+
+        std::vector<Timings> timings;
+    };
+
+    double percentile(std::vector<double> values, double percentile) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(static_cast<size_t>(percentile * values.size()), values.size() - 1);
+        return values[index];
+    }
+
+    // The OpenXR functions reached by the application.
+    struct Dispatch {
+        PFN_xrDestroyInstance xrDestroyInstance{nullptr};
+        PFN_xrGetSystem xrGetSystem{nullptr};
+        PFN_xrCreateSession xrCreateSession{nullptr};
+        PFN_xrDestroySession xrDestroySession{nullptr};
+        PFN_xrPollEvent xrPollEvent{nullptr};
+        PFN_xrBeginSession xrBeginSession{nullptr};
+        PFN_xrEndSession xrEndSession{nullptr};
+        PFN_xrCreateReferenceSpace xrCreateReferenceSpace{nullptr};
+        PFN_xrDestroySpace xrDestroySpace{nullptr};
+        PFN_xrLocateViews xrLocateViews{nullptr};
+        PFN_xrLocateSpace xrLocateSpace{nullptr};
+        PFN_xrCreateSwapchain xrCreateSwapchain{nullptr};
+        PFN_xrDestroySwapchain xrDestroySwapchain{nullptr};
+        PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages{nullptr};
+        PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage{nullptr};
+        PFN_xrWaitSwapchainImage xrWaitSwapchainImage{nullptr};
+        PFN_xrReleaseSwapchainImage xrReleaseSwapchainImage{nullptr};
+        PFN_xrWaitFrame xrWaitFrame{nullptr};
+        PFN_xrBeginFrame xrBeginFrame{nullptr};
+        PFN_xrEndFrame xrEndFrame{nullptr};
+        PFN_xrStringToPath xrStringToPath{nullptr};
+        PFN_xrCreateActionSet xrCreateActionSet{nullptr};
+        PFN_xrDestroyActionSet xrDestroyActionSet{nullptr};
+        PFN_xrCreateAction xrCreateAction{nullptr};
+        PFN_xrSuggestInteractionProfileBindings xrSuggestInteractionProfileBindings{nullptr};
+        PFN_xrAttachSessionActionSets xrAttachSessionActionSets{nullptr};
+        PFN_xrCreateActionSpace xrCreateActionSpace{nullptr};
+        PFN_xrSyncActions xrSyncActions{nullptr};
+        PFN_xrGetActionStateBoolean xrGetActionStateBoolean{nullptr};
+    };
+
+    template <typename T>
+    void resolve(PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr, XrInstance instance, const char* name, T& function) {
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, name, reinterpret_cast<PFN_xrVoidFunction*>(&function)));
+    }
+
+#define RESOLVE(name) resolve(xrGetInstanceProcAddr, instance, #name, dispatch.name)
+
+    Dispatch resolveDispatch(PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr, XrInstance instance) {
+        Dispatch dispatch;
+        RESOLVE(xrDestroyInstance);
+        RESOLVE(xrGetSystem);
+        RESOLVE(xrCreateSession);
+        RESOLVE(xrDestroySession);
+        RESOLVE(xrPollEvent);
+        RESOLVE(xrBeginSession);
+        RESOLVE(xrEndSession);
+        RESOLVE(xrCreateReferenceSpace);
+        RESOLVE(xrDestroySpace);
+        RESOLVE(xrLocateViews);
+        RESOLVE(xrLocateSpace);
+        RESOLVE(xrCreateSwapchain);
+        RESOLVE(xrDestroySwapchain);
+        RESOLVE(xrEnumerateSwapchainImages);
+        RESOLVE(xrAcquireSwapchainImage);
+        RESOLVE(xrWaitSwapchainImage);
+        RESOLVE(xrReleaseSwapchainImage);
+        RESOLVE(xrWaitFrame);
+        RESOLVE(xrBeginFrame);
+        RESOLVE(xrEndFrame);
+        RESOLVE(xrStringToPath);
+        RESOLVE(xrCreateActionSet);
+        RESOLVE(xrDestroyActionSet);
+        RESOLVE(xrCreateAction);
+        RESOLVE(xrSuggestInteractionProfileBindings);
+        RESOLVE(xrAttachSessionActionSets);
+        RESOLVE(xrCreateActionSpace);
+        RESOLVE(xrSyncActions);
+        RESOLVE(xrGetActionStateBoolean);
+        return dispatch;
+    }
+
+#undef RESOLVE
+
+    std::filesystem::path getModuleDirectory() {
+        wchar_t modulePath[MAX_PATH];
+        GetModuleFileNameW(nullptr, modulePath, MAX_PATH);
+        return std::filesystem::path(modulePath).parent_path();
+    }
+
+    // Negotiate with the API layer like the OpenXR loader does, then create an instance through it.
+    XrInstance createInstanceThroughLayer(HMODULE layerModule,
+                                          const XrInstanceCreateInfo& createInfo,
+                                          PFN_xrGetInstanceProcAddr* xrGetInstanceProcAddr) {
+        const auto xrNegotiateLoaderApiLayerInterface = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+            GetProcAddress(layerModule, "xrNegotiateLoaderApiLayerInterface"));
+        if (!xrNegotiateLoaderApiLayerInterface) {
+            throw std::runtime_error("The API layer does not export xrNegotiateLoaderApiLayerInterface");
+        }
+
+        XrNegotiateLoaderInfo loaderInfo{XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+                                         XR_LOADER_INFO_STRUCT_VERSION,
+                                         sizeof(XrNegotiateLoaderInfo)};
+        loaderInfo.minInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
+        loaderInfo.maxApiVersion = XR_CURRENT_API_VERSION;
+        XrNegotiateApiLayerRequest apiLayerRequest{XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+                                                   XR_API_LAYER_INFO_STRUCT_VERSION,
+                                                   sizeof(XrNegotiateApiLayerRequest)};
+        CHECK_XRCMD(xrNegotiateLoaderApiLayerInterface(&loaderInfo, LAYER_NAME, &apiLayerRequest));
+
+        // The mock runtime is the next (and last) link of the chain.
+        XrApiLayerNextInfo nextInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+                                    XR_API_LAYER_NEXT_INFO_STRUCT_VERSION,
+                                    sizeof(XrApiLayerNextInfo)};
+        strcpy(nextInfo.layerName, LAYER_NAME);
+        nextInfo.nextGetInstanceProcAddr = mock_runtime::xrGetInstanceProcAddr;
+        nextInfo.nextCreateApiLayerInstance = mock_runtime::xrCreateApiLayerInstance;
+        XrApiLayerCreateInfo apiLayerInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+                                          XR_API_LAYER_CREATE_INFO_STRUCT_VERSION,
+                                          sizeof(XrApiLayerCreateInfo)};
+        apiLayerInfo.nextInfo = &nextInfo;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        CHECK_XRCMD(apiLayerRequest.createApiLayerInstance(&createInfo, &apiLayerInfo, &instance));
+        *xrGetInstanceProcAddr = apiLayerRequest.getInstanceProcAddr;
+        return instance;
+    }
+
+    // The frameworks hosted in-process hook the functions they need on top of the mock runtime, like the API layer
+    // does in its own xrGetInstanceProcAddr().
+    std::shared_ptr<IInputFrameworkFactory> g_inputFrameworkFactory;
+    std::shared_ptr<ICompositionFrameworkFactory> g_compositionFrameworkFactory;
+
+    XrResult XRAPI_CALL xrGetInstanceProcAddrWithFrameworks(XrInstance instance,
+                                                            const char* name,
+                                                            PFN_xrVoidFunction* function) {
+        const XrResult result = mock_runtime::xrGetInstanceProcAddr(instance, name, function);
+        if (XR_SUCCEEDED(result)) {
+            g_inputFrameworkFactory->xrGetInstanceProcAddr_post(instance, name, function);
+            g_compositionFrameworkFactory->xrGetInstanceProcAddr_post(instance, name, function);
+        }
+        return result;
+    }
+
+    std::unique_ptr<IApplication> createApplication(Api api,
+                                                    PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr,
+                                                    XrInstance instance,
+                                                    XrSystemId systemId) {
+        if (api == Api::D3D11) {
+            PFN_xrGetD3D11GraphicsRequirementsKHR xrGetD3D11GraphicsRequirementsKHR;
+            resolve(xrGetInstanceProcAddr,
+                    instance,
+                    "xrGetD3D11GraphicsRequirementsKHR",
+                    xrGetD3D11GraphicsRequirementsKHR);
+            XrGraphicsRequirementsD3D11KHR requirements{XR_TYPE_GRAPHICS_REQUIREMENTS_D3D11_KHR};
+            CHECK_XRCMD(xrGetD3D11GraphicsRequirementsKHR(instance, systemId, &requirements));
+            return createD3D11Application(mock_runtime::getAdapter(), requirements.minFeatureLevel);
+        }
+
+        PFN_xrGetD3D12GraphicsRequirementsKHR xrGetD3D12GraphicsRequirementsKHR;
+        resolve(xrGetInstanceProcAddr,
+                instance,
+                "xrGetD3D12GraphicsRequirementsKHR",
+                xrGetD3D12GraphicsRequirementsKHR);
+        XrGraphicsRequirementsD3D12KHR requirements{XR_TYPE_GRAPHICS_REQUIREMENTS_D3D12_KHR};
+        CHECK_XRCMD(xrGetD3D12GraphicsRequirementsKHR(instance, systemId, &requirements));
+        return createD3D12Application(mock_runtime::getAdapter(), requirements.minFeatureLevel);
+    }
+
+    Results runScenario(const Scenario& scenario, uint32_t frameCount) {
+        mock_runtime::setShareableImages(scenario.shareableImages);
+
+        const char* const extensions[] = {scenario.applicationApi == Api::D3D11 ? XR_KHR_D3D11_ENABLE_EXTENSION_NAME
+                                                                                 : XR_KHR_D3D12_ENABLE_EXTENSION_NAME};
+        XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(createInfo.applicationInfo.applicationName, "benchmark");
+        createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        createInfo.enabledExtensionCount = 1;
+        createInfo.enabledExtensionNames = extensions;
+
+        HMODULE layerModule = nullptr;
+        XrInstance instance = XR_NULL_HANDLE;
+        PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr = nullptr;
+        if (scenario.throughApiLayer) {
+            // The API layer is built next to the benchmark.
+            const std::filesystem::path layerPath =
+                getModuleDirectory() / (std::string(LAYER_NAME) + (sizeof(void*) == 4 ? "-32" : "") + ".dll");
+            layerModule = LoadLibraryW(layerPath.c_str());
+            if (!layerModule) {
+                throw std::runtime_error(fmt::format("Failed to load {}", layerPath.string()));
+            }
+            instance = createInstanceThroughLayer(layerModule, createInfo, &xrGetInstanceProcAddr);
+        } else {
+            CHECK_XRCMD(mock_runtime::xrCreateApiLayerInstance(&createInfo, nullptr, &instance));
+            g_inputFrameworkFactory = createInputFrameworkFactory(
+                createInfo,
+                instance,
+                mock_runtime::xrGetInstanceProcAddr,
+                InputMethod::MotionControllerSpatial | InputMethod::MotionControllerButtons);
+            g_compositionFrameworkFactory = createCompositionFrameworkFactory(
+                createInfo, instance, mock_runtime::xrGetInstanceProcAddr, scenario.compositionApi);
+            xrGetInstanceProcAddr = xrGetInstanceProcAddrWithFrameworks;
+        }
+        const Dispatch xr = resolveDispatch(xrGetInstanceProcAddr, instance);
+
+        XrSystemGetInfo systemInfo{XR_TYPE_SYSTEM_GET_INFO};
+        systemInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        XrSystemId systemId;
+        CHECK_XRCMD(xr.xrGetSystem(instance, &systemInfo, &systemId));
+
+        const std::unique_ptr<IApplication> application =
+            createApplication(scenario.applicationApi, xrGetInstanceProcAddr, instance, systemId);
+
+        XrSessionCreateInfo sessionInfo{XR_TYPE_SESSION_CREATE_INFO, application->getGraphicsBinding()};
+        sessionInfo.systemId = systemId;
+        XrSession session;
+        CHECK_XRCMD(xr.xrCreateSession(instance, &sessionInfo, &session));
+
+        XrReferenceSpaceCreateInfo referenceSpaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+        referenceSpaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+        referenceSpaceInfo.poseInReferenceSpace.orientation.w = 1.f;
+        XrSpace localSpace;
+        CHECK_XRCMD(xr.xrCreateReferenceSpace(session, &referenceSpaceInfo, &localSpace));
+
+        // A typical set of actions, for the input framework to coexist with.
+        XrActionSetCreateInfo actionSetInfo{XR_TYPE_ACTION_SET_CREATE_INFO};
+        strcpy(actionSetInfo.actionSetName, "gameplay");
+        strcpy(actionSetInfo.localizedActionSetName, "Gameplay");
+        XrActionSet actionSet;
+        CHECK_XRCMD(xr.xrCreateActionSet(instance, &actionSetInfo, &actionSet));
+        XrPath rightHand;
+        CHECK_XRCMD(xr.xrStringToPath(instance, "/user/hand/right", &rightHand));
+        XrActionCreateInfo actionInfo{XR_TYPE_ACTION_CREATE_INFO};
+        actionInfo.countSubactionPaths = 1;
+        actionInfo.subactionPaths = &rightHand;
+        strcpy(actionInfo.actionName, "aim");
+        strcpy(actionInfo.localizedActionName, "Aim");
+        actionInfo.actionType = XR_ACTION_TYPE_POSE_INPUT;
+        XrAction aimAction;
+        CHECK_XRCMD(xr.xrCreateAction(actionSet, &actionInfo, &aimAction));
+        strcpy(actionInfo.actionName, "select");
+        strcpy(actionInfo.localizedActionName, "Select");
+        actionInfo.actionType = XR_ACTION_TYPE_BOOLEAN_INPUT;
+        XrAction selectAction;
+        CHECK_XRCMD(xr.xrCreateAction(actionSet, &actionInfo, &selectAction));
+
+        std::array<XrActionSuggestedBinding, 2> bindings{};
+        bindings[0].action = aimAction;
+        CHECK_XRCMD(xr.xrStringToPath(instance, "/user/hand/right/input/aim/pose", &bindings[0].binding));
+        bindings[1].action = selectAction;
+        CHECK_XRCMD(xr.xrStringToPath(instance, "/user/hand/right/input/select/click", &bindings[1].binding));
+        XrInteractionProfileSuggestedBinding suggestedBindings{XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING};
+        CHECK_XRCMD(xr.xrStringToPath(
+            instance, "/interaction_profiles/khr/simple_controller", &suggestedBindings.interactionProfile));
+        suggestedBindings.countSuggestedBindings = static_cast<uint32_t>(bindings.size());
+        suggestedBindings.suggestedBindings = bindings.data();
+        CHECK_XRCMD(xr.xrSuggestInteractionProfileBindings(instance, &suggestedBindings));
+        XrSessionActionSetsAttachInfo attachInfo{XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO};
+        attachInfo.countActionSets = 1;
+        attachInfo.actionSets = &actionSet;
+        CHECK_XRCMD(xr.xrAttachSessionActionSets(session, &attachInfo));
+
+        XrActionSpaceCreateInfo actionSpaceInfo{XR_TYPE_ACTION_SPACE_CREATE_INFO};
+        actionSpaceInfo.action = aimAction;
+        actionSpaceInfo.subactionPath = rightHand;
+        actionSpaceInfo.poseInActionSpace.orientation.w = 1.f;
+        XrSpace aimSpace;
+        CHECK_XRCMD(xr.xrCreateActionSpace(session, &actionSpaceInfo, &aimSpace));
+
+        // One stereo swapchain, like most applications.
+        XrSwapchainCreateInfo swapchainInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        swapchainInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+        swapchainInfo.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        swapchainInfo.width = ImageWidth;
+        swapchainInfo.height = ImageHeight;
+        swapchainInfo.arraySize = 2;
+        swapchainInfo.faceCount = 1;
+        swapchainInfo.mipCount = 1;
+        swapchainInfo.sampleCount = 1;
+        XrSwapchain swapchain;
+        CHECK_XRCMD(xr.xrCreateSwapchain(session, &swapchainInfo, &swapchain));
+        application->setSwapchain(xr.xrEnumerateSwapchainImages, swapchain);
+
+        // The frameworks and the resources of the layer part.
+        IInputFramework* input = nullptr;
+        ICompositionFramework* composition = nullptr;
+        std::shared_ptr<ISwapchain> overlaySwapchain;
+        std::shared_ptr<ISwapchain> compositedSwapchain;
+        std::shared_ptr<IGraphicsTimerPool> compositionTimerPool;
+        std::shared_ptr<IGraphicsTimer> compositionTimer;
+        std::shared_ptr<IGraphicsTimerPool> applicationTimerPool;
+        std::shared_ptr<IGraphicsTimer> commitTimer;
+        if (!scenario.throughApiLayer) {
+            input = g_inputFrameworkFactory->getInputFramework(session);
+            composition = g_compositionFrameworkFactory->getCompositionFramework(session);
+
+            XrSwapchainCreateInfo layerSwapchainInfo = swapchainInfo;
+            layerSwapchainInfo.format =
+                composition->getPreferredSwapchainFormatOnApplicationDevice(layerSwapchainInfo.usageFlags);
+
+            // Rendered by the layer on the application's device, and read during composition.
+            overlaySwapchain = composition->createSwapchain(layerSwapchainInfo, SwapchainMode::Read);
+            // Written during composition, and submitted to the runtime.
+            compositedSwapchain =
+                composition->createSwapchain(layerSwapchainInfo, SwapchainMode::Submit | SwapchainMode::Write);
+
+            compositionTimerPool = composition->getCompositionDevice()->createTimerPool(1);
+            compositionTimer = compositionTimerPool->createTimer("Composition");
+            applicationTimerPool = composition->getApplicationDevice()->createTimerPool(1);
+            commitTimer = applicationTimerPool->createTimer("Commit");
+        }
+
+        Results results;
+        bool isSessionRunning = false;
+        uint32_t recordedFrames = 0;
+        for (uint32_t frame = 0; recordedFrames < frameCount; frame++) {
+            application->paceFrame();
+
+            XrEventDataBuffer event{XR_TYPE_EVENT_DATA_BUFFER};
+            while (xr.xrPollEvent(instance, &event) == XR_SUCCESS) {
+                if (event.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED &&
+                    reinterpret_cast<const XrEventDataSessionStateChanged&>(event).state == XR_SESSION_STATE_READY) {
+                    XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+                    beginInfo.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+                    CHECK_XRCMD(xr.xrBeginSession(session, &beginInfo));
+                    isSessionRunning = true;
+                }
+                event = {XR_TYPE_EVENT_DATA_BUFFER};
+            }
+            if (!isSessionRunning) {
+                throw std::runtime_error("The session did not become ready");
+            }
+
+            const bool isRecording = frame >= WarmupFrameCount;
+            auto timed = [&](const char* name, auto&& call) {
+                const Clock::time_point start = Clock::now();
+                call();
+                if (isRecording) {
+                    results.record(name, elapsedMicroseconds(start));
+                }
+            };
+            auto recordGpuTime = [&](const char* name, const IGraphicsTimer& timer) {
+                const uint64_t duration = timer.query();
+                if (duration) {
+                    results.record(name, static_cast<double>(duration));
+                }
+            };
+
+            const Clock::time_point frameStart = Clock::now();
+
+            // The application part.
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            timed("xrWaitFrame", [&] { CHECK_XRCMD(xr.xrWaitFrame(session, nullptr, &frameState)); });
+            timed("xrBeginFrame", [&] { CHECK_XRCMD(xr.xrBeginFrame(session, nullptr)); });
+
+            XrActiveActionSet activeActionSet{actionSet, XR_NULL_PATH};
+            XrActionsSyncInfo syncInfo{XR_TYPE_ACTIONS_SYNC_INFO};
+            syncInfo.countActiveActionSets = 1;
+            syncInfo.activeActionSets = &activeActionSet;
+            timed("xrSyncActions", [&] { CHECK_XRCMD(xr.xrSyncActions(session, &syncInfo)); });
+            XrActionStateGetInfo getInfo{XR_TYPE_ACTION_STATE_GET_INFO};
+            getInfo.action = selectAction;
+            XrActionStateBoolean selectState{XR_TYPE_ACTION_STATE_BOOLEAN};
+            timed("xrGetActionStateBoolean",
+                  [&] { CHECK_XRCMD(xr.xrGetActionStateBoolean(session, &getInfo, &selectState)); });
+            XrSpaceLocation aimLocation{XR_TYPE_SPACE_LOCATION};
+            timed("xrLocateSpace", [&] {
+                CHECK_XRCMD(xr.xrLocateSpace(aimSpace, localSpace, frameState.predictedDisplayTime, &aimLocation));
+            });
+
+            XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+            viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+            viewLocateInfo.displayTime = frameState.predictedDisplayTime;
+            viewLocateInfo.space = localSpace;
+            XrViewState viewState{XR_TYPE_VIEW_STATE};
+            std::array<XrView, 2> views{{{XR_TYPE_VIEW}, {XR_TYPE_VIEW}}};
+            uint32_t viewCount;
+            timed("xrLocateViews", [&] {
+                CHECK_XRCMD(xr.xrLocateViews(session,
+                                             &viewLocateInfo,
+                                             &viewState,
+                                             static_cast<uint32_t>(views.size()),
+                                             &viewCount,
+                                             views.data()));
+            });
+
+            uint32_t imageIndex;
+            timed("xrAcquireSwapchainImage",
+                  [&] { CHECK_XRCMD(xr.xrAcquireSwapchainImage(swapchain, nullptr, &imageIndex)); });
+            XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+            waitInfo.timeout = XR_INFINITE_DURATION;
+            timed("xrWaitSwapchainImage", [&] { CHECK_XRCMD(xr.xrWaitSwapchainImage(swapchain, &waitInfo)); });
+            application->clearSwapchainImage(imageIndex);
+            timed("xrReleaseSwapchainImage", [&] { CHECK_XRCMD(xr.xrReleaseSwapchainImage(swapchain, nullptr)); });
+
+            std::array<XrCompositionLayerProjectionView, 2> projectionViews{};
+            for (uint32_t i = 0; i < projectionViews.size(); i++) {
+                projectionViews[i].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
+                projectionViews[i].pose = views[i].pose;
+                projectionViews[i].fov = views[i].fov;
+                projectionViews[i].subImage.swapchain = swapchain;
+                projectionViews[i].subImage.imageRect.extent = {(int32_t)ImageWidth, (int32_t)ImageHeight};
+                projectionViews[i].subImage.imageArrayIndex = i;
+            }
+            XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+            projectionLayer.space = localSpace;
+            projectionLayer.viewCount = static_cast<uint32_t>(projectionViews.size());
+            projectionLayer.views = projectionViews.data();
+            std::vector<const XrCompositionLayerBaseHeader*> layers = {
+                reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projectionLayer)};
+
+            // The layer part, normally done in the layer's xrEndFrame().
+            std::array<XrCompositionLayerProjectionView, 2> compositedViews{};
+            XrCompositionLayerProjection compositedLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+            if (composition) {
+                XrPosef controllerPose;
+                timed("locateMotionController",
+                      [&] { input->locateMotionController(Hands::Right, localSpace, controllerPose); });
+                timed("getMotionControllerButtonState",
+                      [&] { input->getMotionControllerButtonState(Hands::Right, MotionControllerButton::Select); });
+
+                // Render the layer's content on the application's device.
+                ISwapchainImage* overlayImage;
+                timed("overlay.acquireImage", [&] { overlayImage = overlaySwapchain->acquireImage(); });
+                application->clearTexture(overlayImage->getApplicationTexture());
+                timed("overlay.releaseImage", [&] { overlaySwapchain->releaseImage(); });
+
+                timed("serializePreComposition", [&] { composition->serializePreComposition(); });
+
+                // Compose on the composition device.
+                ISwapchainImage* compositedImage;
+                timed("composited.acquireImage", [&] { compositedImage = compositedSwapchain->acquireImage(); });
+                ISwapchainImage* sourceImage;
+                timed("overlay.getLastReleasedImage", [&] { sourceImage = overlaySwapchain->getLastReleasedImage(); });
+                IGraphicsTexture* source;
+                timed("getTextureForRead", [&] { source = sourceImage->getTextureForRead(); });
+                IGraphicsTexture* destination;
+                timed("getTextureForWrite", [&] { destination = compositedImage->getTextureForWrite(); });
+                IGraphicsDevice* const compositionDevice = composition->getCompositionDevice();
+                compositionTimer->start();
+                compositionDevice->copyTexture(source, destination);
+                compositionDevice->waitForCopies();
+                compositionTimer->stop();
+                timed("composited.releaseImage", [&] { compositedSwapchain->releaseImage(); });
+
+                // Hand over to the runtime. With bounce buffers, the copies happen on the application's device.
+                commitTimer->start();
+                timed("commitLastReleasedImage", [&] { compositedSwapchain->commitLastReleasedImage(); });
+                timed("serializePostComposition", [&] { composition->serializePostComposition(); });
+                commitTimer->stop();
+
+                for (uint32_t i = 0; i < compositedViews.size(); i++) {
+                    compositedViews[i] = projectionViews[i];
+                    compositedViews[i].subImage = compositedSwapchain->getSubImage();
+                    compositedViews[i].subImage.imageArrayIndex = i;
+                }
+                compositedLayer.space = localSpace;
+                compositedLayer.viewCount = static_cast<uint32_t>(compositedViews.size());
+                compositedLayer.views = compositedViews.data();
+                layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&compositedLayer));
+            }
+
+            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+            frameEndInfo.displayTime = frameState.predictedDisplayTime;
+            frameEndInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+            frameEndInfo.layerCount = static_cast<uint32_t>(layers.size());
+            frameEndInfo.layers = layers.data();
+            timed("xrEndFrame", [&] { CHECK_XRCMD(xr.xrEndFrame(session, &frameEndInfo)); });
+
+            if (isRecording) {
+                results.record("Frame", elapsedMicroseconds(frameStart));
+                recordedFrames++;
+
+                // The timers report their latest completed measurement, which is a few frames old. They report 0 until
+                // the first measurement completes, or when the work was too short to be measured.
+                if (composition) {
+                    recordGpuTime("gpu.Composition", *compositionTimer);
+                    recordGpuTime("gpu.Commit", *commitTimer);
+                }
+            }
+        }
+
+        CHECK_XRCMD(xr.xrEndSession(session));
+        commitTimer.reset();
+        applicationTimerPool.reset();
+        compositionTimer.reset();
+        compositionTimerPool.reset();
+        compositedSwapchain.reset();
+        overlaySwapchain.reset();
+        CHECK_XRCMD(xr.xrDestroySwapchain(swapchain));
+        CHECK_XRCMD(xr.xrDestroySpace(aimSpace));
+        CHECK_XRCMD(xr.xrDestroySpace(localSpace));
+        CHECK_XRCMD(xr.xrDestroySession(session));
+        CHECK_XRCMD(xr.xrDestroyActionSet(actionSet));
+        g_compositionFrameworkFactory.reset();
+        g_inputFrameworkFactory.reset();
+        CHECK_XRCMD(xr.xrDestroyInstance(instance));
+        if (layerModule) {
+            FreeLibrary(layerModule);
+        }
+
+        return results;
+    }
+
+    void printResults(const Scenario& scenario, uint32_t frameCount, const Results& results) {
+        fmt::print("\n{}: {} frames\n", scenario.name, frameCount);
+        fmt::print("{:<34}{:>12}{:>12}{:>12}{:>12}\n", "Time (us)", "mean", "p50", "p99", "max");
+        for (const Timings& timing : results.timings) {
+            double sum = 0.0;
+            for (const double value : timing.microseconds) {
+                sum += value;
+            }
+            fmt::print("{:<34}{:>12.2f}{:>12.2f}{:>12.2f}{:>12.2f}\n",
+                       timing.name,
+                       sum / std::max<size_t>(timing.microseconds.size(), 1),
+                       percentile(timing.microseconds, 0.5),
+                       percentile(timing.microseconds, 0.99),
+                       percentile(timing.microseconds, 1.0));
+        }
+    }
+
+    struct Options {
+        uint32_t frameCount{DefaultFrameCount};
+        bool useWarp{false};
+
+        // All the scenarios when empty.
+        std::vector<std::string> scenarios;
+
+        std::filesystem::path baselinePath;
+        bool updateBaseline{false};
+        double tolerance{DefaultTolerance};
+    };
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        options.baselinePath = getModuleDirectory() / "baseline.txt";
+
+        for (int i = 1; i < argc; i++) {
+            const std::string_view argument(argv[i]);
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(fmt::format("Missing value for {}", argument));
+                }
+                return argv[++i];
+            };
+
+            if (argument == "--frames") {
+                options.frameCount = std::max(static_cast<uint32_t>(std::stoul(value())), 1u);
+            } else if (argument == "--warp") {
+                options.useWarp = true;
+            } else if (argument == "--scenario") {
+                const std::string name = value();
+                if (std::find_if(Scenarios.cbegin(), Scenarios.cend(), [&](const Scenario& scenario) {
+                        return name == scenario.name;
+                    }) == Scenarios.cend()) {
+                    throw std::runtime_error(fmt::format("Unknown scenario: {}", name));
+                }
+                options.scenarios.push_back(name);
+            } else if (argument == "--baseline") {
+                options.baselinePath = value();
+            } else if (argument == "--update-baseline") {
+                options.updateBaseline = true;
+            } else if (argument == "--tolerance") {
+                options.tolerance = std::stod(value()) / 100.0;
+            } else {
+                throw std::runtime_error(fmt::format("Unknown option: {}", argument));
+            }
+        }
+
+        return options;
+    }
+
+    // Either merge the measurements into the baseline, or report the metrics that regressed.
+    int compareToBaseline(const Options& options, const baseline::Baseline& measurements) {
+        baseline::Baseline references = baseline::load(options.baselinePath);
+
+        if (options.updateBaseline) {
+            for (const auto& [key, measurement] : measurements) {
+                references.insert_or_assign(key, measurement);
+            }
+            baseline::save(options.baselinePath, references);
+            fmt::print("\nUpdated {} metrics in {}\n", measurements.size(), options.baselinePath.string());
+            return 0;
+        }
+
+        fmt::print("\nBaseline {} (tolerance {:.0f}%)\n", options.baselinePath.string(), options.tolerance * 100.0);
+        uint32_t comparedCount = 0;
+        uint32_t regressionCount = 0;
+        for (const auto& [key, measurement] : measurements) {
+            const auto it = references.find(key);
+            if (it == references.cend()) {
+                continue;
+            }
+            comparedCount++;
+
+            const baseline::Reference& reference = it->second;
+            if (baseline::isRegression(measurement.p50, reference.p50, options.tolerance) ||
+                baseline::isRegression(measurement.p99, reference.p99, options.tolerance)) {
+                fmt::print("REGRESSION {:<44} p50 {:>10.2f} (baseline {:.2f})  p99 {:>10.2f} (baseline {:.2f})\n",
+                           key,
+                           measurement.p50,
+                           reference.p50,
+                           measurement.p99,
+                           reference.p99);
+                regressionCount++;
+            }
+        }
+        fmt::print("{} metrics compared, {} regressed, {} without baseline\n",
+                   comparedCount,
+                   regressionCount,
+                   measurements.size() - comparedCount);
+
+        return regressionCount ? RegressionExitCode : 0;
+    }
+
+    int run(const Options& options) {
+        mock_runtime::selectAdapter(options.useWarp);
+        fmt::print("Adapter: {}\n", options.useWarp ? "WARP" : "hardware");
+
+        baseline::Baseline measurements;
+        for (const Scenario& scenario : Scenarios) {
+            if (!options.scenarios.empty() &&
+                std::find(options.scenarios.cbegin(), options.scenarios.cend(), scenario.name) ==
+                    options.scenarios.cend()) {
+                continue;
+            }
+
+            const Results results = runScenario(scenario, options.frameCount);
+            printResults(scenario, options.frameCount, results);
+            for (const Timings& timing : results.timings) {
+                measurements.insert_or_assign(
+                    fmt::format("{}/{}", scenario.name, timing.name),
+                    baseline::Reference{percentile(timing.microseconds, 0.5), percentile(timing.microseconds, 0.99)});
+            }
+        }
+
+        return compareToBaseline(options, measurements);
+    }
+
+} // namespace
+
+// Referenced by the framework sources built into the benchmark. The log file is never opened: messages only go to the
+// debugger output.
+namespace openxr_api_layer::log {
+    std::ofstream logStream;
+} // namespace openxr_api_layer::log
+
+int main(int argc, char** argv) {
+    try {
+        return run(parseOptions(argc, argv));
+    } catch (std::exception& exc) {
+        fmt::print(stderr, "{}\n", exc.what());
+        return 1;
+    }
+}
@@ -0,0 +1,800 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "mock_runtime.h"
+
+namespace {
+
+    // The runtime pretends to run at 90Hz.
+    constexpr XrDuration FramePeriod = 11'111'111;
+
+    constexpr uint32_t SwapchainLength = 3;
+
+    constexpr const char* InteractionProfile = "/interaction_profiles/khr/simple_controller";
+
+    constexpr std::array<const char*, 3> SupportedExtensions = {
+        XR_KHR_D3D11_ENABLE_EXTENSION_NAME,
+        XR_KHR_D3D12_ENABLE_EXTENSION_NAME,
+        XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME,
+    };
+
+    constexpr std::array<DXGI_FORMAT, 5> SwapchainFormats = {
+        DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+        DXGI_FORMAT_R8G8B8A8_UNORM,
+        DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,
+        DXGI_FORMAT_D32_FLOAT,
+        DXGI_FORMAT_D24_UNORM_S8_UINT,
+    };
+
+    // Only one of the two lists of images is populated, depending on the graphics API of the session.
+    struct Swapchain {
+        std::vector<ComPtr<ID3D11Texture2D>> d3d11Images;
+        std::vector<ComPtr<ID3D12Resource>> d3d12Images;
+        uint32_t imageCount{0};
+        uint32_t nextImage{0};
+        std::deque<uint32_t> acquiredImages;
+    };
+
+    // All the state of the runtime. The API layer may call into the runtime from its own threads.
+    struct Runtime {
+        std::mutex mutex;
+
+        ComPtr<IDXGIAdapter1> adapter;
+        uint64_t nextHandle{1};
+
+        bool shareableImages{true};
+
+        XrSession session{XR_NULL_HANDLE};
+        ComPtr<ID3D11Device> d3d11Device;
+        ComPtr<ID3D12Device> d3d12Device;
+        std::deque<XrSessionState> pendingStates;
+        XrTime frameTime{0};
+
+        std::unordered_map<std::string, XrPath> paths;
+        std::vector<std::string> pathStrings;
+
+        std::unordered_map<uint64_t, Swapchain> swapchains;
+    };
+
+    Runtime g_runtime;
+
+    template <typename T>
+    T newHandle() {
+        return (T)(g_runtime.nextHandle++);
+    }
+
+    template <typename T>
+    uint64_t handleValue(T handle) {
+        return (uint64_t)handle;
+    }
+
+    XrPath internPath(const std::string& path) {
+        const auto it = g_runtime.paths.find(path);
+        if (it != g_runtime.paths.cend()) {
+            return it->second;
+        }
+
+        g_runtime.pathStrings.push_back(path);
+        const XrPath value = g_runtime.pathStrings.size();
+        g_runtime.paths.insert_or_assign(path, value);
+        return value;
+    }
+
+    // Implement the two-call idiom for a sequence of known size.
+    template <typename T, typename Fill>
+    XrResult enumerate(uint32_t capacityInput, uint32_t* countOutput, T* outputs, size_t count, Fill fill) {
+        *countOutput = static_cast<uint32_t>(count);
+        if (capacityInput == 0) {
+            return XR_SUCCESS;
+        }
+        if (capacityInput < count) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+        for (size_t i = 0; i < count; i++) {
+            fill(outputs[i], i);
+        }
+        return XR_SUCCESS;
+    }
+
+    XrPosef identityPose() {
+        XrPosef pose{};
+        pose.orientation.w = 1.f;
+        return pose;
+    }
+
+    bool isDepthFormat(DXGI_FORMAT format) {
+        return format == DXGI_FORMAT_D32_FLOAT || format == DXGI_FORMAT_D24_UNORM_S8_UINT;
+    }
+
+    // Depth textures that are also sampled must be created with a typeless format.
+    DXGI_FORMAT getTypelessDepthFormat(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_D32_FLOAT:
+            return DXGI_FORMAT_R32_TYPELESS;
+        case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            return DXGI_FORMAT_R24G8_TYPELESS;
+        default:
+            return format;
+        }
+    }
+
+    XrResult XRAPI_CALL xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                               uint32_t propertyCapacityInput,
+                                                               uint32_t* propertyCountOutput,
+                                                               XrExtensionProperties* properties) {
+        return enumerate(propertyCapacityInput,
+                         propertyCountOutput,
+                         properties,
+                         SupportedExtensions.size(),
+                         [](XrExtensionProperties& property, size_t i) {
+                             strcpy(property.extensionName, SupportedExtensions[i]);
+                             property.extensionVersion = 1;
+                         });
+    }
+
+    XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+        strcpy(instanceProperties->runtimeName, "Mock Runtime");
+        instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+        if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+            return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+        }
+
+        *systemId = 1;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystemProperties(XrInstance instance,
+                                              XrSystemId systemId,
+                                              XrSystemProperties* properties) {
+        properties->systemId = systemId;
+        properties->vendorId = 0;
+        strcpy(properties->systemName, "Mock Headset");
+        properties->graphicsProperties.maxSwapchainImageWidth = 4096;
+        properties->graphicsProperties.maxSwapchainImageHeight = 4096;
+        properties->graphicsProperties.maxLayerCount = XR_MIN_COMPOSITION_LAYERS_SUPPORTED;
+        properties->trackingProperties.orientationTracking = XR_TRUE;
+        properties->trackingProperties.positionTracking = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetD3D11GraphicsRequirementsKHR(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrGraphicsRequirementsD3D11KHR* graphicsRequirements) {
+        DXGI_ADAPTER_DESC1 desc{};
+        CHECK_HRCMD(g_runtime.adapter->GetDesc1(&desc));
+        graphicsRequirements->adapterLuid = desc.AdapterLuid;
+        graphicsRequirements->minFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetD3D12GraphicsRequirementsKHR(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrGraphicsRequirementsD3D12KHR* graphicsRequirements) {
+        DXGI_ADAPTER_DESC1 desc{};
+        CHECK_HRCMD(g_runtime.adapter->GetDesc1(&desc));
+        graphicsRequirements->adapterLuid = desc.AdapterLuid;
+        graphicsRequirements->minFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateViewConfigurations(XrInstance instance,
+                                                      XrSystemId systemId,
+                                                      uint32_t viewConfigurationTypeCapacityInput,
+                                                      uint32_t* viewConfigurationTypeCountOutput,
+                                                      XrViewConfigurationType* viewConfigurationTypes) {
+        return enumerate(viewConfigurationTypeCapacityInput,
+                         viewConfigurationTypeCountOutput,
+                         viewConfigurationTypes,
+                         1,
+                         [](XrViewConfigurationType& type, size_t i) {
+                             type = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+                         });
+    }
+
+    XrResult XRAPI_CALL xrEnumerateViewConfigurationViews(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrViewConfigurationType viewConfigurationType,
+                                                          uint32_t viewCapacityInput,
+                                                          uint32_t* viewCountOutput,
+                                                          XrViewConfigurationView* views) {
+        return enumerate(viewCapacityInput, viewCountOutput, views, 2, [](XrViewConfigurationView& view, size_t i) {
+            view.recommendedImageRectWidth = view.maxImageRectWidth = 1440;
+            view.recommendedImageRectHeight = view.maxImageRectHeight = 1584;
+            view.recommendedSwapchainSampleCount = view.maxSwapchainSampleCount = 1;
+        });
+    }
+
+    XrResult XRAPI_CALL xrCreateSession(XrInstance instance,
+                                        const XrSessionCreateInfo* createInfo,
+                                        XrSession* session) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        if (g_runtime.session != XR_NULL_HANDLE) {
+            return XR_ERROR_LIMIT_REACHED;
+        }
+
+        const XrBaseInStructure* entry = reinterpret_cast<const XrBaseInStructure*>(createInfo->next);
+        while (entry) {
+            if (entry->type == XR_TYPE_GRAPHICS_BINDING_D3D11_KHR) {
+                g_runtime.d3d11Device = reinterpret_cast<const XrGraphicsBindingD3D11KHR*>(entry)->device;
+                break;
+            }
+            if (entry->type == XR_TYPE_GRAPHICS_BINDING_D3D12_KHR) {
+                g_runtime.d3d12Device = reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry)->device;
+                break;
+            }
+            entry = entry->next;
+        }
+        if (!entry) {
+            return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+        }
+
+        g_runtime.session = *session = newHandle<XrSession>();
+        g_runtime.pendingStates.push_back(XR_SESSION_STATE_READY);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySession(XrSession session) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        g_runtime.swapchains.clear();
+        g_runtime.pendingStates.clear();
+        g_runtime.d3d11Device.Reset();
+        g_runtime.d3d12Device.Reset();
+        g_runtime.session = XR_NULL_HANDLE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        if (g_runtime.pendingStates.empty()) {
+            return XR_EVENT_UNAVAILABLE;
+        }
+
+        XrEventDataSessionStateChanged* const event = reinterpret_cast<XrEventDataSessionStateChanged*>(eventData);
+        *event = {XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED};
+        event->session = g_runtime.session;
+        event->state = g_runtime.pendingStates.front();
+        event->time = g_runtime.frameTime;
+        g_runtime.pendingStates.pop_front();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        g_runtime.pendingStates.push_back(XR_SESSION_STATE_SYNCHRONIZED);
+        g_runtime.pendingStates.push_back(XR_SESSION_STATE_VISIBLE);
+        g_runtime.pendingStates.push_back(XR_SESSION_STATE_FOCUSED);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEndSession(XrSession session) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        g_runtime.frameTime += FramePeriod;
+        frameState->predictedDisplayTime = g_runtime.frameTime;
+        frameState->predictedDisplayPeriod = FramePeriod;
+        frameState->shouldRender = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+        if (frameEndInfo->layerCount > XR_MIN_COMPOSITION_LAYERS_SUPPORTED) {
+            return XR_ERROR_LAYER_LIMIT_EXCEEDED;
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrLocateViews(XrSession session,
+                                      const XrViewLocateInfo* viewLocateInfo,
+                                      XrViewState* viewState,
+                                      uint32_t viewCapacityInput,
+                                      uint32_t* viewCountOutput,
+                                      XrView* views) {
+        viewState->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                                    XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+        return enumerate(viewCapacityInput, viewCountOutput, views, 2, [](XrView& view, size_t i) {
+            view.pose = identityPose();
+            view.pose.position.x = i == 0 ? -0.032f : 0.032f;
+            view.fov = {-0.785f, 0.785f, 0.785f, -0.785f};
+        });
+    }
+
+    XrResult XRAPI_CALL xrCreateReferenceSpace(XrSession session,
+                                               const XrReferenceSpaceCreateInfo* createInfo,
+                                               XrSpace* space) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        *space = newHandle<XrSpace>();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateActionSpace(XrSession session,
+                                            const XrActionSpaceCreateInfo* createInfo,
+                                            XrSpace* space) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        *space = newHandle<XrSpace>();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySpace(XrSpace space) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+        location->locationFlags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                                  XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+        location->pose = identityPose();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateSwapchainFormats(XrSession session,
+                                                    uint32_t formatCapacityInput,
+                                                    uint32_t* formatCountOutput,
+                                                    int64_t* formats) {
+        return enumerate(
+            formatCapacityInput, formatCountOutput, formats, SwapchainFormats.size(), [](int64_t& format, size_t i) {
+                format = SwapchainFormats[i];
+            });
+    }
+
+    bool createD3D11Images(const XrSwapchainCreateInfo& createInfo, Swapchain& swapchain) {
+        const DXGI_FORMAT format = (DXGI_FORMAT)createInfo.format;
+
+        D3D11_TEXTURE2D_DESC desc{};
+        desc.Format = format;
+        desc.Width = createInfo.width;
+        desc.Height = createInfo.height;
+        desc.ArraySize = createInfo.arraySize * createInfo.faceCount;
+        desc.MipLevels = createInfo.mipCount;
+        desc.SampleDesc.Count = createInfo.sampleCount;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+            desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            desc.BindFlags |= D3D11_BIND_DEPTH_STENCIL;
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) {
+            desc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+            if (isDepthFormat(format)) {
+                desc.Format = getTypelessDepthFormat(format);
+            }
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
+            desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+        }
+        if (createInfo.faceCount == 6) {
+            desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
+        }
+        // Like the swapchains of a real runtime, which live on the compositor's device.
+        if (g_runtime.shareableImages && desc.SampleDesc.Count == 1) {
+            desc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+        }
+
+        for (uint32_t i = 0; i < SwapchainLength; i++) {
+            ComPtr<ID3D11Texture2D> texture;
+            if (FAILED(g_runtime.d3d11Device->CreateTexture2D(&desc, nullptr, texture.ReleaseAndGetAddressOf()))) {
+                return false;
+            }
+            swapchain.d3d11Images.push_back(texture);
+        }
+        return true;
+    }
+
+    bool createD3D12Images(const XrSwapchainCreateInfo& createInfo, Swapchain& swapchain) {
+        const DXGI_FORMAT format = (DXGI_FORMAT)createInfo.format;
+
+        D3D12_RESOURCE_DESC desc{};
+        desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        desc.Format = format;
+        desc.Width = createInfo.width;
+        desc.Height = createInfo.height;
+        desc.DepthOrArraySize = static_cast<UINT16>(createInfo.arraySize * createInfo.faceCount);
+        desc.MipLevels = static_cast<UINT16>(createInfo.mipCount);
+        desc.SampleDesc.Count = createInfo.sampleCount;
+        desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        // The images are handed to the application in the states required by XR_KHR_D3D12_enable.
+        D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON;
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+            desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+            initialState = D3D12_RESOURCE_STATE_RENDER_TARGET;
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+            initialState = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) {
+            if (isDepthFormat(format)) {
+                desc.Format = getTypelessDepthFormat(format);
+            }
+        } else if (isDepthFormat(format)) {
+            desc.Flags |= D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+        }
+        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
+            desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        }
+
+        D3D12_HEAP_PROPERTIES heapType{};
+        heapType.Type = D3D12_HEAP_TYPE_DEFAULT;
+        heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
+        const D3D12_HEAP_FLAGS heapFlags = g_runtime.shareableImages ? D3D12_HEAP_FLAG_SHARED : D3D12_HEAP_FLAG_NONE;
+        for (uint32_t i = 0; i < SwapchainLength; i++) {
+            ComPtr<ID3D12Resource> texture;
+            const HRESULT hr = g_runtime.d3d12Device->CreateCommittedResource(
+                &heapType, heapFlags, &desc, initialState, nullptr, IID_PPV_ARGS(texture.ReleaseAndGetAddressOf()));
+            if (FAILED(hr)) {
+                return false;
+            }
+            swapchain.d3d12Images.push_back(texture);
+        }
+        return true;
+    }
+
+    XrResult XRAPI_CALL xrCreateSwapchain(XrSession session,
+                                          const XrSwapchainCreateInfo* createInfo,
+                                          XrSwapchain* swapchain) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        const DXGI_FORMAT format = (DXGI_FORMAT)createInfo->format;
+        if (std::find(SwapchainFormats.cbegin(), SwapchainFormats.cend(), format) == SwapchainFormats.cend()) {
+            return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+        }
+
+        Swapchain newSwapchain;
+        const bool created = g_runtime.d3d11Device ? createD3D11Images(*createInfo, newSwapchain)
+                                                   : createD3D12Images(*createInfo, newSwapchain);
+        if (!created) {
+            return XR_ERROR_RUNTIME_FAILURE;
+        }
+        newSwapchain.imageCount = SwapchainLength;
+
+        *swapchain = newHandle<XrSwapchain>();
+        g_runtime.swapchains.insert_or_assign(handleValue(*swapchain), std::move(newSwapchain));
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        return g_runtime.swapchains.erase(handleValue(swapchain)) ? XR_SUCCESS : XR_ERROR_HANDLE_INVALID;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                                   uint32_t imageCapacityInput,
+                                                   uint32_t* imageCountOutput,
+                                                   XrSwapchainImageBaseHeader* images) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        const auto it = g_runtime.swapchains.find(handleValue(swapchain));
+        if (it == g_runtime.swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        const Swapchain& entry = it->second;
+        if (!entry.d3d11Images.empty()) {
+            return enumerate(imageCapacityInput,
+                             imageCountOutput,
+                             reinterpret_cast<XrSwapchainImageD3D11KHR*>(images),
+                             entry.d3d11Images.size(),
+                             [&](XrSwapchainImageD3D11KHR& image, size_t i) {
+                                 image.texture = entry.d3d11Images[i].Get();
+                             });
+        }
+        return enumerate(imageCapacityInput,
+                         imageCountOutput,
+                         reinterpret_cast<XrSwapchainImageD3D12KHR*>(images),
+                         entry.d3d12Images.size(),
+                         [&](XrSwapchainImageD3D12KHR& image, size_t i) {
+                             image.texture = entry.d3d12Images[i].Get();
+                         });
+    }
+
+    XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                uint32_t* index) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        const auto it = g_runtime.swapchains.find(handleValue(swapchain));
+        if (it == g_runtime.swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        Swapchain& entry = it->second;
+        if (entry.acquiredImages.size() >= entry.imageCount) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        *index = entry.nextImage;
+        entry.acquiredImages.push_back(entry.nextImage);
+        entry.nextImage = (entry.nextImage + 1) % entry.imageCount;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageReleaseInfo* releaseInfo) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        const auto it = g_runtime.swapchains.find(handleValue(swapchain));
+        if (it == g_runtime.swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        Swapchain& entry = it->second;
+        if (entry.acquiredImages.empty()) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        entry.acquiredImages.pop_front();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrStringToPath(XrInstance instance, const char* pathString, XrPath* path) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        *path = internPath(pathString);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrPathToString(XrInstance instance,
+                                       XrPath path,
+                                       uint32_t bufferCapacityInput,
+                                       uint32_t* bufferCountOutput,
+                                       char* buffer) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        if (path == XR_NULL_PATH || path > g_runtime.pathStrings.size()) {
+            return XR_ERROR_PATH_INVALID;
+        }
+
+        const std::string& pathString = g_runtime.pathStrings[path - 1];
+        return enumerate(bufferCapacityInput,
+                         bufferCountOutput,
+                         buffer,
+                         pathString.size() + 1,
+                         [&](char& character, size_t i) { character = pathString.c_str()[i]; });
+    }
+
+    XrResult XRAPI_CALL xrCreateActionSet(XrInstance instance,
+                                          const XrActionSetCreateInfo* createInfo,
+                                          XrActionSet* actionSet) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        *actionSet = newHandle<XrActionSet>();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroyActionSet(XrActionSet actionSet) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateAction(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        *action = newHandle<XrAction>();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroyAction(XrAction action) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrSuggestInteractionProfileBindings(
+        XrInstance instance, const XrInteractionProfileSuggestedBinding* suggestedBindings) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetCurrentInteractionProfile(XrSession session,
+                                                       XrPath topLevelUserPath,
+                                                       XrInteractionProfileState* interactionProfile) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        interactionProfile->interactionProfile = internPath(InteractionProfile);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetActionStateBoolean(XrSession session,
+                                                const XrActionStateGetInfo* getInfo,
+                                                XrActionStateBoolean* state) {
+        state->currentState = XR_FALSE;
+        state->changedSinceLastSync = XR_FALSE;
+        state->lastChangeTime = 0;
+        state->isActive = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetActionStateFloat(XrSession session,
+                                              const XrActionStateGetInfo* getInfo,
+                                              XrActionStateFloat* state) {
+        state->currentState = 0.f;
+        state->changedSinceLastSync = XR_FALSE;
+        state->lastChangeTime = 0;
+        state->isActive = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetActionStateVector2f(XrSession session,
+                                                 const XrActionStateGetInfo* getInfo,
+                                                 XrActionStateVector2f* state) {
+        state->currentState = {0.f, 0.f};
+        state->changedSinceLastSync = XR_FALSE;
+        state->lastChangeTime = 0;
+        state->isActive = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetActionStatePose(XrSession session,
+                                             const XrActionStateGetInfo* getInfo,
+                                             XrActionStatePose* state) {
+        state->isActive = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrApplyHapticFeedback(XrSession session,
+                                              const XrHapticActionInfo* hapticActionInfo,
+                                              const XrHapticBaseHeader* hapticFeedback) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrStopHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo) {
+        return XR_SUCCESS;
+    }
+
+#define MOCK_FUNCTION(name) {#name, reinterpret_cast<PFN_xrVoidFunction>(name)}
+
+    const std::unordered_map<std::string_view, PFN_xrVoidFunction> Functions = {
+        MOCK_FUNCTION(xrEnumerateInstanceExtensionProperties),
+        MOCK_FUNCTION(xrDestroyInstance),
+        MOCK_FUNCTION(xrGetInstanceProperties),
+        MOCK_FUNCTION(xrGetSystem),
+        MOCK_FUNCTION(xrGetSystemProperties),
+        MOCK_FUNCTION(xrGetD3D11GraphicsRequirementsKHR),
+        MOCK_FUNCTION(xrGetD3D12GraphicsRequirementsKHR),
+        MOCK_FUNCTION(xrEnumerateViewConfigurations),
+        MOCK_FUNCTION(xrEnumerateViewConfigurationViews),
+        MOCK_FUNCTION(xrCreateSession),
+        MOCK_FUNCTION(xrDestroySession),
+        MOCK_FUNCTION(xrPollEvent),
+        MOCK_FUNCTION(xrBeginSession),
+        MOCK_FUNCTION(xrEndSession),
+        MOCK_FUNCTION(xrWaitFrame),
+        MOCK_FUNCTION(xrBeginFrame),
+        MOCK_FUNCTION(xrEndFrame),
+        MOCK_FUNCTION(xrLocateViews),
+        MOCK_FUNCTION(xrCreateReferenceSpace),
+        MOCK_FUNCTION(xrCreateActionSpace),
+        MOCK_FUNCTION(xrDestroySpace),
+        MOCK_FUNCTION(xrLocateSpace),
+        MOCK_FUNCTION(xrEnumerateSwapchainFormats),
+        MOCK_FUNCTION(xrCreateSwapchain),
+        MOCK_FUNCTION(xrDestroySwapchain),
+        MOCK_FUNCTION(xrEnumerateSwapchainImages),
+        MOCK_FUNCTION(xrAcquireSwapchainImage),
+        MOCK_FUNCTION(xrWaitSwapchainImage),
+        MOCK_FUNCTION(xrReleaseSwapchainImage),
+        MOCK_FUNCTION(xrStringToPath),
+        MOCK_FUNCTION(xrPathToString),
+        MOCK_FUNCTION(xrCreateActionSet),
+        MOCK_FUNCTION(xrDestroyActionSet),
+        MOCK_FUNCTION(xrCreateAction),
+        MOCK_FUNCTION(xrDestroyAction),
+        MOCK_FUNCTION(xrSuggestInteractionProfileBindings),
+        MOCK_FUNCTION(xrAttachSessionActionSets),
+        MOCK_FUNCTION(xrGetCurrentInteractionProfile),
+        MOCK_FUNCTION(xrSyncActions),
+        MOCK_FUNCTION(xrGetActionStateBoolean),
+        MOCK_FUNCTION(xrGetActionStateFloat),
+        MOCK_FUNCTION(xrGetActionStateVector2f),
+        MOCK_FUNCTION(xrGetActionStatePose),
+        MOCK_FUNCTION(xrApplyHapticFeedback),
+        MOCK_FUNCTION(xrStopHapticFeedback),
+    };
+
+#undef MOCK_FUNCTION
+
+} // namespace
+
+namespace benchmark::mock_runtime {
+
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+        const auto it = Functions.find(name);
+        if (it == Functions.cend()) {
+            *function = nullptr;
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
+        }
+
+        *function = it->second;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++) {
+            const std::string_view extensionName(createInfo->enabledExtensionNames[i]);
+            if (std::find(SupportedExtensions.cbegin(), SupportedExtensions.cend(), extensionName) ==
+                SupportedExtensions.cend()) {
+                return XR_ERROR_EXTENSION_NOT_PRESENT;
+            }
+        }
+
+        *instance = newHandle<XrInstance>();
+        return XR_SUCCESS;
+    }
+
+    void selectAdapter(bool useWarp) {
+        ComPtr<IDXGIFactory4> dxgiFactory;
+        CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
+        if (useWarp) {
+            CHECK_HRCMD(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(g_runtime.adapter.ReleaseAndGetAddressOf())));
+        } else {
+            CHECK_HRCMD(dxgiFactory->EnumAdapters1(0, g_runtime.adapter.ReleaseAndGetAddressOf()));
+        }
+    }
+
+    IDXGIAdapter1* getAdapter() {
+        return g_runtime.adapter.Get();
+    }
+
+    void setShareableImages(bool shareable) {
+        std::unique_lock lock(g_runtime.mutex);
+
+        g_runtime.shareableImages = shareable;
+    }
+
+} // namespace benchmark::mock_runtime
@@ -0,0 +1,49 @@
+// MIT License
+//
+// << insert your own copyright here >>
+//
+// Based on https://github.com/mbucchia/OpenXR-Layer-Template.
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace benchmark::mock_runtime {
+
+    // A headless OpenXR runtime that sits at the bottom of the API layer chain. It implements the instance, session,
+    // frame loop, swapchain and action functions used by the API layer and its frameworks. Swapchain images are D3D11
+    // or D3D12 textures created on the application's device, and every call completes immediately: the frame loop is
+    // not paced and the tracking always reports identity poses.
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance);
+
+    // Select the adapter reported by xrGetD3D11GraphicsRequirementsKHR() and xrGetD3D12GraphicsRequirementsKHR(),
+    // either the first hardware adapter or the software (WARP) adapter. The application must create its device on that
+    // adapter.
+    void selectAdapter(bool useWarp);
+    IDXGIAdapter1* getAdapter();
+
+    // Whether the swapchain images created from now on can be opened on another device. Runtimes whose compositor
+    // cannot share its textures force the composition framework to copy through a bounce buffer.
+    void setShareableImages(bool shareable);
+
+} // namespace benchmark::mock_runtime
@@ -26,9 +26,333 @@
 
 #include "dispatch.h"
 #include "log.h"
+#include "profiles.h"
 
 using namespace openxr_api_layer::log;
 
+namespace {
+
+    using namespace openxr_api_layer;
+
+    // The capabilities of the runtime and the layers below ours, persisted across launches.
+    struct CapabilityCache {
+        std::string runtime;
+        std::string systemName;
+        std::vector<std::string> extensions;
+    };
+
+    constexpr std::string_view CapabilityCacheVersion = "2";
+
+    std::filesystem::path getCapabilityCachePath() {
+        return localAppData / (LayerName + ".cache");
+    }
+
+    // Find the runtime library referenced by a runtime manifest. This is not a full JSON parser, but the manifests
+    // only contain plain strings.
+    std::filesystem::path getRuntimeLibraryPath(const std::filesystem::path& runtimeManifest) {
+        std::ifstream file(runtimeManifest);
+        if (!file.is_open()) {
+            return {};
+        }
+        const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const size_t keyPosition = contents.find("\"library_path\"");
+        if (keyPosition == std::string::npos) {
+            return {};
+        }
+        const size_t separatorPosition = contents.find(':', keyPosition);
+        const size_t startPosition =
+            separatorPosition != std::string::npos ? contents.find('"', separatorPosition) : std::string::npos;
+        if (startPosition == std::string::npos) {
+            return {};
+        }
+
+        std::string libraryPath;
+        for (size_t i = startPosition + 1; i < contents.size() && contents[i] != '"'; i++) {
+            if (contents[i] == '\\' && i + 1 < contents.size()) {
+                i++;
+            }
+            libraryPath += contents[i];
+        }
+
+        // Relative paths are relative to the manifest.
+        const std::filesystem::path path(libraryPath);
+        return path.is_relative() ? runtimeManifest.parent_path() / path : path;
+    }
+
+    // The cache is valid as long as the active runtime, the layers in the chain and the graphics adapters remain the
+    // same. The runtime name and version are not known until an instance is created, therefore the runtime is
+    // identified by its manifest and the library it points to, which is rewritten whenever the runtime is updated.
+    // Adapters are identified by their model and driver version.
+    std::string getCapabilityCacheKey(const XrApiLayerCreateInfo* apiLayerInfo) {
+        std::string runtimeManifest;
+        if (const char* const runtimeOverride = getenv("XR_RUNTIME_JSON")) {
+            runtimeManifest = runtimeOverride;
+        } else {
+            char buffer[_MAX_PATH]{};
+            DWORD bufferSize = sizeof(buffer);
+            if (RegGetValueA(HKEY_LOCAL_MACHINE,
+                             "SOFTWARE\\Khronos\\OpenXR\\1",
+                             "ActiveRuntime",
+                             RRF_RT_REG_SZ,
+                             nullptr,
+                             buffer,
+                             &bufferSize) == ERROR_SUCCESS) {
+                runtimeManifest = buffer;
+            }
+        }
+
+        std::error_code ec;
+        const auto manifestTime = std::filesystem::last_write_time(runtimeManifest, ec);
+        std::string key = fmt::format("{}|{}", runtimeManifest, ec ? 0 : manifestTime.time_since_epoch().count());
+
+        const std::filesystem::path runtimeLibrary = getRuntimeLibraryPath(runtimeManifest);
+        const auto libraryTime = std::filesystem::last_write_time(runtimeLibrary, ec);
+        const uintmax_t librarySize = ec ? 0 : std::filesystem::file_size(runtimeLibrary, ec);
+        key += fmt::format("|{}|{}|{}",
+                           runtimeLibrary.string(),
+                           ec ? 0 : libraryTime.time_since_epoch().count(),
+                           ec ? 0 : librarySize);
+
+        ComPtr<IDXGIFactory1> dxgiFactory;
+        if (SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())))) {
+            ComPtr<IDXGIAdapter1> dxgiAdapter;
+            for (UINT adapterIndex = 0;
+                 dxgiFactory->EnumAdapters1(adapterIndex, dxgiAdapter.ReleaseAndGetAddressOf()) == S_OK;
+                 adapterIndex++) {
+                DXGI_ADAPTER_DESC1 desc{};
+                LARGE_INTEGER driverVersion{};
+                if (FAILED(dxgiAdapter->GetDesc1(&desc)) || (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE)) {
+                    continue;
+                }
+                dxgiAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+                key += fmt::format("|{:04x}:{:04x}:{}", desc.VendorId, desc.DeviceId, driverVersion.QuadPart);
+            }
+        }
+
+        auto info = apiLayerInfo->nextInfo->next;
+        while (info) {
+            key += fmt::format("|{}", info->layerName);
+            info = info->next;
+        }
+
+        return key;
+    }
+
+    std::optional<CapabilityCache> loadCapabilityCache(const std::string& key) {
+        std::ifstream file(getCapabilityCachePath());
+        if (!file.is_open()) {
+            return {};
+        }
+
+        std::string line;
+        if (!std::getline(file, line) || line != CapabilityCacheVersion || !std::getline(file, line) || line != key) {
+            return {};
+        }
+
+        CapabilityCache cache;
+        if (!std::getline(file, cache.runtime) || !std::getline(file, cache.systemName)) {
+            return {};
+        }
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                cache.extensions.push_back(line);
+            }
+        }
+        return cache;
+    }
+
+    void storeCapabilityCache(const std::string& key, const CapabilityCache& cache) {
+        // Write to a temporary file first, so that a concurrent launch never reads a partial cache.
+        const std::filesystem::path path = getCapabilityCachePath();
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += fmt::format(".{}", GetCurrentProcessId());
+        {
+            std::ofstream file(temporaryPath, std::ios_base::trunc);
+            if (!file.is_open()) {
+                return;
+            }
+            file << CapabilityCacheVersion << "\n" << key << "\n" << cache.runtime << "\n" << cache.systemName << "\n";
+            for (const std::string& extension : cache.extensions) {
+                file << extension << "\n";
+            }
+        }
+        if (!MoveFileExA(temporaryPath.string().c_str(), path.string().c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            std::error_code ec;
+            std::filesystem::remove(temporaryPath, ec);
+        }
+    }
+
+    void invalidateCapabilityCache() {
+        std::error_code ec;
+        std::filesystem::remove(getCapabilityCachePath(), ec);
+    }
+
+    std::vector<std::string> filterImplicitExtensions(const std::vector<std::string>& supportedExtensions) {
+        std::vector<std::string> filteredImplicitExtensions;
+        for (const std::string& extensionName : implicitExtensions) {
+            if (std::find(supportedExtensions.cbegin(), supportedExtensions.cend(), extensionName) !=
+                supportedExtensions.cend()) {
+                filteredImplicitExtensions.push_back(extensionName);
+            } else {
+                Log(fmt::format("Cannot satisfy implicit extension request: {}\n", extensionName));
+            }
+        }
+        return filteredImplicitExtensions;
+    }
+
+    std::optional<std::vector<std::string>>
+    enumerateExtensionsWithDummyInstance(const XrInstanceCreateInfo* const instanceCreateInfo,
+                                         const struct XrApiLayerCreateInfo* const apiLayerInfo) {
+        std::optional<std::vector<std::string>> supportedExtensions;
+
+        XrInstance dummyInstance = XR_NULL_HANDLE;
+
+        // Call the chain to create a dummy instance. Request no extensions in order to speed things up.
+        XrInstanceCreateInfo dummyCreateInfo = *instanceCreateInfo;
+        dummyCreateInfo.enabledExtensionCount = 0;
+
+        XrApiLayerCreateInfo chainApiLayerInfo = *apiLayerInfo;
+        chainApiLayerInfo.nextInfo = apiLayerInfo->nextInfo->next;
+
+        if (XR_SUCCEEDED(apiLayerInfo->nextInfo->nextCreateApiLayerInstance(
+                &dummyCreateInfo, &chainApiLayerInfo, &dummyInstance))) {
+            PFN_xrDestroyInstance xrDestroyInstance;
+            CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                dummyInstance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&xrDestroyInstance)));
+            PFN_xrGetSystem xrGetSystem = nullptr;
+            CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                dummyInstance, "xrGetSystem", reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystem)));
+            PFN_xrGetSystemProperties xrGetSystemProperties = nullptr;
+            CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                dummyInstance,
+                "xrGetSystemProperties",
+                reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystemProperties)));
+
+            // Check the available extensions.
+            PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties;
+            CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                dummyInstance,
+                "xrEnumerateInstanceExtensionProperties",
+                reinterpret_cast<PFN_xrVoidFunction*>(&xrEnumerateInstanceExtensionProperties)));
+
+            uint32_t extensionsCount = 0;
+            CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionsCount, nullptr));
+            std::vector<XrExtensionProperties> extensions(extensionsCount, {XR_TYPE_EXTENSION_PROPERTIES});
+            CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(
+                nullptr, extensionsCount, &extensionsCount, extensions.data()));
+
+            supportedExtensions.emplace();
+            for (const XrExtensionProperties& properties : extensions) {
+                supportedExtensions->push_back(properties.extensionName);
+            }
+
+            // Workaround: the Vive runtime does not seem to like our flow of destroying the instance
+            // mid-initialization. We skip destruction and we will just create a second instance.
+            if (xrGetSystem && xrGetSystemProperties) {
+                XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
+                getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                XrSystemId systemId;
+                if (XR_SUCCEEDED(xrGetSystem(dummyInstance, &getInfo, &systemId))) {
+                    XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES};
+                    CHECK_XRCMD(xrGetSystemProperties(dummyInstance, systemId, &systemProperties));
+                    if (std::string(systemProperties.systemName).find("Vive Reality system") != std::string::npos) {
+                        xrDestroyInstance = nullptr;
+                    }
+                }
+            }
+
+            if (xrDestroyInstance) {
+                xrDestroyInstance(dummyInstance);
+            }
+        }
+
+        return supportedExtensions;
+    }
+
+    // Query the capabilities through the real instance, which does not require a dummy instance, and update the cache
+    // for the next launch if they changed.
+    void refreshCapabilityCache(const std::string& key,
+                                const std::optional<CapabilityCache>& cached,
+                                PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr,
+                                XrInstance instance) {
+        TraceLocalActivity(local);
+        TraceLoggingWriteStart(local, "RefreshCapabilityCache");
+
+        PFN_xrGetInstanceProperties xrGetInstanceProperties = nullptr;
+        PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties = nullptr;
+        PFN_xrGetSystem xrGetSystem = nullptr;
+        PFN_xrGetSystemProperties xrGetSystemProperties = nullptr;
+        if (XR_FAILED(xrGetInstanceProcAddr(instance,
+                                            "xrGetInstanceProperties",
+                                            reinterpret_cast<PFN_xrVoidFunction*>(&xrGetInstanceProperties))) ||
+            XR_FAILED(xrGetInstanceProcAddr(
+                instance,
+                "xrEnumerateInstanceExtensionProperties",
+                reinterpret_cast<PFN_xrVoidFunction*>(&xrEnumerateInstanceExtensionProperties))) ||
+            XR_FAILED(xrGetInstanceProcAddr(
+                instance, "xrGetSystem", reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystem))) ||
+            XR_FAILED(xrGetInstanceProcAddr(instance,
+                                            "xrGetSystemProperties",
+                                            reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystemProperties)))) {
+            TraceLoggingWriteStop(local, "RefreshCapabilityCache", TLArg(false, "Refreshed"));
+            return;
+        }
+
+        CapabilityCache cache;
+
+        XrInstanceProperties instanceProperties{XR_TYPE_INSTANCE_PROPERTIES};
+        if (XR_SUCCEEDED(xrGetInstanceProperties(instance, &instanceProperties))) {
+            cache.runtime = fmt::format("{} {}.{}.{}",
+                                        instanceProperties.runtimeName,
+                                        XR_VERSION_MAJOR(instanceProperties.runtimeVersion),
+                                        XR_VERSION_MINOR(instanceProperties.runtimeVersion),
+                                        XR_VERSION_PATCH(instanceProperties.runtimeVersion));
+        }
+
+        XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
+        getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        XrSystemId systemId;
+        XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES};
+        if (XR_SUCCEEDED(xrGetSystem(instance, &getInfo, &systemId)) &&
+            XR_SUCCEEDED(xrGetSystemProperties(instance, systemId, &systemProperties))) {
+            cache.systemName = systemProperties.systemName;
+        } else if (cached) {
+            // The headset might just be unavailable at the moment.
+            cache.systemName = cached->systemName;
+        }
+
+        uint32_t extensionsCount = 0;
+        if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionsCount, nullptr))) {
+            TraceLoggingWriteStop(local, "RefreshCapabilityCache", TLArg(false, "Refreshed"));
+            return;
+        }
+        std::vector<XrExtensionProperties> extensions(extensionsCount, {XR_TYPE_EXTENSION_PROPERTIES});
+        if (XR_FAILED(xrEnumerateInstanceExtensionProperties(
+                nullptr, extensionsCount, &extensionsCount, extensions.data()))) {
+            TraceLoggingWriteStop(local, "RefreshCapabilityCache", TLArg(false, "Refreshed"));
+            return;
+        }
+        for (const XrExtensionProperties& properties : extensions) {
+            cache.extensions.push_back(properties.extensionName);
+        }
+
+        const bool isStale = !cached || cached->runtime != cache.runtime || cached->systemName != cache.systemName ||
+                             cached->extensions != cache.extensions;
+        if (isStale) {
+            storeCapabilityCache(key, cache);
+        }
+
+        TraceLoggingWriteStop(local,
+                              "RefreshCapabilityCache",
+                              TLArg(true, "Refreshed"),
+                              TLArg(cache.runtime.c_str(), "Runtime"),
+                              TLArg(cache.systemName.c_str(), "SystemName"),
+                              TLArg(isStale, "Stale"));
+    }
+
+} // namespace
+
 namespace openxr_api_layer {
 
     // Entry point for creating the layer.
@@ -50,6 +374,9 @@ namespace openxr_api_layer {
             return XR_ERROR_INITIALIZATION_FAILED;
         }
 
+        // Moves logging to the background thread until the instance is destroyed (see ResetInstance()).
+        StartLogging();
+
         // Dump the other layers.
         {
             auto info = apiLayerInfo->nextInfo;
@@ -60,82 +387,37 @@ namespace openxr_api_layer {
             }
         }
 
+        // Decide what to do with the application before doing any work on its behalf. A bypassed application gets its
+        // instance created untouched.
+        const profiles::Profile& profile = profiles::Lookup(instanceCreateInfo->applicationInfo);
+
         // Only request implicit extensions that are supported.
         //
         // While the OpenXR standard states that xrEnumerateInstanceExtensionProperties() can be queried without an
         // instance, this does not stand for API layers, since API layers implementation might rely on the next
         // xrGetInstanceProcAddr() pointer, which is not (yet) populated if no instance is created.
-        // We create a dummy instance in order to do these checks.
+        // We create a dummy instance in order to do these checks, unless the results of a previous launch with the
+        // same runtime, layers and adapters were cached. A cache hit is revalidated against the real instance once it
+        // is created (see refreshCapabilityCache()), so a stale entry is used for at most one launch: an extension
+        // that is no longer supported fails the instance creation and is retried below with a dummy instance, while
+        // an extension that became supported is only requested starting with the next launch.
+        std::string capabilityCacheKey;
+        std::optional<CapabilityCache> capabilityCache;
         std::vector<std::string> filteredImplicitExtensions;
-        if (!implicitExtensions.empty()) {
-            XrInstance dummyInstance = XR_NULL_HANDLE;
-
-            // Call the chain to create a dummy instance. Request no extensions in order to speed things up.
-            XrInstanceCreateInfo dummyCreateInfo = *instanceCreateInfo;
-            dummyCreateInfo.enabledExtensionCount = 0;
-
-            XrApiLayerCreateInfo chainApiLayerInfo = *apiLayerInfo;
-            chainApiLayerInfo.nextInfo = apiLayerInfo->nextInfo->next;
-
-            if (XR_SUCCEEDED(apiLayerInfo->nextInfo->nextCreateApiLayerInstance(
-                    &dummyCreateInfo, &chainApiLayerInfo, &dummyInstance))) {
-                PFN_xrDestroyInstance xrDestroyInstance;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&xrDestroyInstance)));
-                PFN_xrGetSystem xrGetSystem = nullptr;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance, "xrGetSystem", reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystem)));
-                PFN_xrGetSystemProperties xrGetSystemProperties = nullptr;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance,
-                    "xrGetSystemProperties",
-                    reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystemProperties)));
-
-                // Check the available extensions.
-                PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance,
-                    "xrEnumerateInstanceExtensionProperties",
-                    reinterpret_cast<PFN_xrVoidFunction*>(&xrEnumerateInstanceExtensionProperties)));
-
-                uint32_t extensionsCount = 0;
-                CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionsCount, nullptr));
-                std::vector<XrExtensionProperties> extensions(extensionsCount, {XR_TYPE_EXTENSION_PROPERTIES});
-                CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(
-                    nullptr, extensionsCount, &extensionsCount, extensions.data()));
-
-                for (const std::string& extensionName : implicitExtensions) {
-                    const auto matchExtensionName = [&](const XrExtensionProperties& properties) {
-                        return properties.extensionName == extensionName;
-                    };
-                    if (std::find_if(extensions.cbegin(), extensions.cend(), matchExtensionName) != extensions.cend()) {
-                        filteredImplicitExtensions.push_back(extensionName);
-                    } else {
-                        Log(fmt::format("Cannot satisfy implicit extension request: {}\n", extensionName));
-                    }
-                }
-
-                // Workaround: the Vive runtime does not seem to like our flow of destroying the instance
-                // mid-initialization. We skip destruction and we will just create a second instance.
-                if (xrGetSystem && xrGetSystemProperties) {
-                    XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
-                    getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
-                    XrSystemId systemId;
-                    if (XR_SUCCEEDED(xrGetSystem(dummyInstance, &getInfo, &systemId))) {
-                        XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES};
-                        CHECK_XRCMD(xrGetSystemProperties(dummyInstance, systemId, &systemProperties));
-                        if (std::string(systemProperties.systemName).find("Vive Reality system") != std::string::npos) {
-                            xrDestroyInstance = nullptr;
-                        }
-                    }
-                }
-
-                if (xrDestroyInstance) {
-                    xrDestroyInstance(dummyInstance);
-                }
+        if (!profile.bypass && !implicitExtensions.empty()) {
+            capabilityCacheKey = getCapabilityCacheKey(apiLayerInfo);
+            capabilityCache = loadCapabilityCache(capabilityCacheKey);
+            if (capabilityCache) {
+                TraceLoggingWriteTagged(local,
+                                        "xrCreateApiLayerInstance_CapabilityCacheHit",
+                                        TLArg(capabilityCache->runtime.c_str(), "Runtime"));
+                filteredImplicitExtensions = filterImplicitExtensions(capabilityCache->extensions);
+            } else {
+                filteredImplicitExtensions =
+                    filterImplicitExtensions(enumerateExtensionsWithDummyInstance(instanceCreateInfo, apiLayerInfo)
+                                                 .value_or(std::vector<std::string>{}));
             }
         }
-
         // Dump the requested extensions.
         XrInstanceCreateInfo chainInstanceCreateInfo = *instanceCreateInfo;
         std::vector<const char*> newEnabledExtensionNames;
@@ -143,13 +425,15 @@ namespace openxr_api_layer {
             const std::string_view ext(chainInstanceCreateInfo.enabledExtensionNames[i]);
             TraceLoggingWriteTagged(local, "xrCreateApiLayerInstance", TLArg(ext.data(), "ExtensionName"));
 
-            if (std::find(blockedExtensions.cbegin(), blockedExtensions.cend(), ext) == blockedExtensions.cend()) {
+            if (profile.bypass ||
+                std::find(blockedExtensions.cbegin(), blockedExtensions.cend(), ext) == blockedExtensions.cend()) {
                 Log(fmt::format("Requested extension: {}\n", ext));
                 newEnabledExtensionNames.push_back(ext.data());
             } else {
                 Log(fmt::format("Blocking extension: {}\n", ext));
             }
         }
+        const size_t requestedExtensionsCount = newEnabledExtensionNames.size();
         for (const auto& ext : filteredImplicitExtensions) {
             Log(fmt::format("Requesting extension: {}\n", ext));
             newEnabledExtensionNames.push_back(ext.c_str());
@@ -162,7 +446,34 @@ namespace openxr_api_layer {
         chainApiLayerInfo.nextInfo = apiLayerInfo->nextInfo->next;
         XrResult result =
             apiLayerInfo->nextInfo->nextCreateApiLayerInstance(&chainInstanceCreateInfo, &chainApiLayerInfo, instance);
+        if (result == XR_ERROR_EXTENSION_NOT_PRESENT && capabilityCache) {
+            // The cache is out-of-date. Do the checks with a dummy instance and try again.
+            Log("Capability cache is out-of-date\n");
+            invalidateCapabilityCache();
+            capabilityCache.reset();
+
+            filteredImplicitExtensions =
+                filterImplicitExtensions(enumerateExtensionsWithDummyInstance(instanceCreateInfo, apiLayerInfo)
+                                             .value_or(std::vector<std::string>{}));
+            newEnabledExtensionNames.resize(requestedExtensionsCount);
+            for (const auto& ext : filteredImplicitExtensions) {
+                Log(fmt::format("Requesting extension: {}\n", ext));
+                newEnabledExtensionNames.push_back(ext.c_str());
+            }
+            chainInstanceCreateInfo.enabledExtensionNames = newEnabledExtensionNames.data();
+            chainInstanceCreateInfo.enabledExtensionCount = (uint32_t)newEnabledExtensionNames.size();
+
+            result = apiLayerInfo->nextInfo->nextCreateApiLayerInstance(
+                &chainInstanceCreateInfo, &chainApiLayerInfo, instance);
+        }
         if (result == XR_SUCCESS) {
+            if (!profile.bypass && !implicitExtensions.empty()) {
+                refreshCapabilityCache(capabilityCacheKey,
+                                       capabilityCache,
+                                       apiLayerInfo->nextInfo->nextGetInstanceProcAddr,
+                                       *instance);
+            }
+
             // Create our layer.
             openxr_api_layer::GetInstance()->SetGetInstanceProcAddr(apiLayerInfo->nextInfo->nextGetInstanceProcAddr,
                                                                     *instance);
@@ -190,6 +501,9 @@ namespace openxr_api_layer {
         TraceLoggingWriteStop(local, "xrCreateApiLayerInstance", TLArg(xr::ToCString(result), "Result"));
         if (XR_FAILED(result)) {
             ErrorLog(fmt::format("xrCreateApiLayerInstance failed with {}\n", xr::ToCString(result)));
+
+            // There is no instance to destroy, so the logging thread must be stopped here.
+            StopLogging();
         }
 
         return result;
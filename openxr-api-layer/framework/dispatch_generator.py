@@ -22,6 +22,7 @@
 import os
 import re
 import sys
+import textwrap
 
 # Import dependencies from the OpenXR SDK.
 cur_dir = os.path.abspath(os.path.dirname(__file__))
@@ -50,6 +51,22 @@ if 'xrGetInstanceProcAddr' in layer_apis.override_functions:
 if 'xrGetInstanceProcAddr' in layer_apis.requested_functions:
     raise Exception("xrGetInstanceProcAddr() cannot be specified in requested_functions. Use the m_xrGetInstanceProcAddr() class member.")
 
+# Frame timing metrics require intercepting the frame loop.
+frame_timing_functions = {
+    'xrWaitFrame': 'WaitFrame',
+    'xrBeginFrame': 'BeginFrame',
+    'xrEndFrame': 'EndFrame'
+}
+if layer_apis.frame_timing:
+    for func in frame_timing_functions:
+        if func not in layer_apis.override_functions:
+            layer_apis.override_functions.append(func)
+
+# Live settings are polled at the beginning of each frame.
+if layer_apis.live_settings:
+    if 'xrBeginFrame' not in layer_apis.override_functions:
+        layer_apis.override_functions.append('xrBeginFrame')
+
 
 class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
     '''Common generator utilities and formatting.'''
@@ -103,6 +120,92 @@ class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
 
         return arguments_list
 
+    def makeWrapper(self, cur_cmd, instance_expression, prefix=''):
+        '''Make the XRAPI_CALL wrapper forwarding a call to the layer through instance_expression.'''
+        parameters_list = self.makeParametersList(cur_cmd)
+        arguments_list = self.makeArgumentsList(cur_cmd)
+
+        is_frame_timed = layer_apis.frame_timing and cur_cmd.name in frame_timing_functions
+        frame_timing_start = ''
+        frame_timing_stop = ''
+        if is_frame_timed:
+            frame_timing_start = '''
+		const uint64_t metricsStartTime = metrics::Now();'''
+            frame_timing_stop = f'''
+		metrics::RecordFrameCall(metrics::Stage::{frame_timing_functions[cur_cmd.name]}, metricsStartTime, metrics::Now());'''
+
+        settings_poll = ''
+        if layer_apis.live_settings and cur_cmd.name == 'xrBeginFrame':
+            settings_poll = '''
+		settings::Poll();'''
+
+        if cur_cmd.return_type is not None:
+            generated = f'''
+	{prefix}XrResult XRAPI_CALL {cur_cmd.name}({parameters_list})
+	{{
+		TraceLocalActivity(local);
+		TraceLoggingWriteStart(local, "{cur_cmd.name}");{frame_timing_start}{settings_poll}
+
+		XrResult result;
+		try
+		{{
+			result = {instance_expression}{cur_cmd.name}({arguments_list});
+		}}
+		catch (std::exception& exc)
+		{{
+			TraceLoggingWriteTagged(local, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
+			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}}
+{frame_timing_stop}
+		TraceLoggingWriteStop(local, "{cur_cmd.name}", TLArg(xr::ToCString(result), "Result"));
+		if (XR_FAILED(result)) {{
+			ErrorLog(fmt::format("{cur_cmd.name} failed with {{}}\\n", xr::ToCString(result)));
+		}}
+
+		return result;
+	}}
+'''
+        else:
+            generated = f'''
+	{prefix}void XRAPI_CALL {cur_cmd.name}({parameters_list})
+	{{
+		TraceLocalActivity(local);
+		TraceLoggingWriteStart(local, "{cur_cmd.name}");
+
+		try
+		{{
+			{instance_expression}{cur_cmd.name}({arguments_list});
+		}}
+		catch (std::exception& exc)
+		{{
+			TraceLoggingWriteTagged(local, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
+			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
+		}}
+
+		TraceLoggingWriteStop(local, "{cur_cmd.name}");
+	}}
+'''
+
+        return generated
+
+    def getInterceptedFunctions(self):
+        '''The functions intercepted by the layer, as (name, is_extension), sorted by name so that they can be looked
+        up with a binary search instead of a chain of string comparisons.'''
+        intercepted = [('xrDestroyInstance', False)]
+        for cur_cmd in self.core_commands:
+            if cur_cmd.name in layer_apis.override_functions + ['xrEnumerateInstanceExtensionProperties']:
+                intercepted.append((cur_cmd.name, False))
+
+        # Always advertise extension functions.
+        for cur_cmd in self.ext_commands:
+            if cur_cmd.name in layer_apis.override_functions:
+                intercepted.append((cur_cmd.name, True))
+
+        intercepted.sort(key=lambda entry: entry[0].encode())
+
+        return intercepted
+
 class DispatchGenCppOutputGenerator(DispatchGenOutputGenerator):
     '''Generator for dispatch.gen.cpp.'''
     def beginFile(self, genOpts):
@@ -113,6 +216,8 @@ class DispatchGenCppOutputGenerator(DispatchGenOutputGenerator):
 
 #include "dispatch.h"
 #include "log.h"
+#include "metrics.h"
+#include "settings.h"
 
 using namespace openxr_api_layer::log;
 
@@ -129,6 +234,9 @@ namespace openxr_api_layer
 
 	void ResetInstance() {
 		g_instance.reset();
+
+		// The logging thread must not outlive the instance, since it cannot be stopped upon DLL_PROCESS_DETACH.
+		StopLogging();
 	}
 
 } // namespace openxr_api_layer
@@ -154,57 +262,8 @@ namespace openxr_api_layer
 
         for cur_cmd in self.core_commands + self.ext_commands:
             if cur_cmd.name in (layer_apis.override_functions + ['xrDestroyInstance', 'xrEnumerateInstanceExtensionProperties']):
-                parameters_list = self.makeParametersList(cur_cmd)
-                arguments_list = self.makeArgumentsList(cur_cmd)
-
-                if cur_cmd.return_type is not None:
-                    generated += f'''
-	XrResult XRAPI_CALL {cur_cmd.name}({parameters_list})
-	{{
-		TraceLocalActivity(local);
-		TraceLoggingWriteStart(local, "{cur_cmd.name}");
-
-		XrResult result;
-		try
-		{{
-			result = openxr_api_layer::GetInstance()->{cur_cmd.name}({arguments_list});
-		}}
-		catch (std::exception& exc)
-		{{
-			TraceLoggingWriteTagged(local, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
-			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
-			result = XR_ERROR_RUNTIME_FAILURE;
-		}}
-
-		TraceLoggingWriteStop(local, "{cur_cmd.name}", TLArg(xr::ToCString(result), "Result"));
-		if (XR_FAILED(result)) {{
-			ErrorLog(fmt::format("{cur_cmd.name} failed with {{}}\\n", xr::ToCString(result)));
-		}}
+                generated += self.makeWrapper(cur_cmd, 'openxr_api_layer::GetInstance()->')
 
-		return result;
-	}}
-'''
-                else:
-                    generated += f'''
-	void XRAPI_CALL {cur_cmd.name}({parameters_list})
-	{{
-		TraceLocalActivity(local);
-		TraceLoggingWriteStart(local, "{cur_cmd.name}");
-
-		try
-		{{
-			openxr_api_layer::GetInstance()->{cur_cmd.name}({arguments_list});
-		}}
-		catch (std::exception& exc)
-		{{
-			TraceLoggingWriteTagged(local, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
-			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
-		}}
-
-		TraceLoggingWriteStop(local, "{cur_cmd.name}"));
-	}}
-'''
-                
         return generated
 
     def genCreateInstance(self):
@@ -233,7 +292,23 @@ namespace openxr_api_layer
         return generated
 
     def genGetInstanceProcAddr(self):
-        generated = '''	XrResult OpenXrApi::xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function)
+        intercepted = self.getInterceptedFunctions()
+
+        generated = '''	namespace
+	{
+		// Functions intercepted by the layer, in lexicographic order.
+		constexpr std::string_view InterceptedFunctions[] = {
+'''
+
+        for (name, is_extension) in intercepted:
+            generated += f'''			"{name}",
+'''
+
+        generated += '''		};
+
+	} // namespace
+
+	XrResult OpenXrApi::xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function)
 	{
 		return xrGetInstanceProcAddrInternal(instance, name, function);
 	}
@@ -242,36 +317,34 @@ namespace openxr_api_layer
 	{
 		XrResult result = m_xrGetInstanceProcAddr(instance, name, function);
 
-		const std::string apiName(name);
-
-		if (apiName == "xrDestroyInstance")
+		const std::string_view apiName(name);
+		const auto it = std::lower_bound(std::cbegin(InterceptedFunctions), std::cend(InterceptedFunctions), apiName);
+		if (it == std::cend(InterceptedFunctions) || *it != apiName)
 		{
-			m_xrDestroyInstance = reinterpret_cast<PFN_xrDestroyInstance>(*function);
-			*function = reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::xrDestroyInstance);
+			return result;
 		}
-'''
 
-        for cur_cmd in self.core_commands:
-            if cur_cmd.name in layer_apis.override_functions + ['xrEnumerateInstanceExtensionProperties']:
-                generated += f'''		else if (apiName == "{cur_cmd.name}")
-		{{
-			m_{cur_cmd.name} = reinterpret_cast<PFN_{cur_cmd.name}>(*function);
-			*function = reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::{cur_cmd.name});
-		}}
+		switch (std::distance(std::cbegin(InterceptedFunctions), it))
+		{
 '''
 
-        # Always advertise extension functions.
-        for cur_cmd in self.ext_commands:
-            if cur_cmd.name in layer_apis.override_functions:
-                generated += f'''		else if (apiName == "{cur_cmd.name}")
-		{{
-			m_{cur_cmd.name} = reinterpret_cast<PFN_{cur_cmd.name}>(*function);
-			*function = reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::{cur_cmd.name});
-			result = XR_SUCCESS;
-		}}
+        for index, (name, is_extension) in enumerate(intercepted):
+            generated += f'''		case {index}: // {name}
+			m_{name} = reinterpret_cast<PFN_{name}>(*function);
+'''
+            if layer_apis.static_dispatch:
+                generated += f'''			*function = m_staticDispatchTable ? m_staticDispatchTable[{index}] : reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::{name});
+'''
+            else:
+                generated += f'''			*function = reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::{name});
+'''
+            if is_extension:
+                generated += '''			result = XR_SUCCESS;
+'''
+            generated += '''			break;
 '''
 
-        generated += '''
+        generated += '''		}
 
 		return result;
 	}'''
@@ -388,17 +461,42 @@ namespace openxr_api_layer
 		PFN_xrDestroyInstance m_xrDestroyInstance{nullptr};
 		PFN_xrEnumerateInstanceExtensionProperties m_xrEnumerateInstanceExtensionProperties{nullptr};
 '''
+        preamble = preamble.replace('''	extern const std::vector<std::pair<std::string, uint32_t>> advertisedExtensions;
+''', f'''	extern const std::vector<std::pair<std::string, uint32_t>> advertisedExtensions;
+
+	// Whether frame_timing is set in layer_apis.py (see metrics::IsEnabled()).
+	constexpr bool FrameTimingEnabled = {'true' if layer_apis.frame_timing else 'false'};
+
+	// Whether live_settings is set in layer_apis.py.
+	constexpr bool LiveSettingsEnabled = {'true' if layer_apis.live_settings else 'false'};
+''', 1)
+        if layer_apis.static_dispatch:
+            preamble = preamble.replace('''#pragma once
+''', '''#pragma once
+
+#include "log.h"
+#include "metrics.h"
+#include "settings.h"
+''', 1)
+            preamble = preamble.replace('''		PFN_xrGetInstanceProcAddr m_xrGetInstanceProcAddr{ nullptr };
+''', '''		PFN_xrGetInstanceProcAddr m_xrGetInstanceProcAddr{ nullptr };
+
+		// The wrappers to return from xrGetInstanceProcAddr(), in the order of the intercepted functions. When not set,
+		// the wrappers dispatching through the virtual methods are returned.
+		const PFN_xrVoidFunction* m_staticDispatchTable{ nullptr };
+''', 1)
         write(preamble, file=self.outFile)
 
     def endFile(self):
         generated_virtual_methods = self.genVirtualMethods()
+        generated_static_dispatch = self.genStaticDispatch() if layer_apis.static_dispatch else ''
 
-        postamble = '''
-	};
+        postamble = f'''
+	}};
 
 	extern std::unique_ptr<OpenXrApi> g_instance;
-
-} // namespace openxr_api_layer
+{generated_static_dispatch}
+}} // namespace openxr_api_layer
 '''
 
         contents = f'''
@@ -444,6 +542,56 @@ namespace openxr_api_layer
                 
         return generated
 
+    def genStaticDispatch(self):
+        commands = {cur_cmd.name: cur_cmd for cur_cmd in self.core_commands + self.ext_commands}
+        intercepted = self.getInterceptedFunctions()
+
+        generated = '''
+	OpenXrApi* GetInstance();
+
+	namespace static_dispatch
+	{
+		using namespace openxr_api_layer::log;
+
+		// Auto-generated wrappers invoking the methods of the concrete type directly. The qualified calls are not
+		// virtual, and they can be inlined into the wrappers.
+		template <typename Layer>
+		struct Wrappers
+		{'''
+
+        for (name, is_extension) in intercepted:
+            generated += textwrap.indent(self.makeWrapper(commands[name],
+                                                          'static_cast<Layer*>(GetInstance())->Layer::',
+                                                          prefix='static '),
+                                         '\t\t', lambda line: line.strip())
+
+        generated += '''
+			static inline const PFN_xrVoidFunction Table[] = {
+'''
+        for (name, is_extension) in intercepted:
+            generated += f'''				reinterpret_cast<PFN_xrVoidFunction>(&{name}),
+'''
+
+        generated += '''			};
+		};
+
+	} // namespace static_dispatch
+
+	// Derive the layer implementation from OpenXrApiStaticDispatch<OpenXrLayer> instead of OpenXrApi to have the
+	// intercepted functions dispatched directly to its methods. The methods must be public.
+	template <typename Layer>
+	class OpenXrApiStaticDispatch : public OpenXrApi
+	{
+	protected:
+		OpenXrApiStaticDispatch()
+		{
+			m_staticDispatchTable = static_dispatch::Wrappers<Layer>::Table;
+		}
+	};
+'''
+
+        return generated
+
 def makeREstring(strings, default=None):
     """Turn a list of strings into a regexp string matching exactly those strings."""
     if strings or default is None:
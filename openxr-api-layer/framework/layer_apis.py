@@ -13,3 +13,16 @@ requested_functions = [
 
 # The list of OpenXR extensions our layer will either override or use.
 extensions = []
+
+# Whether to record frame timing metrics (see metrics.h).
+# This implicitly overrides xrWaitFrame(), xrBeginFrame() and xrEndFrame().
+frame_timing = False
+
+# Whether to poll the settings block that can be changed while the application is running (see settings.h).
+# This implicitly overrides xrBeginFrame(). The layer must open the block in its xrCreateInstance() implementation
+# when LiveSettingsEnabled is true.
+live_settings = False
+
+# Whether to dispatch the overridden functions directly to the concrete layer implementation, without going through
+# the OpenXrApi virtual methods. The layer implementation must derive from OpenXrApiStaticDispatch<OpenXrLayer>.
+static_dispatch = False
@@ -22,9 +22,18 @@
 
 #include "pch.h"
 
+#include "log.h"
+
 namespace {
     constexpr uint32_t k_maxLoggedErrors = 100;
-    uint32_t g_globalErrorCount = 0;
+    std::atomic<uint32_t> g_globalErrorCount = 0;
+
+    // Size of the queue of messages waiting to be written to the log file. Must be a power of 2.
+    constexpr size_t k_logQueueSize = 256;
+    constexpr size_t k_logMessageSize = 1024;
+
+    // How often the logging thread writes queued messages to the log file.
+    constexpr DWORD k_logFlushIntervalMs = 100;
 } // namespace
 
 namespace openxr_api_layer::log {
@@ -39,18 +48,216 @@ namespace openxr_api_layer::log {
 
     namespace {
 
+        // A bounded multiple-producer single-consumer queue of messages. Producers never block: when the queue is
+        // full, the message is dropped and counted.
+        // See https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue.
+        class LogQueue {
+          public:
+            LogQueue() {
+                for (size_t i = 0; i < m_entries.size(); i++) {
+                    m_entries[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            // Returns false if the message was dropped.
+            bool push(const char* message) {
+                size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+                Entry* entry;
+                while (true) {
+                    entry = &m_entries[position & (m_entries.size() - 1)];
+                    const size_t sequence = entry->sequence.load(std::memory_order_acquire);
+                    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                    if (diff == 0) {
+                        if (m_enqueuePosition.compare_exchange_weak(
+                                position, position + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    } else {
+                        position = m_enqueuePosition.load(std::memory_order_relaxed);
+                    }
+                }
+
+                strncpy_s(entry->message, message, _TRUNCATE);
+                entry->sequence.store(position + 1, std::memory_order_release);
+
+                return true;
+            }
+
+            // Must only be called from one thread at a time.
+            template <typename Consumer>
+            size_t drain(Consumer consumer) {
+                size_t count = 0;
+                while (true) {
+                    Entry& entry = m_entries[m_dequeuePosition & (m_entries.size() - 1)];
+                    if (entry.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+                        break;
+                    }
+
+                    consumer(entry.message);
+                    entry.sequence.store(m_dequeuePosition + m_entries.size(), std::memory_order_release);
+                    m_dequeuePosition++;
+                    count++;
+                }
+                return count;
+            }
+
+            size_t approximateSize() const {
+                return m_enqueuePosition.load(std::memory_order_relaxed) - m_dequeuePosition;
+            }
+
+            uint32_t takeDroppedCount() {
+                return m_droppedCount.exchange(0, std::memory_order_relaxed);
+            }
+
+          private:
+            struct Entry {
+                std::atomic<size_t> sequence;
+                char message[k_logMessageSize];
+            };
+
+            std::array<Entry, k_logQueueSize> m_entries;
+            std::atomic<size_t> m_enqueuePosition{0};
+            size_t m_dequeuePosition{0};
+            std::atomic<uint32_t> m_droppedCount{0};
+        };
+
+        // Writes the queued messages to the log file from a background thread, so that logging never waits on
+        // the disk.
+        // The thread holds a reference on the module, so that the module cannot be unloaded while the thread runs
+        // DLL code. The thread only runs between start() and stop(), and messages outside of that window are written
+        // synchronously, so that nothing can pin the module once the thread was stopped.
+        class AsyncLogger {
+          public:
+            void push(const char* message) {
+                if (!m_isRunning.load(std::memory_order_acquire)) {
+                    std::unique_lock lock(m_mutex);
+
+                    if (!m_thread) {
+                        writeQueuedMessages();
+                        if (logStream.is_open()) {
+                            logStream << message;
+                            logStream.flush();
+                        }
+                        return;
+                    }
+                }
+
+                m_queue.push(message);
+
+                // Wake up the logging thread early when the queue is filling up.
+                if (m_wakeEvent && m_queue.approximateSize() >= k_logQueueSize / 2) {
+                    SetEvent(m_wakeEvent.get());
+                }
+            }
+
+            void start() {
+                std::unique_lock lock(m_mutex);
+
+                if (m_thread) {
+                    return;
+                }
+
+                if (!m_wakeEvent) {
+                    m_wakeEvent.reset(CreateEventA(nullptr, false, false, nullptr));
+                }
+
+                HMODULE module = nullptr;
+                if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                                        reinterpret_cast<LPCSTR>(this),
+                                        &module)) {
+                    return;
+                }
+                m_module = module;
+                m_thread.reset(CreateThread(
+                    nullptr,
+                    0,
+                    [](LPVOID context) -> DWORD {
+                        AsyncLogger* const logger = reinterpret_cast<AsyncLogger*>(context);
+                        const HMODULE module = logger->m_module;
+                        logger->run();
+                        FreeLibraryAndExitThread(module, 0);
+                    },
+                    this,
+                    0,
+                    nullptr));
+                if (!m_thread) {
+                    FreeLibrary(module);
+                    return;
+                }
+                m_isRunning.store(true, std::memory_order_release);
+            }
+
+            // Must not be called while holding the loader lock.
+            void stop() {
+                std::unique_lock lock(m_mutex);
+
+                if (!m_thread) {
+                    return;
+                }
+
+                m_isStopping.store(true, std::memory_order_release);
+                SetEvent(m_wakeEvent.get());
+                WaitForSingleObject(m_thread.get(), INFINITE);
+                m_thread.reset();
+                m_isStopping.store(false, std::memory_order_relaxed);
+                m_isRunning.store(false, std::memory_order_release);
+            }
+
+            // Write the remaining messages from the calling thread. Upon DLL_PROCESS_DETACH, the logging thread is
+            // either stopped, or it was terminated with the process.
+            void flush() {
+                writeQueuedMessages();
+            }
+
+          private:
+            void run() {
+                while (!m_isStopping.load(std::memory_order_acquire)) {
+                    WaitForSingleObject(m_wakeEvent.get(), k_logFlushIntervalMs);
+                    writeQueuedMessages();
+                }
+                writeQueuedMessages();
+            }
+
+            void writeQueuedMessages() {
+                const size_t count = m_queue.drain([](const char* message) {
+                    if (logStream.is_open()) {
+                        logStream << message;
+                    }
+                });
+
+                const uint32_t droppedCount = m_queue.takeDroppedCount();
+                if (droppedCount && logStream.is_open()) {
+                    logStream << droppedCount << " log messages were dropped\n";
+                }
+
+                if ((count || droppedCount) && logStream.is_open()) {
+                    logStream.flush();
+                }
+            }
+
+            LogQueue m_queue;
+            std::mutex m_mutex;
+            std::atomic<bool> m_isRunning{false};
+            std::atomic<bool> m_isStopping{false};
+            wil::unique_handle m_wakeEvent;
+            HMODULE m_module{nullptr};
+            wil::unique_handle m_thread;
+        };
+
+        AsyncLogger g_asyncLogger;
+
         // Utility logging function.
         void InternalLog(const char* fmt, va_list va) {
             const std::time_t now = std::time(nullptr);
 
-            char buf[1024];
+            char buf[k_logMessageSize];
             size_t offset = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S %z: ", std::localtime(&now));
             vsnprintf_s(buf + offset, sizeof(buf) - offset, _TRUNCATE, fmt, va);
             OutputDebugStringA(buf);
-            if (logStream.is_open()) {
-                logStream << buf;
-                logStream.flush();
-            }
+            g_asyncLogger.push(buf);
         }
     } // namespace
 
@@ -62,12 +269,13 @@ namespace openxr_api_layer::log {
     }
 
     void ErrorLog(const char* fmt, ...) {
-        if (g_globalErrorCount++ < k_maxLoggedErrors) {
+        const uint32_t errorCount = ++g_globalErrorCount;
+        if (errorCount <= k_maxLoggedErrors) {
             va_list va;
             va_start(va, fmt);
             InternalLog(fmt, va);
             va_end(va);
-            if (g_globalErrorCount == k_maxLoggedErrors) {
+            if (errorCount == k_maxLoggedErrors) {
                 Log("Maximum number of errors logged. Going silent.");
             }
         }
@@ -82,4 +290,16 @@ namespace openxr_api_layer::log {
 #endif
     }
 
+    void StartLogging() {
+        g_asyncLogger.start();
+    }
+
+    void StopLogging() {
+        g_asyncLogger.stop();
+    }
+
+    void FlushLog() {
+        g_asyncLogger.flush();
+    }
+
 } // namespace openxr_api_layer::log
@@ -34,6 +34,49 @@ namespace openxr_api_layer::log {
 
 #define TraceLocalActivity(activity) TraceLoggingActivity<g_traceProvider> activity;
 
+// Tracing for the calls made every frame (or more often).
+// The events are only written, and their arguments only evaluated, when a trace session is listening at the verbose
+// level. Defining LAYER_NO_HOT_PATH_TRACING (the default for Release builds) compiles them out entirely.
+#ifndef LAYER_NO_HOT_PATH_TRACING
+#define IsHotPathTraceEnabled() TraceLoggingProviderEnabled(g_traceProvider, WINEVENT_LEVEL_VERBOSE, 0)
+
+#define TraceHotPathActivity(activity)                                                                                 \
+    TraceLocalActivity(activity);                                                                                      \
+    const bool activity##IsTraced = IsHotPathTraceEnabled();
+
+#define TraceHotPathWriteStart(activity, name, ...)                                                                    \
+    do {                                                                                                               \
+        if (activity##IsTraced) {                                                                                      \
+            TraceLoggingWriteStart(activity, name, ##__VA_ARGS__);                                                     \
+        }                                                                                                              \
+    } while (false)
+#define TraceHotPathWriteTagged(activity, name, ...)                                                                   \
+    do {                                                                                                               \
+        if (activity##IsTraced) {                                                                                      \
+            TraceLoggingWriteTagged(activity, name, ##__VA_ARGS__);                                                    \
+        }                                                                                                              \
+    } while (false)
+#define TraceHotPathWriteStop(activity, name, ...)                                                                     \
+    do {                                                                                                               \
+        if (activity##IsTraced) {                                                                                      \
+            TraceLoggingWriteStop(activity, name, ##__VA_ARGS__);                                                      \
+        }                                                                                                              \
+    } while (false)
+#else
+#define IsHotPathTraceEnabled() false
+
+#define TraceHotPathActivity(activity)
+#define TraceHotPathWriteStart(activity, name, ...)                                                                    \
+    do {                                                                                                               \
+    } while (false)
+#define TraceHotPathWriteTagged(activity, name, ...)                                                                   \
+    do {                                                                                                               \
+    } while (false)
+#define TraceHotPathWriteStop(activity, name, ...)                                                                     \
+    do {                                                                                                               \
+    } while (false)
+#endif
+
 #define TLArg(var, ...) TraceLoggingValue(var, ##__VA_ARGS__)
 #define TLPArg(var, ...) TraceLoggingPointer(var, ##__VA_ARGS__)
 #ifdef _M_IX86
@@ -60,4 +103,16 @@ namespace openxr_api_layer::log {
         Log(str.data());
     }
 
+    // Start the background thread writing messages to the log file. Until then, messages are written synchronously.
+    // Every call must be matched by StopLogging().
+    void StartLogging();
+
+    // Stop the background thread writing messages to the log file, after it wrote all pending messages. Messages are
+    // written synchronously until the next StartLogging(). Must be called before the module is unloaded, outside of
+    // the loader lock.
+    void StopLogging();
+
+    // Write all pending messages to the log file from the calling thread. Must be called upon DLL_PROCESS_DETACH.
+    void FlushLog();
+
 } // namespace openxr_api_layer::log
@@ -0,0 +1,255 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <layer.h>
+
+#include "log.h"
+#include "metrics.h"
+
+namespace {
+
+    using namespace openxr_api_layer::metrics;
+
+    uint32_t percentile(std::vector<uint32_t>& values, size_t percent) {
+        const auto nth = values.begin() + std::min(values.size() - 1, (values.size() * percent) / 100);
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    }
+
+    struct Metrics {
+        void record(Stage stage, uint64_t durationUs) {
+            const size_t index = static_cast<size_t>(stage);
+            m_current[index].fetch_add(static_cast<uint32_t>(std::min<uint64_t>(durationUs, UINT32_MAX)),
+                                       std::memory_order_relaxed);
+            m_currentMask.fetch_or(1u << index, std::memory_order_relaxed);
+        }
+
+        void recordFrameCall(Stage stage, uint64_t startTime, uint64_t endTime) {
+            record(stage, endTime - startTime);
+
+            switch (stage) {
+            case Stage::WaitFrame:
+                m_lastWaitFrameEnd.store(endTime, std::memory_order_relaxed);
+                break;
+
+            case Stage::BeginFrame: {
+                const uint64_t lastWaitFrameEnd = m_lastWaitFrameEnd.exchange(0, std::memory_order_relaxed);
+                if (lastWaitFrameEnd && startTime >= lastWaitFrameEnd) {
+                    record(Stage::WaitToBeginFrame, startTime - lastWaitFrameEnd);
+                }
+                m_lastBeginFrameEnd.store(endTime, std::memory_order_relaxed);
+                break;
+            }
+
+            case Stage::EndFrame: {
+                const uint64_t lastBeginFrameEnd = m_lastBeginFrameEnd.exchange(0, std::memory_order_relaxed);
+                if (lastBeginFrameEnd && startTime >= lastBeginFrameEnd) {
+                    record(Stage::BeginToEndFrame, startTime - lastBeginFrameEnd);
+                }
+                endFrame();
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        // Only writes the frame into the ring: the aggregation is left to the readers, so that the frame loop never
+        // does more than a constant amount of work.
+        void endFrame() {
+            // The shared memory is mapped once, on the first frame.
+            std::call_once(m_sharedMemoryInit, [&] { openSharedMemory(); });
+
+            SharedMetrics& frames = *m_frames.load(std::memory_order_relaxed);
+            const uint64_t frameIndex = m_frameCount.fetch_add(1, std::memory_order_relaxed);
+            FrameSample& sample = frames.frames[frameIndex % FrameHistorySize];
+
+            // An odd sequence marks the sample as being written.
+            sample.sequence.store(frameIndex * 2 + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            sample.recordedMask.store(m_currentMask.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+            for (size_t i = 0; i < StageCount; i++) {
+                sample.values[i].store(m_current[i].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            sample.sequence.store(frameIndex * 2 + 2, std::memory_order_release);
+
+            frames.frameCount.store(frameIndex + 1, std::memory_order_release);
+        }
+
+        Statistics getStatistics() const {
+            return Aggregate(*m_frames.load(std::memory_order_acquire));
+        }
+
+      private:
+        void openSharedMemory() {
+            const DWORD processId = GetCurrentProcessId();
+            const std::string name = fmt::format("Local\\{}_Metrics_{}", openxr_api_layer::LayerName, processId);
+
+            m_sharedMemory.reset(CreateFileMappingA(
+                INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedMetrics), name.c_str()));
+            if (!m_sharedMemory) {
+                openxr_api_layer::log::ErrorLog(
+                    fmt::format("Failed to create metrics shared memory: {}\n", GetLastError()));
+                return;
+            }
+
+            m_sharedMemoryView.reset(MapViewOfFile(m_sharedMemory.get(), FILE_MAP_WRITE, 0, 0, sizeof(SharedMetrics)));
+            if (!m_sharedMemoryView) {
+                openxr_api_layer::log::ErrorLog(
+                    fmt::format("Failed to map metrics shared memory: {}\n", GetLastError()));
+                return;
+            }
+
+            SharedMetrics* const sharedMetrics = new (m_sharedMemoryView.get()) SharedMetrics{};
+            initialize(*sharedMetrics, processId);
+            m_frames.store(sharedMetrics, std::memory_order_release);
+
+            TraceLoggingWrite(openxr_api_layer::log::g_traceProvider,
+                              "Metrics_SharedMemory",
+                              TLArg(name.c_str(), "Name"),
+                              TLArg(sizeof(SharedMetrics), "Size"));
+        }
+
+        static void initialize(SharedMetrics& frames, DWORD processId) {
+            frames.version = SharedMetrics::CurrentVersion;
+            frames.stageCount = static_cast<uint32_t>(StageCount);
+            frames.historySize = static_cast<uint32_t>(FrameHistorySize);
+            frames.processId = processId;
+        }
+
+        std::array<std::atomic<uint32_t>, StageCount> m_current{};
+        std::atomic<uint32_t> m_currentMask{0};
+        std::atomic<uint64_t> m_lastWaitFrameEnd{0};
+        std::atomic<uint64_t> m_lastBeginFrameEnd{0};
+        std::atomic<uint64_t> m_frameCount{0};
+
+        // The ring lives in the shared memory block, or in the process if the block could not be created.
+        SharedMetrics m_localFrames{};
+        std::atomic<SharedMetrics*> m_frames{&m_localFrames};
+
+        std::once_flag m_sharedMemoryInit;
+        wil::unique_handle m_sharedMemory;
+        wil::unique_mapview_ptr<void> m_sharedMemoryView;
+    };
+
+    Metrics g_metrics;
+
+} // namespace
+
+namespace openxr_api_layer::metrics {
+
+    bool IsEnabled() {
+        return FrameTimingEnabled;
+    }
+
+    uint64_t Now() {
+        static const LARGE_INTEGER frequency = [] {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return frequency;
+        }();
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+
+        // Split the conversion to avoid overflowing.
+        const uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+        const uint64_t remainder = counter.QuadPart % frequency.QuadPart;
+        return seconds * 1000000 + (remainder * 1000000) / frequency.QuadPart;
+    }
+
+    void Record(Stage stage, uint64_t durationUs) {
+        if (!IsEnabled()) {
+            return;
+        }
+        g_metrics.record(stage, durationUs);
+    }
+
+    void RecordFrameCall(Stage stage, uint64_t startTime, uint64_t endTime) {
+        g_metrics.recordFrameCall(stage, startTime, endTime);
+    }
+
+    void EndFrame() {
+        g_metrics.endFrame();
+    }
+
+    Statistics GetStatistics() {
+        return g_metrics.getStatistics();
+    }
+
+    Statistics Aggregate(const SharedMetrics& metrics) {
+        Statistics statistics{};
+        statistics.frameCount = metrics.frameCount.load(std::memory_order_acquire);
+
+        std::array<std::vector<uint32_t>, StageCount> values;
+        for (auto& stageValues : values) {
+            stageValues.reserve(FrameHistorySize);
+        }
+
+        // Walk from the newest frame to the oldest one, so that the first value seen is the last one recorded.
+        const uint64_t count = std::min<uint64_t>(statistics.frameCount, FrameHistorySize);
+        for (uint64_t i = 1; i <= count; i++) {
+            const FrameSample& sample = metrics.frames[(statistics.frameCount - i) % FrameHistorySize];
+
+            const uint64_t sequenceBefore = sample.sequence.load(std::memory_order_acquire);
+            if (sequenceBefore & 1) {
+                continue;
+            }
+            const uint32_t mask = sample.recordedMask.load(std::memory_order_relaxed);
+            std::array<uint32_t, StageCount> sampleValues;
+            for (size_t j = 0; j < StageCount; j++) {
+                sampleValues[j] = sample.values[j].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sample.sequence.load(std::memory_order_relaxed) != sequenceBefore) {
+                // The sample was overwritten while we were reading it.
+                continue;
+            }
+
+            for (size_t j = 0; j < StageCount; j++) {
+                if (mask & (1u << j)) {
+                    values[j].push_back(sampleValues[j]);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < StageCount; i++) {
+            auto& stageValues = values[i];
+            StageStatistics& stage = statistics.stages[i];
+            stage.sampleCount = static_cast<uint32_t>(stageValues.size());
+            if (stageValues.empty()) {
+                continue;
+            }
+
+            stage.last = stageValues.front();
+            stage.p50 = percentile(stageValues, 50);
+            stage.p99 = percentile(stageValues, 99);
+        }
+
+        return statistics;
+    }
+
+} // namespace openxr_api_layer::metrics
@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer::metrics {
+
+    // The stages of a frame that are measured. All durations are in microseconds.
+    enum class Stage : uint32_t {
+        // Time spent in xrWaitFrame().
+        WaitFrame = 0,
+        // Time between the return from xrWaitFrame() and the call to xrBeginFrame().
+        WaitToBeginFrame,
+        // Time spent in xrBeginFrame().
+        BeginFrame,
+        // Time between the return from xrBeginFrame() and the call to xrEndFrame().
+        BeginToEndFrame,
+        // Time spent in xrEndFrame().
+        EndFrame,
+        // CPU time spent in ICompositionFramework::serializePreComposition().
+        SerializePreComposition,
+        // CPU time spent in ICompositionFramework::serializePostComposition().
+        SerializePostComposition,
+        // GPU time spent on the composition device between the two serialize calls.
+        GpuComposition,
+        // CPU time spent by IInputFramework in xrBeginFrame(), excluding the upstream call.
+        InputBeginFrame,
+        // CPU time spent in IInputFramework queries for buttons, thumbsticks and poses.
+        InputQueries,
+        // CPU time spent in ISwapchain::acquireImage(), including the upstream calls.
+        SwapchainAcquire,
+        // CPU time spent in ISwapchain::releaseImage() and ISwapchain::commitLastReleasedImage(), including the
+        // upstream calls and the submission of the bounce buffer copies.
+        SwapchainRelease,
+
+        Count
+    };
+
+    constexpr size_t StageCount = static_cast<size_t>(Stage::Count);
+
+    // The number of frames kept in the ring for aggregation.
+    constexpr size_t FrameHistorySize = 256;
+
+    struct StageStatistics {
+        uint32_t p50;
+        uint32_t p99;
+        uint32_t last;
+
+        // The number of frames in the history where the stage was recorded.
+        uint32_t sampleCount;
+    };
+
+    struct Statistics {
+        uint64_t frameCount;
+        StageStatistics stages[StageCount];
+    };
+
+    // A completed frame. Each frame is published with a sequence lock: readers must copy the values, and discard the
+    // frame if the sequence was odd or changed during the copy.
+    struct FrameSample {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint32_t> recordedMask;
+        std::atomic<uint32_t> values[StageCount];
+    };
+
+    // Layout of the shared memory block named "Local\<LayerName>_Metrics_<ProcessId>".
+    // The frame loop only writes the raw frames into the ring, it is up to the readers to aggregate them (see
+    // Aggregate()).
+    struct SharedMetrics {
+        static constexpr uint32_t CurrentVersion = 3;
+
+        uint32_t version;
+        uint32_t stageCount;
+        uint32_t historySize;
+        uint32_t processId;
+        // The frame at index frameCount - 1 (modulo historySize) is the most recent one.
+        std::atomic<uint64_t> frameCount;
+        FrameSample frames[FrameHistorySize];
+    };
+
+    // Whether metrics are recorded, which is the case when frame_timing is set in layer_apis.py. Without it, the frames
+    // are never completed, so callers should skip measuring altogether.
+    bool IsEnabled();
+
+    // A timestamp in microseconds, for use with RecordFrameCall().
+    uint64_t Now();
+
+    // Accumulate a duration into the frame being recorded. Can be called from any thread. Does nothing when metrics
+    // are not enabled.
+    void Record(Stage stage, uint64_t durationUs);
+
+    // Record a call to xrWaitFrame(), xrBeginFrame() or xrEndFrame(). The gaps between the calls are derived from the
+    // timestamps, and the call to xrEndFrame() completes the frame.
+    void RecordFrameCall(Stage stage, uint64_t startTime, uint64_t endTime);
+
+    // Accumulate the time spent in a scope into the frame being recorded.
+    class ScopedRecord {
+      public:
+        explicit ScopedRecord(Stage stage)
+            : m_stage(stage), m_isEnabled(IsEnabled()), m_startTime(m_isEnabled ? Now() : 0) {
+        }
+
+        ~ScopedRecord() {
+            if (m_isEnabled) {
+                Record(m_stage, Now() - m_startTime);
+            }
+        }
+
+        ScopedRecord(const ScopedRecord&) = delete;
+        ScopedRecord& operator=(const ScopedRecord&) = delete;
+
+      private:
+        const Stage m_stage;
+        const bool m_isEnabled;
+        const uint64_t m_startTime;
+    };
+
+    // Complete the frame being recorded and push it into the ring.
+    void EndFrame();
+
+    // Aggregate the frames currently in the ring. This is done on the calling thread.
+    Statistics GetStatistics();
+
+    // Aggregate the frames of a ring, for example one mapped from another process.
+    Statistics Aggregate(const SharedMetrics& metrics);
+
+} // namespace openxr_api_layer::metrics
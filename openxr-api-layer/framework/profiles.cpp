@@ -0,0 +1,204 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <layer.h>
+
+#include "log.h"
+#include "profiles.h"
+
+using namespace openxr_api_layer::log;
+
+namespace {
+
+    using namespace openxr_api_layer::profiles;
+
+    Profile g_currentProfile;
+
+    // A read-only view of the profile database.
+    class ProfileDatabase {
+      public:
+        explicit ProfileDatabase(const std::filesystem::path& path) {
+            m_file.reset(CreateFileW(path.c_str(),
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ,
+                                     nullptr,
+                                     OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL,
+                                     nullptr));
+            if (!m_file) {
+                return;
+            }
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(m_file.get(), &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ProfileDatabaseHeader)) ||
+                fileSize.QuadPart > UINT32_MAX) {
+                ErrorLog("Profile database is invalid\n");
+                return;
+            }
+            const size_t size = static_cast<size_t>(fileSize.QuadPart);
+
+            m_mapping.reset(CreateFileMappingW(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+            if (!m_mapping) {
+                return;
+            }
+            m_view.reset(MapViewOfFile(m_mapping.get(), FILE_MAP_READ, 0, 0, 0));
+            if (!m_view) {
+                return;
+            }
+
+            // Validate the layout once, so that lookups do not need any bounds check.
+            const uint8_t* const base = reinterpret_cast<const uint8_t*>(m_view.get());
+            const auto header = reinterpret_cast<const ProfileDatabaseHeader*>(base);
+            const size_t entriesSize = static_cast<size_t>(header->entryCount) * sizeof(ProfileDatabaseEntry);
+            if (header->magic != ProfileDatabaseHeader::Magic ||
+                header->version != ProfileDatabaseHeader::CurrentVersion ||
+                size != sizeof(ProfileDatabaseHeader) + entriesSize + header->stringTableSize ||
+                !header->stringTableSize) {
+                ErrorLog("Profile database is invalid or has an unsupported version\n");
+                return;
+            }
+
+            const auto entries = reinterpret_cast<const ProfileDatabaseEntry*>(base + sizeof(ProfileDatabaseHeader));
+            const char* const strings =
+                reinterpret_cast<const char*>(base + sizeof(ProfileDatabaseHeader) + entriesSize);
+            if (strings[header->stringTableSize - 1] != '\0') {
+                ErrorLog("Profile database has a malformed string table\n");
+                return;
+            }
+            for (uint32_t i = 0; i < header->entryCount; i++) {
+                if (entries[i].applicationNameOffset >= header->stringTableSize ||
+                    (entries[i].engineNameOffset != ProfileDatabaseEntry::Any &&
+                     entries[i].engineNameOffset >= header->stringTableSize)) {
+                    ErrorLog("Profile database has a malformed entry\n");
+                    return;
+                }
+            }
+
+            m_entries = entries;
+            m_entryCount = header->entryCount;
+            m_strings = strings;
+        }
+
+        const ProfileDatabaseEntry* find(const XrApplicationInfo& applicationInfo) const {
+            if (!m_entries) {
+                return nullptr;
+            }
+
+            const std::string_view applicationName(applicationInfo.applicationName);
+            const std::string_view engineName(applicationInfo.engineName);
+
+            const ProfileDatabaseEntry* const end = m_entries + m_entryCount;
+            const ProfileDatabaseEntry* it = std::lower_bound(
+                m_entries, end, applicationName, [&](const ProfileDatabaseEntry& entry, const std::string_view& name) {
+                    return getString(entry.applicationNameOffset) < name;
+                });
+            for (; it != end && getString(it->applicationNameOffset) == applicationName; it++) {
+                if (it->engineNameOffset != ProfileDatabaseEntry::Any &&
+                    getString(it->engineNameOffset) != engineName) {
+                    continue;
+                }
+                if (applicationInfo.engineVersion < it->minEngineVersion ||
+                    applicationInfo.engineVersion > it->maxEngineVersion) {
+                    continue;
+                }
+                return it;
+            }
+
+            return nullptr;
+        }
+
+      private:
+        std::string_view getString(uint32_t offset) const {
+            return std::string_view(m_strings + offset);
+        }
+
+        wil::unique_hfile m_file;
+        wil::unique_handle m_mapping;
+        wil::unique_mapview_ptr<void> m_view;
+
+        const ProfileDatabaseEntry* m_entries{nullptr};
+        uint32_t m_entryCount{0};
+        const char* m_strings{nullptr};
+    };
+
+} // namespace
+
+namespace openxr_api_layer::profiles {
+
+    const Profile& Lookup(const XrApplicationInfo& applicationInfo) {
+        TraceLocalActivity(local);
+        TraceLoggingWriteStart(local,
+                               "Profiles_Lookup",
+                               TLArg(applicationInfo.applicationName, "ApplicationName"),
+                               TLArg(applicationInfo.engineName, "EngineName"),
+                               TLArg(applicationInfo.engineVersion, "EngineVersion"));
+
+        g_currentProfile = {};
+
+        const ProfileDatabase database(dllHome / ProfileDatabaseFileName);
+        const ProfileDatabaseEntry* const entry = database.find(applicationInfo);
+        if (entry) {
+            g_currentProfile.bypass = entry->flags & ProfileFlags::Bypass;
+            g_currentProfile.useInputFramework = entry->flags & ProfileFlags::EnableInputFramework;
+            g_currentProfile.useCompositionFramework = entry->flags & ProfileFlags::EnableCompositionFramework;
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+            switch (entry->compositionApi) {
+            case ProfileCompositionApi::Default:
+                break;
+#ifdef XR_USE_GRAPHICS_API_D3D11
+            case ProfileCompositionApi::D3D11:
+                g_currentProfile.compositionApi = utils::graphics::CompositionApi::D3D11;
+                break;
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+            case ProfileCompositionApi::D3D12:
+                g_currentProfile.compositionApi = utils::graphics::CompositionApi::D3D12;
+                break;
+#endif
+            default:
+                ErrorLog(fmt::format("Unsupported composition API {} in profile\n", entry->compositionApi));
+                break;
+            }
+#endif
+
+            Log(fmt::format("Using profile for {}\n", applicationInfo.applicationName));
+        }
+
+        TraceLoggingWriteStop(local,
+                              "Profiles_Lookup",
+                              TLArg(!!entry, "Found"),
+                              TLArg(g_currentProfile.bypass, "Bypass"),
+                              TLArg(g_currentProfile.useInputFramework, "UseInputFramework"),
+                              TLArg(g_currentProfile.useCompositionFramework, "UseCompositionFramework"),
+                              TLArg(entry ? entry->compositionApi : ProfileCompositionApi::Default, "CompositionApi"));
+
+        return g_currentProfile;
+    }
+
+    const Profile& GetCurrent() {
+        return g_currentProfile;
+    }
+
+} // namespace openxr_api_layer::profiles
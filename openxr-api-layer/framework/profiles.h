@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer::profiles {
+
+    // The decisions made for the application at instance creation.
+    struct Profile {
+        // The layer does not touch the instance: no extension is blocked or implicitly requested, and all the
+        // functions are resolved directly from the next layer or the runtime.
+        bool bypass{false};
+
+        // The frameworks are only used by the applications whose profile asks for them.
+        bool useInputFramework{false};
+        bool useCompositionFramework{false};
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+        // When not set, the layer decides. Never set to an API that the layer was built without.
+        std::optional<utils::graphics::CompositionApi> compositionApi;
+#endif
+    };
+
+    // The name of the profile database, next to the layer's DLL. It is compiled from a JSON description with
+    // scripts/compile-profiles.py.
+    constexpr std::string_view ProfileDatabaseFileName = "profiles.bin";
+
+    // Layout of the profile database. All values are little-endian. The file is a header, followed by the entries
+    // sorted by application name, followed by a table of NUL-terminated strings.
+    struct ProfileDatabaseHeader {
+        static constexpr uint32_t Magic = 0x504C5258; // "XRLP"
+        static constexpr uint32_t CurrentVersion = 2;
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t stringTableSize;
+    };
+
+    namespace ProfileFlags {
+        constexpr uint32_t Bypass = (1 << 0);
+        constexpr uint32_t EnableInputFramework = (1 << 1);
+        constexpr uint32_t EnableCompositionFramework = (1 << 2);
+    }; // namespace ProfileFlags
+
+    // The composition API stored in the profile database. Unlike utils::graphics::CompositionApi, the values do not
+    // depend on which graphics APIs the layer is built with.
+    namespace ProfileCompositionApi {
+        constexpr uint32_t Default = 0;
+        constexpr uint32_t D3D11 = 1;
+        constexpr uint32_t D3D12 = 2;
+    }; // namespace ProfileCompositionApi
+
+    struct ProfileDatabaseEntry {
+        // No engine name or version restriction.
+        static constexpr uint32_t Any = UINT32_MAX;
+
+        // Offsets into the string table.
+        uint32_t applicationNameOffset;
+        uint32_t engineNameOffset;
+
+        // Inclusive range.
+        uint32_t minEngineVersion;
+        uint32_t maxEngineVersion;
+
+        uint32_t flags;
+        uint32_t compositionApi;
+    };
+
+    // Find the first profile matching the application in the profile database, or the default profile if none
+    // matched. The result is also remembered for GetCurrent().
+    const Profile& Lookup(const XrApplicationInfo& applicationInfo);
+
+    // The profile found by the last call to Lookup().
+    const Profile& GetCurrent();
+
+} // namespace openxr_api_layer::profiles
@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <layer.h>
+
+#include "log.h"
+#include "settings.h"
+
+namespace {
+
+    using namespace openxr_api_layer::settings;
+
+    struct SettingsBlock {
+        void open(const std::string& applicationName, const Settings& defaults) {
+            std::unique_lock lock(m_mutex);
+
+            // poll() reads the view without the lock, so it must never be unmapped once published.
+            if (m_sharedSettings.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            // Backslashes are not allowed in the name of the object itself.
+            std::string sanitizedName = applicationName;
+            std::replace(sanitizedName.begin(), sanitizedName.end(), '\\', '_');
+            const std::string name = fmt::format("Local\\{}_Settings_{}", openxr_api_layer::LayerName, sanitizedName);
+
+            m_current = defaults;
+
+            m_sharedMemory.reset(CreateFileMappingA(
+                INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedSettings), name.c_str()));
+            if (!m_sharedMemory) {
+                openxr_api_layer::log::ErrorLog(
+                    fmt::format("Failed to create settings shared memory: {}\n", GetLastError()));
+                return;
+            }
+            const bool alreadyExists = GetLastError() == ERROR_ALREADY_EXISTS;
+
+            m_sharedMemoryView.reset(MapViewOfFile(m_sharedMemory.get(), FILE_MAP_WRITE, 0, 0, sizeof(SharedSettings)));
+            if (!m_sharedMemoryView) {
+                openxr_api_layer::log::ErrorLog(
+                    fmt::format("Failed to map settings shared memory: {}\n", GetLastError()));
+                return;
+            }
+
+            SharedSettings* const sharedSettings = reinterpret_cast<SharedSettings*>(m_sharedMemoryView.get());
+            if (!alreadyExists || sharedSettings->version != SharedSettings::CurrentVersion) {
+                new (sharedSettings) SharedSettings{};
+                sharedSettings->settings = defaults;
+                sharedSettings->version = SharedSettings::CurrentVersion;
+            }
+
+            // Force the next poll to copy the settings.
+            m_lastSequence.store(UINT32_MAX, std::memory_order_relaxed);
+            m_sharedSettings.store(sharedSettings, std::memory_order_release);
+
+            TraceLoggingWrite(openxr_api_layer::log::g_traceProvider,
+                              "Settings_SharedMemory",
+                              TLArg(name.c_str(), "Name"),
+                              TLArg(sizeof(SharedSettings), "Size"),
+                              TLArg(alreadyExists, "AlreadyExists"));
+        }
+
+        bool poll() {
+            SharedSettings* const sharedSettings = m_sharedSettings.load(std::memory_order_acquire);
+            if (!sharedSettings) {
+                return false;
+            }
+
+            // Fast path: nothing was written since the last copy.
+            const uint32_t sequence = sharedSettings->sequence.load(std::memory_order_acquire);
+            if (sequence == m_lastSequence.load(std::memory_order_relaxed) || (sequence & 1)) {
+                return false;
+            }
+
+            const Settings copy = sharedSettings->settings;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sharedSettings->sequence.load(std::memory_order_relaxed) != sequence) {
+                // A writer came in while we were copying, try again on the next poll.
+                return false;
+            }
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                m_current = copy;
+                m_lastSequence.store(sequence, std::memory_order_relaxed);
+            }
+
+            TraceLoggingWrite(
+                openxr_api_layer::log::g_traceProvider, "Settings_Changed", TLArg(sequence, "Sequence"));
+
+            return true;
+        }
+
+        Settings getCurrent() const {
+            std::unique_lock lock(m_mutex);
+
+            return m_current;
+        }
+
+        mutable std::mutex m_mutex;
+        wil::unique_handle m_sharedMemory;
+        wil::unique_mapview_ptr<void> m_sharedMemoryView;
+        std::atomic<SharedSettings*> m_sharedSettings{nullptr};
+        std::atomic<uint32_t> m_lastSequence{UINT32_MAX};
+        Settings m_current{};
+    };
+
+    SettingsBlock g_settings;
+
+} // namespace
+
+namespace openxr_api_layer::settings {
+
+    void Open(const std::string& applicationName, const Settings& defaults) {
+        g_settings.open(applicationName, defaults);
+    }
+
+    bool Poll() {
+        return g_settings.poll();
+    }
+
+    Settings GetCurrent() {
+        return g_settings.getCurrent();
+    }
+
+} // namespace openxr_api_layer::settings
@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer::settings {
+
+    // The number of generic values in the settings block. Their meaning is defined by the layer.
+    constexpr size_t ValueCount = 16;
+
+    struct Settings {
+        float values[ValueCount];
+    };
+
+    // Layout of the shared memory block named "Local\<LayerName>_Settings_<ApplicationName>".
+    // Writers must make the sequence odd, write the settings, then make the sequence even again. The layer never
+    // writes to the settings once the block is initialized.
+    struct SharedSettings {
+        static constexpr uint32_t CurrentVersion = 2;
+
+        uint32_t version;
+        std::atomic<uint32_t> sequence;
+        Settings settings;
+    };
+
+    // Create (or open, if another process already created it) the settings block for an application. The defaults are
+    // only written when the block is created. The block is mapped once per process: subsequent calls, eg: when the
+    // application creates another instance, keep using the same block.
+    void Open(const std::string& applicationName, const Settings& defaults);
+
+    // Copy the settings if they changed since the last call. This is cheap enough to be called every frame: when
+    // nothing changed, it is a single atomic load. Called from xrBeginFrame() when live_settings is set in
+    // layer_apis.py.
+    bool Poll();
+
+    // The settings as of the last call to Poll(), or the defaults passed to Open().
+    Settings GetCurrent();
+
+} // namespace openxr_api_layer::settings
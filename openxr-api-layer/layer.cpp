@@ -27,6 +27,8 @@
 
 #include "layer.h"
 #include <log.h>
+#include <profiles.h>
+#include <settings.h>
 #include <util.h>
 
 namespace openxr_api_layer {
@@ -40,6 +42,15 @@ namespace openxr_api_layer {
     const std::vector<std::string> blockedExtensions = {};
     const std::vector<std::string> implicitExtensions = {};
 
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+    // The composition API to use when the application's profile does not choose one.
+#ifdef XR_USE_GRAPHICS_API_D3D11
+    constexpr utils::graphics::CompositionApi DefaultCompositionApi = utils::graphics::CompositionApi::D3D11;
+#else
+    constexpr utils::graphics::CompositionApi DefaultCompositionApi = utils::graphics::CompositionApi::D3D12;
+#endif
+#endif
+
     // This class implements our API layer.
     class OpenXrLayer : public openxr_api_layer::OpenXrApi {
       public:
@@ -57,6 +68,18 @@ namespace openxr_api_layer {
             XrResult result = m_bypassApiLayer ? m_xrGetInstanceProcAddr(instance, name, function)
                                                : OpenXrApi::xrGetInstanceProcAddr(instance, name, function);
 
+            // The frameworks hook the functions they need on top of ours.
+            if (XR_SUCCEEDED(result) && !m_bypassApiLayer) {
+                if (m_inputFrameworkFactory) {
+                    m_inputFrameworkFactory->xrGetInstanceProcAddr_post(instance, name, function);
+                }
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+                if (m_compositionFrameworkFactory) {
+                    m_compositionFrameworkFactory->xrGetInstanceProcAddr_post(instance, name, function);
+                }
+#endif
+            }
+
             TraceLoggingWrite(g_traceProvider, "xrGetInstanceProcAddr", TLPArg(*function, "Function"));
 
             return result;
@@ -82,14 +105,42 @@ namespace openxr_api_layer {
                               TLArg(createInfo->createFlags, "CreateFlags"));
             Log(fmt::format("Application: {}\n", createInfo->applicationInfo.applicationName));
 
-            // Here there can be rules to disable the API layer entirely (based on applicationName for example).
-            // m_bypassApiLayer = ...
+            // The rules to disable the API layer entirely live in the profile database (see profiles.h).
+            const profiles::Profile& profile = profiles::GetCurrent();
+            m_bypassApiLayer = profile.bypass;
 
             if (m_bypassApiLayer) {
                 Log(fmt::format("{} layer will be bypassed\n", LayerName));
                 return XR_SUCCESS;
             }
 
+            // Expose the settings that can be changed while the application is running (see settings.h). Use
+            // settings::GetCurrent() to read them.
+            if (LiveSettingsEnabled) {
+                settings::Open(createInfo->applicationInfo.applicationName, settings::Settings{});
+            }
+
+            // The profile also tells which frameworks to create and which composition API to use.
+            if (profile.useInputFramework) {
+                m_inputFrameworkFactory = utils::inputs::createInputFrameworkFactory(
+                    *createInfo,
+                    GetXrInstance(),
+                    m_xrGetInstanceProcAddr,
+                    utils::inputs::InputMethod::MotionControllerSpatial |
+                        utils::inputs::InputMethod::MotionControllerButtons);
+                Log("Using the input framework\n");
+            }
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+            if (profile.useCompositionFramework) {
+                m_compositionFrameworkFactory = utils::graphics::createCompositionFrameworkFactory(
+                    *createInfo,
+                    GetXrInstance(),
+                    m_xrGetInstanceProcAddr,
+                    profile.compositionApi.value_or(DefaultCompositionApi));
+                Log("Using the composition framework\n");
+            }
+#endif
+
             for (uint32_t i = 0; i < createInfo->enabledApiLayerCount; i++) {
                 TraceLoggingWrite(
                     g_traceProvider, "xrCreateInstance", TLArg(createInfo->enabledApiLayerNames[i], "ApiLayerName"));
@@ -174,6 +225,10 @@ namespace openxr_api_layer {
 
         bool m_bypassApiLayer{false};
         XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
+        std::shared_ptr<utils::inputs::IInputFrameworkFactory> m_inputFrameworkFactory;
+#if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
+        std::shared_ptr<utils::graphics::ICompositionFrameworkFactory> m_compositionFrameworkFactory;
+#endif
     };
 
     // This method is required by the framework to instantiate your OpenXrApi implementation.
@@ -193,6 +248,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
         break;
 
     case DLL_PROCESS_DETACH:
+        openxr_api_layer::log::FlushLog();
         TraceLoggingUnregister(openxr_api_layer::log::g_traceProvider);
         break;
 
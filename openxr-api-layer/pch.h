@@ -32,6 +32,9 @@
 
 // Standard library.
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
 #include <ctime>
 #define _USE_MATH_DEFINES
@@ -39,13 +42,20 @@
 #include <deque>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <memory>
 #include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -63,6 +73,7 @@ using Microsoft::WRL::ComPtr;
 
 // Graphics APIs.
 #include <dxgiformat.h>
+#include <dxgi1_4.h>
 #ifdef XR_USE_GRAPHICS_API_D3D11
 #include <d3d11_4.h>
 #endif
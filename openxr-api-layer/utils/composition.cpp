@@ -24,6 +24,7 @@
 
 #include "graphics.h"
 #include "log.h"
+#include "metrics.h"
 
 #if defined(XR_USE_GRAPHICS_API_D3D11) || defined(XR_USE_GRAPHICS_API_D3D12)
 
@@ -51,6 +52,10 @@ namespace xr {
 #ifdef XR_USE_GRAPHICS_API_D3D11
         case CompositionApi::D3D11:
             return "D3D11";
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+        case CompositionApi::D3D12:
+            return "D3D12";
 #endif
         };
 
@@ -63,6 +68,7 @@ namespace {
 
     using namespace openxr_api_layer::log;
     using namespace openxr_api_layer::utils::graphics;
+    namespace metrics = openxr_api_layer::metrics;
 
     bool isSRGBFormat(DXGI_FORMAT format) {
         return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
@@ -76,12 +82,380 @@ namespace {
                format == DXGI_FORMAT_D32_FLOAT || format == DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
     }
 
+    // Whether the composition device was created on top of the application's device (see CompositionApi::D3D12).
+    bool isSameNativeDevice(const IGraphicsDevice* applicationDevice, const IGraphicsDevice* compositionDevice) {
+        return applicationDevice->getApi() == compositionDevice->getApi() &&
+               applicationDevice->getNativeDevicePtr() == compositionDevice->getNativeDevicePtr();
+    }
+
+    // A single timeline shared by the composition framework and all its swapchains to synchronize the application
+    // device and the composition device.
+    struct SerializationTimeline {
+        SerializationTimeline(IGraphicsDevice* applicationDevice, IGraphicsDevice* compositionDevice) {
+            m_fenceOnCompositionDevice = compositionDevice->createFence();
+            m_fenceOnApplicationDevice = applicationDevice->openFence(m_fenceOnCompositionDevice->getFenceHandle());
+
+            // We submit the signals ourselves, at most once per serialization point.
+            m_fenceOnApplicationDevice->setDeferredFlush(true);
+            m_fenceOnCompositionDevice->setDeferredFlush(true);
+        }
+
+        ~SerializationTimeline() {
+            waitOnCpu();
+        }
+
+        void setMode(SerializationMode mode) {
+            std::vector<std::function<void()>> deferredCommits;
+            {
+                std::unique_lock lock(m_mutex);
+
+                if (m_mode == SerializationMode::Batched && mode == SerializationMode::Immediate) {
+                    // Do not leave anything behind when leaving batched mode.
+                    if (m_isApplicationDirty) {
+                        signalApplicationToComposition();
+                        m_fenceOnApplicationDevice->flush();
+                    }
+                    if (!m_deferredCommits.empty()) {
+                        signalCompositionToApplication();
+                        m_fenceOnCompositionDevice->flush();
+                        deferredCommits = takeDeferredCommits();
+                    }
+                }
+                m_mode = mode;
+            }
+
+            runDeferredCommits(deferredCommits);
+        }
+
+        // Must be called after enqueuing commands on the application device that the composition device depends on.
+        void applicationWorkSubmitted() {
+            std::unique_lock lock(m_mutex);
+
+            if (m_mode == SerializationMode::Immediate) {
+                signalApplicationToComposition();
+                // The composition device now waits on this signal, which must reach the GPU even if there is no
+                // later serialization point.
+                m_fenceOnApplicationDevice->flush();
+            } else {
+                m_isApplicationDirty = true;
+            }
+        }
+
+        // Must be called before accessing an image rendered by the application from the composition device. In batched
+        // mode, the application's commands were already serialized by beginComposition().
+        void applicationImageReleased() {
+            std::unique_lock lock(m_mutex);
+
+            if (m_mode == SerializationMode::Immediate) {
+                signalApplicationToComposition();
+                // See applicationWorkSubmitted().
+                m_fenceOnApplicationDevice->flush();
+            } else if (!m_isInComposition) {
+                m_isApplicationDirty = true;
+            }
+        }
+
+        // Must be called before accessing a resource from the composition device. Only performs a synchronization if
+        // there is outstanding work on the application device.
+        void waitForApplication() {
+            if (!m_isApplicationDirty.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::unique_lock lock(m_mutex);
+
+            if (m_isApplicationDirty) {
+                signalApplicationToComposition();
+                m_fenceOnApplicationDevice->flush();
+            }
+        }
+
+        // Must be called before accessing a resource written by the composition device on the application device.
+        // Returns false if the operation was deferred until endComposition(), in which case the commit callback will
+        // be invoked after synchronization.
+        bool waitForComposition(const void* owner, std::function<void()> commit) {
+            {
+                std::unique_lock lock(m_mutex);
+
+                if (m_mode == SerializationMode::Batched && m_isInComposition) {
+                    m_deferredCommits.push_back({owner, std::move(commit)});
+                    return false;
+                }
+
+                signalCompositionToApplication();
+                if (!m_isInComposition) {
+                    // Outside of composition, there is no later serialization point to flush at.
+                    m_fenceOnCompositionDevice->flush();
+                }
+            }
+
+            commit();
+            return true;
+        }
+
+        // Drop the deferred commits of an owner that is going away.
+        void cancelDeferredCommits(const void* owner) {
+            std::unique_lock lock(m_mutex);
+
+            m_deferredCommits.erase(std::remove_if(m_deferredCommits.begin(),
+                                                   m_deferredCommits.end(),
+                                                   [&](const DeferredCommit& entry) { return entry.owner == owner; }),
+                                    m_deferredCommits.end());
+        }
+
+        void beginComposition() {
+            std::unique_lock lock(m_mutex);
+
+            signalApplicationToComposition();
+            m_fenceOnApplicationDevice->flush();
+            m_isInComposition = true;
+        }
+
+        void endComposition() {
+            std::vector<std::function<void()>> deferredCommits;
+            {
+                std::unique_lock lock(m_mutex);
+
+                signalCompositionToApplication();
+                m_fenceOnCompositionDevice->flush();
+                deferredCommits = takeDeferredCommits();
+                m_isInComposition = false;
+            }
+
+            // The deferred commits only enqueue work on the application device, after the wait above.
+            runDeferredCommits(deferredCommits);
+        }
+
+        void waitOnCpu() {
+            std::unique_lock lock(m_mutex);
+
+            if (m_fenceOnApplicationDevice) {
+                m_fenceOnApplicationDevice->waitOnCpu(m_fenceValue);
+            }
+            if (m_fenceOnCompositionDevice) {
+                m_fenceOnCompositionDevice->waitOnCpu(m_fenceValue);
+            }
+        }
+
+      private:
+        struct DeferredCommit {
+            const void* owner;
+            std::function<void()> commit;
+        };
+
+        void signalApplicationToComposition() {
+            m_fenceValue++;
+            m_fenceOnApplicationDevice->signal(m_fenceValue);
+            m_fenceOnCompositionDevice->waitOnDevice(m_fenceValue);
+            m_isApplicationDirty = false;
+        }
+
+        void signalCompositionToApplication() {
+            m_fenceValue++;
+            m_fenceOnCompositionDevice->signal(m_fenceValue);
+            m_fenceOnApplicationDevice->waitOnDevice(m_fenceValue);
+        }
+
+        std::vector<std::function<void()>> takeDeferredCommits() {
+            std::vector<std::function<void()>> commits;
+            commits.reserve(m_deferredCommits.size());
+            for (DeferredCommit& entry : m_deferredCommits) {
+                commits.push_back(std::move(entry.commit));
+            }
+            m_deferredCommits.clear();
+            return commits;
+        }
+
+        static void runDeferredCommits(std::vector<std::function<void()>>& commits) {
+            for (auto& commit : commits) {
+                commit();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::shared_ptr<IGraphicsFence> m_fenceOnApplicationDevice;
+        std::shared_ptr<IGraphicsFence> m_fenceOnCompositionDevice;
+        uint64_t m_fenceValue{0};
+
+        SerializationMode m_mode{SerializationMode::Immediate};
+        std::atomic<bool> m_isApplicationDirty{false};
+        bool m_isInComposition{false};
+        std::vector<DeferredCommit> m_deferredCommits;
+    };
+
+    // A texture created on the composition device and its counterpart on the application device.
+    struct TexturePair {
+        std::shared_ptr<IGraphicsTexture> onCompositionDevice;
+        std::shared_ptr<IGraphicsTexture> onApplicationDevice;
+    };
+
+    constexpr uint64_t DefaultTexturePoolBudget = 256ull * 1024 * 1024;
+
+    constexpr float DefaultLowMemoryThreshold = 0.9f;
+
+    // How often the memory budget is queried from DXGI, in microseconds.
+    constexpr uint64_t MemoryBudgetRefreshInterval = 1'000'000;
+
+    // How long the prefetch thread waits on a swapchain image before checking whether the swapchain is being destroyed.
+    constexpr XrDuration PrefetchWaitSlice = 100'000'000;
+
+    // A pool of texture pairs that can be reused between swapchains with identical properties. Unused textures are
+    // evicted (least recently returned first) when the pool exceeds its memory budget.
+    struct TexturePool {
+        TexturePool(IGraphicsDevice* applicationDevice, IGraphicsDevice* compositionDevice)
+            : m_applicationDevice(applicationDevice), m_compositionDevice(compositionDevice),
+              m_isSameDevice(isSameNativeDevice(applicationDevice, compositionDevice)) {
+        }
+
+        TexturePair acquire(const XrSwapchainCreateInfo& infoOnCompositionDevice,
+                            const XrSwapchainCreateInfo& infoOnApplicationDevice) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "TexturePool_Acquire", TLPArg(this, "Pool"));
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                auto it = m_entries.find(makeKey(infoOnCompositionDevice, infoOnApplicationDevice));
+                if (it != m_entries.end()) {
+                    TexturePair textures = std::move(it->second.textures);
+                    m_pooledBytes -= it->second.size;
+                    m_entries.erase(it);
+
+                    TraceLoggingWriteStop(local, "TexturePool_Acquire", TLArg(true, "Hit"));
+
+                    return textures;
+                }
+            }
+
+            TexturePair textures;
+            textures.onCompositionDevice =
+                m_compositionDevice->createTexture(infoOnCompositionDevice, !m_isSameDevice /* shareable */);
+            textures.onApplicationDevice =
+                m_isSameDevice ? m_applicationDevice->openTexturePtr(
+                                     textures.onCompositionDevice->getNativeTexturePtr(), infoOnApplicationDevice)
+                               : m_applicationDevice->openTexture(textures.onCompositionDevice->getTextureHandle(),
+                                                                  infoOnApplicationDevice);
+
+            TraceLoggingWriteStop(local, "TexturePool_Acquire", TLArg(false, "Hit"));
+
+            return textures;
+        }
+
+        void release(const XrSwapchainCreateInfo& infoOnCompositionDevice,
+                     const XrSwapchainCreateInfo& infoOnApplicationDevice,
+                     TexturePair textures) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "TexturePool_Release", TLPArg(this, "Pool"));
+
+            std::unique_lock lock(m_mutex);
+
+            const uint64_t size = internal::estimateTextureSize(infoOnCompositionDevice);
+            m_entries.insert({makeKey(infoOnCompositionDevice, infoOnApplicationDevice),
+                              Entry{std::move(textures), size, m_releaseCounter++}});
+            m_pooledBytes += size;
+            evict();
+
+            TraceLoggingWriteStop(local, "TexturePool_Release", TLArg(m_pooledBytes, "PooledBytes"));
+        }
+
+        void setBudget(uint64_t budgetBytes) {
+            std::unique_lock lock(m_mutex);
+
+            m_budgetBytes = budgetBytes;
+            evict();
+        }
+
+        // When low on memory, the pool does not keep any texture.
+        void setLowOnMemory(bool isLowOnMemory) {
+            std::unique_lock lock(m_mutex);
+
+            m_isLowOnMemory = isLowOnMemory;
+            evict();
+        }
+
+      private:
+        using Key = std::tuple<int64_t,
+                               uint32_t,
+                               uint32_t,
+                               uint32_t,
+                               uint32_t,
+                               uint32_t,
+                               uint32_t,
+                               uint64_t,
+                               uint64_t,
+                               int64_t,
+                               uint64_t,
+                               uint64_t>;
+
+        struct Entry {
+            TexturePair textures;
+            uint64_t size;
+            uint64_t releaseIndex;
+        };
+
+        // The texture on the application device is opened with its own format and flags, which must match too.
+        static Key makeKey(const XrSwapchainCreateInfo& infoOnCompositionDevice,
+                           const XrSwapchainCreateInfo& infoOnApplicationDevice) {
+            return {infoOnCompositionDevice.format,
+                    infoOnCompositionDevice.width,
+                    infoOnCompositionDevice.height,
+                    infoOnCompositionDevice.arraySize,
+                    infoOnCompositionDevice.mipCount,
+                    infoOnCompositionDevice.sampleCount,
+                    infoOnCompositionDevice.faceCount,
+                    infoOnCompositionDevice.usageFlags,
+                    infoOnCompositionDevice.createFlags,
+                    infoOnApplicationDevice.format,
+                    infoOnApplicationDevice.usageFlags,
+                    infoOnApplicationDevice.createFlags};
+        }
+
+        void evict() {
+            const uint64_t budgetBytes = m_isLowOnMemory ? 0 : m_budgetBytes;
+            while (m_pooledBytes > budgetBytes && !m_entries.empty()) {
+                auto oldest = m_entries.begin();
+                for (auto it = m_entries.begin(); it != m_entries.end(); it++) {
+                    if (it->second.releaseIndex < oldest->second.releaseIndex) {
+                        oldest = it;
+                    }
+                }
+
+                TraceLoggingWrite(g_traceProvider,
+                                  "TexturePool_Evict",
+                                  TLPArg(this, "Pool"),
+                                  TLArg(oldest->second.size, "Size"));
+
+                m_pooledBytes -= oldest->second.size;
+                m_entries.erase(oldest);
+            }
+        }
+
+        IGraphicsDevice* const m_applicationDevice;
+        IGraphicsDevice* const m_compositionDevice;
+        const bool m_isSameDevice;
+
+        std::mutex m_mutex;
+        std::multimap<Key, Entry> m_entries;
+        uint64_t m_pooledBytes{0};
+        uint64_t m_budgetBytes{DefaultTexturePoolBudget};
+        bool m_isLowOnMemory{false};
+        uint64_t m_releaseCounter{0};
+    };
+
+    // A portion of a swapchain declared through ISwapchain::setDirtyRegion().
+    struct DirtyRegion {
+        XrRect2Di rect;
+        uint32_t firstSlice;
+        uint32_t sliceCount;
+    };
+
     struct SwapchainImage : ISwapchainImage {
         SwapchainImage(std::shared_ptr<IGraphicsTexture> textureOnApplicationDevice,
                        std::shared_ptr<IGraphicsTexture> textureOnCompositionDevice,
-                       uint32_t index)
+                       uint32_t index,
+                       SerializationTimeline* timeline = nullptr)
             : m_textureOnApplicationDevice(textureOnApplicationDevice), m_textureForRead(textureOnCompositionDevice),
-              m_textureForWrite(textureOnCompositionDevice), m_index(index) {
+              m_textureForWrite(textureOnCompositionDevice), m_index(index), m_timeline(timeline) {
         }
 
         IGraphicsTexture* getApplicationTexture() const override {
@@ -89,10 +463,18 @@ namespace {
         }
 
         IGraphicsTexture* getTextureForRead() const override {
+            // The texture is about to be used on the composition device.
+            if (m_timeline) {
+                m_timeline->waitForApplication();
+            }
             return m_textureForRead.get();
         }
 
         IGraphicsTexture* getTextureForWrite() const override {
+            // The texture is about to be used on the composition device.
+            if (m_timeline) {
+                m_timeline->waitForApplication();
+            }
             return m_textureForWrite.get();
         }
 
@@ -100,10 +482,61 @@ namespace {
             return m_index;
         }
 
+        uint64_t getGeneration() const override {
+            return m_generation.load(std::memory_order_relaxed);
+        }
+
+        void setGeneration(uint64_t generation) {
+            m_generation.store(generation, std::memory_order_relaxed);
+        }
+
         const std::shared_ptr<IGraphicsTexture> m_textureOnApplicationDevice;
         const std::shared_ptr<IGraphicsTexture> m_textureForRead;
         const std::shared_ptr<IGraphicsTexture> m_textureForWrite;
         const uint32_t m_index;
+        SerializationTimeline* const m_timeline;
+        std::atomic<uint64_t> m_generation{0};
+    };
+
+    // The content generations backing ISwapchain::isCompositionNeeded().
+    // A released image only counts as new content until it is consumed, either by reading it with
+    // getLastReleasedImage() on a read-only swapchain or by writing it with commitLastReleasedImage().
+    struct SwapchainGenerations {
+        uint64_t imageReleased(ISwapchainImage* image) {
+            std::unique_lock lock(m_mutex);
+
+            m_hasUnconsumedRelease = true;
+            static_cast<SwapchainImage*>(image)->setGeneration(++m_release);
+            return m_release;
+        }
+
+        void imageConsumed() {
+            std::unique_lock lock(m_mutex);
+
+            m_hasUnconsumedRelease = false;
+            m_consumedLayer = m_layer;
+        }
+
+        void setLayerGeneration(uint64_t generation) {
+            std::unique_lock lock(m_mutex);
+
+            m_layer = generation;
+        }
+
+        bool isCompositionNeeded() const {
+            std::unique_lock lock(m_mutex);
+
+            return m_hasUnconsumedRelease || !m_consumedLayer.has_value() || m_consumedLayer.value() != m_layer;
+        }
+
+      private:
+        mutable std::mutex m_mutex;
+        uint64_t m_release{0};
+        uint64_t m_layer{0};
+        bool m_hasUnconsumedRelease{false};
+
+        // The layer generation when the last released image was consumed.
+        std::optional<uint64_t> m_consumedLayer;
     };
 
     struct SubmittableSwapchain : ISwapchain {
@@ -113,14 +546,17 @@ namespace {
                              const XrSwapchainCreateInfo& infoOnApplicationDevice,
                              IGraphicsDevice* applicationDevice,
                              IGraphicsDevice* compositionDevice,
+                             std::shared_ptr<SerializationTimeline> timeline,
+                             std::shared_ptr<TexturePool> texturePool,
                              SwapchainMode mode,
                              std::optional<bool> overrideShareable = {},
                              bool hasOwnership = true)
-            : m_swapchain(swapchain), m_infoOnCompositionDevice(infoOnApplicationDevice),
+            : m_swapchain(swapchain), m_infoOnApplicationDevice(infoOnApplicationDevice),
+              m_infoOnCompositionDevice(infoOnApplicationDevice),
               m_formatOnApplicationDevice(infoOnApplicationDevice.format), m_applicationDevice(applicationDevice),
-              m_compositionDevice(compositionDevice),
+              m_compositionDevice(compositionDevice), m_timeline(timeline), m_texturePool(texturePool),
               m_accessForRead((mode & SwapchainMode::Read) == SwapchainMode::Read),
-              m_accessForWrite((mode & SwapchainMode::Write) == SwapchainMode::Write) {
+              m_accessForWrite((mode & SwapchainMode::Write) == SwapchainMode::Write), m_hasOwnership(hasOwnership) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(
                 local, "Swapchain_Create", TLArg("Submittable", "Type"), TLArg(hasOwnership, "HasOwnership"));
@@ -177,27 +613,35 @@ namespace {
             }
 
             // Make the images available on the composition device.
+            const bool isSameDevice = isSameNativeDevice(m_applicationDevice, m_compositionDevice);
             uint32_t index = 0;
             for (std::shared_ptr<IGraphicsTexture>& textureOnApplicationDevice : textures) {
                 std::unique_ptr<SwapchainImage> image;
-                if (overrideShareable.value_or(true) && textureOnApplicationDevice->isShareable()) {
+                if (isSameDevice) {
+                    // The composition device shares the application's device, no need for sharing or copying.
+                    const std::shared_ptr<IGraphicsTexture> textureOnCompositionDevice =
+                        m_compositionDevice->openTexturePtr(textureOnApplicationDevice->getNativeTexturePtr(),
+                                                            m_infoOnCompositionDevice);
+                    image = std::make_unique<SwapchainImage>(
+                        textureOnApplicationDevice, textureOnCompositionDevice, index, m_timeline.get());
+                } else if (overrideShareable.value_or(true) && textureOnApplicationDevice->isShareable()) {
                     const std::shared_ptr<IGraphicsTexture> textureOnCompositionDevice =
                         m_compositionDevice->openTexture(textureOnApplicationDevice->getTextureHandle(),
                                                          m_infoOnCompositionDevice);
-                    image =
-                        std::make_unique<SwapchainImage>(textureOnApplicationDevice, textureOnCompositionDevice, index);
+                    image = std::make_unique<SwapchainImage>(
+                        textureOnApplicationDevice, textureOnCompositionDevice, index, m_timeline.get());
                 } else {
                     // If the swapchain image isn't shareable, we will need to create a copy accessible on both the
                     // application and composition device, and make sure to perform copy operations as needed.
                     // TODO: Reduce memory occupation by using a shared texture at the IGraphicsDevice level.
                     if (!m_bounceBufferOnApplicationDevice) {
-                        m_bounceBufferOnCompositionDevice =
-                            m_compositionDevice->createTexture(m_infoOnCompositionDevice, true /* shareable */);
-                        m_bounceBufferOnApplicationDevice = m_applicationDevice->openTexture(
-                            m_bounceBufferOnCompositionDevice->getTextureHandle(), infoOnApplicationDevice);
+                        TexturePair bounceBuffer =
+                            m_texturePool->acquire(m_infoOnCompositionDevice, infoOnApplicationDevice);
+                        m_bounceBufferOnCompositionDevice = std::move(bounceBuffer.onCompositionDevice);
+                        m_bounceBufferOnApplicationDevice = std::move(bounceBuffer.onApplicationDevice);
                     }
                     image = std::make_unique<SwapchainImage>(
-                        textureOnApplicationDevice, m_bounceBufferOnCompositionDevice, index);
+                        textureOnApplicationDevice, m_bounceBufferOnCompositionDevice, index, m_timeline.get());
                 }
 
                 TraceLoggingWriteTagged(local, "Swapchain_Create", TLPArg(image.get(), "Image"));
@@ -206,10 +650,6 @@ namespace {
                 index++;
             }
 
-            // A fence to be used to synchronize between the application/runtime and the composition device.
-            m_fenceOnCompositionDevice = m_compositionDevice->createFence();
-            m_fenceOnApplicationDevice = m_applicationDevice->openFence(m_fenceOnCompositionDevice->getFenceHandle());
-
             TraceLoggingWriteStop(local, "Swapchain_Create", TLPArg(this, "Swapchain"));
         }
 
@@ -217,11 +657,21 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "Swapchain_Destroy", TLPArg(this, "Swapchain"));
 
-            if (m_fenceOnApplicationDevice) {
-                m_fenceOnApplicationDevice->waitOnCpu(m_fenceValue);
+            if (m_prefetchThread.joinable()) {
+                {
+                    std::unique_lock lock(m_prefetchMutex);
+                    m_isPrefetchExiting = true;
+                }
+                m_prefetchWakeUp.notify_all();
+                m_prefetchThread.join();
             }
-            if (m_fenceOnCompositionDevice) {
-                m_fenceOnCompositionDevice->waitOnCpu(m_fenceValue);
+
+            m_timeline->cancelDeferredCommits(this);
+            m_timeline->waitOnCpu();
+            if (m_bounceBufferOnApplicationDevice) {
+                m_texturePool->release(m_infoOnCompositionDevice,
+                                       m_infoOnApplicationDevice,
+                                       {m_bounceBufferOnCompositionDevice, m_bounceBufferOnApplicationDevice});
             }
             if (xrDestroySwapchain) {
                 xrDestroySwapchain(m_swapchain);
@@ -231,57 +681,115 @@ namespace {
         }
 
         ISwapchainImage* acquireImage(bool wait) override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_AcquireImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_AcquireImage", TLPArg(this, "Swapchain"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainAcquire);
+
+            // Wait for a pending prefetch without the swapchain lock, so that the other operations on the swapchain
+            // are not blocked behind the runtime.
+            std::optional<uint32_t> prefetchedImage;
+            bool isPrefetchTimedOut = false;
+            {
+                std::unique_lock prefetchLock(m_prefetchMutex);
+
+                const auto isPrefetchDone = [&] { return !m_isPrefetchRequested; };
+                if (m_prefetchTimeout == XR_INFINITE_DURATION) {
+                    m_prefetchCompleted.wait(prefetchLock, isPrefetchDone);
+                } else {
+                    isPrefetchTimedOut = !m_prefetchCompleted.wait_for(
+                        prefetchLock, std::chrono::nanoseconds(m_prefetchTimeout), isPrefetchDone);
+                }
+
+                if (!isPrefetchTimedOut) {
+                    if (m_prefetchException) {
+                        std::rethrow_exception(std::exchange(m_prefetchException, nullptr));
+                    }
+                    prefetchedImage = std::exchange(m_prefetchedImage, std::nullopt);
+                }
+            }
 
             std::unique_lock lock(m_mutex);
 
+            m_isAcquiredImageReused = isPrefetchTimedOut;
+            if (isPrefetchTimedOut) {
+                // Do not stall the caller, the previous image will be reused.
+                ISwapchainImage* const image =
+                    m_lastCommittedImage.has_value() ? m_images[m_lastCommittedImage.value()].get() : nullptr;
+
+                TraceHotPathWriteStop(local,
+                                      "Swapchain_AcquireImage",
+                                      TLPArg(image, "Image"),
+                                      TLArg(true, "PrefetchTimedOut"));
+
+                return image;
+            }
+
             uint32_t index;
-            CHECK_XRCMD(xrAcquireSwapchainImage(m_swapchain, nullptr, &index));
-            if (wait) {
-                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
-                waitInfo.timeout = XR_INFINITE_DURATION;
-                CHECK_XRCMD(xrWaitSwapchainImage(m_swapchain, &waitInfo));
+            if (prefetchedImage.has_value()) {
+                index = prefetchedImage.value();
+                m_isAcquiredImageWaited = true;
+            } else {
+                CHECK_XRCMD(xrAcquireSwapchainImage(m_swapchain, nullptr, &index));
+                if (wait) {
+                    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                    waitInfo.timeout = XR_INFINITE_DURATION;
+                    CHECK_XRCMD(xrWaitSwapchainImage(m_swapchain, &waitInfo));
+                }
+                m_isAcquiredImageWaited = wait;
             }
 
             // Serialize the operations on the application device that might have occurred when acquiring the swapchain
             // image.
-            m_fenceValue++;
-            m_fenceOnApplicationDevice->signal(m_fenceValue);
-            m_fenceOnCompositionDevice->waitOnDevice(m_fenceValue);
+            m_timeline->applicationWorkSubmitted();
 
             m_acquiredImages.push_back(index);
 
             ISwapchainImage* const image = m_images[index].get();
 
-            TraceLoggingWriteStop(
-                local, "Swapchain_AcquireImage", TLArg(index, "AcquiredIndex"), TLPArg(image, "Image"));
+            TraceHotPathWriteStop(local,
+                                  "Swapchain_AcquireImage",
+                                  TLArg(index, "AcquiredIndex"),
+                                  TLPArg(image, "Image"),
+                                  TLArg(prefetchedImage.has_value(), "Prefetched"));
 
             return image;
         }
 
         void waitImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_WaitImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_WaitImage", TLPArg(this, "Swapchain"));
 
-            // We don't need to check that an image was acquired since OpenXR will do it for us and throw an error
-            // below.
-            XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
-            waitInfo.timeout = XR_INFINITE_DURATION;
-            CHECK_XRCMD(xrWaitSwapchainImage(m_swapchain, &waitInfo));
+            std::unique_lock lock(m_mutex);
+
+            // A prefetched image was already waited on by the worker thread.
+            const bool wasWaited = std::exchange(m_isAcquiredImageWaited, false);
+            if (!wasWaited) {
+                // We don't need to check that an image was acquired since OpenXR will do it for us and throw an error
+                // below.
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = XR_INFINITE_DURATION;
+                CHECK_XRCMD(xrWaitSwapchainImage(m_swapchain, &waitInfo));
+            }
 
-            TraceLoggingWriteStop(local, "Swapchain_WaitImage");
+            TraceHotPathWriteStop(local, "Swapchain_WaitImage", TLArg(wasWaited, "WasWaited"));
         }
 
         void releaseImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_ReleaseImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_ReleaseImage", TLPArg(this, "Swapchain"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainRelease);
 
             std::unique_lock lock(m_mutex);
 
+            m_isAcquiredImageWaited = false;
+
             // We defer release of the OpenXR swapchain to ensure that we will have an opportunity to peek and/or poke
             // its content. If the same swapchain is released multiple times, then only defer the most recent call.
             if (!(m_accessForRead || m_accessForWrite) || m_lastReleasedImage.has_value()) {
+                // The image might still be in use by a copy of the bounce buffer.
+                m_applicationDevice->waitForCopies();
                 CHECK_XRCMD(xrReleaseSwapchainImage(m_swapchain, nullptr));
             } else if (m_acquiredImages.empty()) {
                 throw std::runtime_error("No image was acquired");
@@ -289,73 +797,131 @@ namespace {
 
             m_lastReleasedImage = m_acquiredImages.front();
             m_acquiredImages.pop_front();
+            const uint64_t generation = m_generations.imageReleased(m_images[m_lastReleasedImage.value()].get());
 
-            TraceLoggingWriteStop(local, "Swapchain_ReleaseImage", TLArg(m_lastReleasedImage.value(), "ReleasedIndex"));
+            TraceHotPathWriteStop(local,
+                                  "Swapchain_ReleaseImage",
+                                  TLArg(m_lastReleasedImage.value(), "ReleasedIndex"),
+                                  TLArg(generation, "Generation"));
         }
 
         ISwapchainImage* getLastReleasedImage() const override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
-                                   "Swapchain_GetLastReleasedImage",
-                                   TLPArg(this, "Swapchain"),
-                                   TLArg(m_lastReleasedImage.value_or(-1), "Index"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_GetLastReleasedImage", TLPArg(this, "Swapchain"));
 
             if (!m_accessForRead) {
                 throw std::runtime_error("Not a readable swapchain");
             }
 
+            // releaseImage() and commitLastReleasedImage() may update the last released image concurrently.
+            std::unique_lock lock(m_mutex);
+
             ISwapchainImage* image = nullptr;
             if (m_lastReleasedImage.has_value()) {
                 if (m_bounceBufferOnApplicationDevice) {
                     // The swapchain image wasn't shareable and we must perform a copy to a shareable texture accessible
                     // on the composition device.
-                    m_applicationDevice->copyTexture(m_images[m_lastReleasedImage.value()]->getApplicationTexture(),
-                                                     m_bounceBufferOnApplicationDevice.get());
+                    copyBounceBuffer(m_images[m_lastReleasedImage.value()]->getApplicationTexture(),
+                                     m_bounceBufferOnApplicationDevice.get(),
+                                     m_dirtyRegion);
                 }
 
                 // Serialize the operations on the application device before accessing from the composition device.
-                m_fenceValue++;
-                m_fenceOnApplicationDevice->signal(m_fenceValue);
-                m_fenceOnCompositionDevice->waitOnDevice(m_fenceValue);
+                if (m_bounceBufferOnApplicationDevice) {
+                    m_timeline->applicationWorkSubmitted();
+                } else {
+                    m_timeline->applicationImageReleased();
+                }
 
                 image = m_images[m_lastReleasedImage.value()].get();
+
+                // A writable swapchain is consumed when committing the composition output instead.
+                if (!m_accessForWrite) {
+                    m_generations.imageConsumed();
+                }
             }
 
-            TraceLoggingWriteStop(local, "Swapchain_GetLastReleasedImage", TLPArg(image, "Image"));
+            TraceHotPathWriteStop(local,
+                                  "Swapchain_GetLastReleasedImage",
+                                  TLArg(m_lastReleasedImage.value_or(-1), "Index"),
+                                  TLPArg(image, "Image"));
 
             return image;
         }
 
         void commitLastReleasedImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
-                                   "Swapchain_CommitLastReleasedImage",
-                                   TLPArg(this, "Swapchain"),
-                                   TLArg(m_lastReleasedImage.value_or(-1), "Index"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_CommitLastReleasedImage", TLPArg(this, "Swapchain"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainRelease);
 
             if (!m_accessForWrite) {
                 throw std::runtime_error("Not a writable swapchain");
             }
 
-            if (m_lastReleasedImage.has_value()) {
-                // Serialize the operations on the composition device before copying to the application device or
-                // releasing the swapchain image.
-                m_fenceValue++;
-                m_fenceOnCompositionDevice->signal(m_fenceValue);
-                m_fenceOnApplicationDevice->waitOnDevice(m_fenceValue);
+            // Capture the image to commit before clearing it: the commit might be deferred past a subsequent
+            // releaseImage(), which sets a new last released image.
+            std::optional<uint32_t> index;
+            std::optional<DirtyRegion> dirtyRegion;
+            {
+                std::unique_lock lock(m_mutex);
 
-                if (m_bounceBufferOnApplicationDevice) {
-                    // The swapchain image wasn't shareable and we must perform a copy from a shareable texture written
-                    // on the composition device.
-                    m_applicationDevice->copyTexture(m_bounceBufferOnApplicationDevice.get(),
-                                                     m_images[m_lastReleasedImage.value()]->getApplicationTexture());
+                index = std::exchange(m_lastReleasedImage, std::nullopt);
+                dirtyRegion = m_dirtyRegion;
+                if (index.has_value()) {
+                    m_lastCommittedImage = index;
+                    m_generations.imageConsumed();
                 }
+            }
 
-                CHECK_XRCMD(xrReleaseSwapchainImage(m_swapchain, nullptr));
-                m_lastReleasedImage = {};
+            bool deferred = false;
+            if (index.has_value()) {
+                // Serialize the operations on the composition device before copying to the application device or
+                // releasing the swapchain image. In batched mode, this might be deferred until the end of composition.
+                // The completion takes the swapchain lock, so it must not be invoked with it held.
+                deferred = !m_timeline->waitForComposition(
+                    this, [this, index = index.value(), dirtyRegion] { completeCommit(index, dirtyRegion); });
+            }
+
+            TraceHotPathWriteStop(local,
+                                  "Swapchain_CommitLastReleasedImage",
+                                  TLArg(index.value_or(-1), "Index"),
+                                  TLArg(deferred, "Deferred"));
+        }
+
+        void setLayerGeneration(uint64_t generation) override {
+            m_generations.setLayerGeneration(generation);
+        }
+
+        bool isCompositionNeeded() const override {
+            return m_generations.isCompositionNeeded();
+        }
+
+        void setPrefetch(bool enable, XrDuration timeout) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "Swapchain_SetPrefetch",
+                                   TLPArg(this, "Swapchain"),
+                                   TLArg(enable, "Enable"),
+                                   TLArg(timeout, "Timeout"));
+
+            if (enable && !m_hasOwnership) {
+                throw std::runtime_error("Prefetch requires a swapchain owned by the layer");
+            }
+
+            {
+                std::unique_lock lock(m_prefetchMutex);
+
+                // An image already being prefetched is still handed out by the next acquireImage().
+                m_isPrefetchEnabled = enable;
+                m_prefetchTimeout = timeout;
+            }
+
+            if (enable && !m_prefetchThread.joinable()) {
+                m_prefetchThread = std::thread([this] { prefetchThreadMain(); });
             }
 
-            TraceLoggingWriteStop(local, "Swapchain_CommitLastReleasedImage");
+            TraceLoggingWriteStop(local, "Swapchain_SetPrefetch");
         }
 
         const XrSwapchainCreateInfo& getInfoOnCompositionDevice() const override {
@@ -374,26 +940,168 @@ namespace {
             return (uint32_t)m_images.size();
         }
 
+        bool isAcquiredImageReused() const override {
+            std::unique_lock lock(m_mutex);
+
+            return m_isAcquiredImageReused;
+        }
+
+        bool isSubmittable() const override {
+            return true;
+        }
+
         XrSwapchain getSwapchainHandle() const override {
             return m_swapchain;
         }
 
-        XrSwapchainSubImage getSubImage() const override {
-            XrSwapchainSubImage subImage{};
-            subImage.swapchain = m_swapchain;
-            subImage.imageArrayIndex = 0;
-            subImage.imageRect.offset.x = subImage.imageRect.offset.y = 0;
-            subImage.imageRect.extent.width = m_infoOnCompositionDevice.width;
-            subImage.imageRect.extent.height = m_infoOnCompositionDevice.height;
-            return subImage;
+        XrSwapchainSubImage getSubImage() const override {
+            XrSwapchainSubImage subImage{};
+            subImage.swapchain = m_swapchain;
+            subImage.imageArrayIndex = 0;
+            subImage.imageRect.offset.x = subImage.imageRect.offset.y = 0;
+            subImage.imageRect.extent.width = m_infoOnCompositionDevice.width;
+            subImage.imageRect.extent.height = m_infoOnCompositionDevice.height;
+            return subImage;
+        }
+
+        void setDepthSwapchain(std::shared_ptr<ISwapchain> depthSwapchain) override {
+            m_depthSwapchain = std::move(depthSwapchain);
+        }
+
+        ISwapchain* getDepthSwapchain() const override {
+            return m_depthSwapchain.get();
+        }
+
+        void setDirtyRegion(const XrRect2Di& region, uint32_t firstSlice, uint32_t sliceCount) override {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
+                                   "Swapchain_SetDirtyRegion",
+                                   TLPArg(this, "Swapchain"),
+                                   TLArg(region.offset.x, "X"),
+                                   TLArg(region.offset.y, "Y"),
+                                   TLArg(region.extent.width, "Width"),
+                                   TLArg(region.extent.height, "Height"),
+                                   TLArg(firstSlice, "FirstSlice"),
+                                   TLArg(sliceCount, "SliceCount"));
+
+            m_dirtyRegion = DirtyRegion{region, firstSlice, sliceCount};
+
+            TraceHotPathWriteStop(local, "Swapchain_SetDirtyRegion");
+        }
+
+        void resetDirtyRegion() override {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_ResetDirtyRegion", TLPArg(this, "Swapchain"));
+
+            m_dirtyRegion = {};
+
+            TraceHotPathWriteStop(local, "Swapchain_ResetDirtyRegion");
+        }
+
+        void completeCommit(uint32_t index, const std::optional<DirtyRegion>& dirtyRegion) {
+            if (m_bounceBufferOnApplicationDevice) {
+                // The swapchain image wasn't shareable and we must perform a copy from a shareable texture written on
+                // the composition device.
+                copyBounceBuffer(
+                    m_bounceBufferOnApplicationDevice.get(), m_images[index]->getApplicationTexture(), dirtyRegion);
+            }
+
+            // The runtime may only access the image once the bounce buffer copies have completed.
+            m_applicationDevice->waitForCopies();
+            CHECK_XRCMD(xrReleaseSwapchainImage(m_swapchain, nullptr));
+
+            requestPrefetch();
+        }
+
+        void requestPrefetch() {
+            std::unique_lock lock(m_mutex);
+
+            // Only one image may be waited on at a time, so we can only prefetch once the caller holds no image.
+            if (!m_acquiredImages.empty()) {
+                return;
+            }
+
+            {
+                std::unique_lock prefetchLock(m_prefetchMutex);
+
+                if (!m_isPrefetchEnabled || m_isPrefetchRequested || m_prefetchedImage.has_value()) {
+                    return;
+                }
+                m_isPrefetchRequested = true;
+            }
+            m_prefetchWakeUp.notify_one();
+        }
+
+        void prefetchThreadMain() {
+            std::unique_lock lock(m_prefetchMutex);
+            while (true) {
+                m_prefetchWakeUp.wait(lock, [&] { return m_isPrefetchExiting || m_isPrefetchRequested; });
+                if (m_isPrefetchExiting) {
+                    break;
+                }
+
+                TraceHotPathActivity(local);
+                TraceHotPathWriteStart(local, "Swapchain_Prefetch", TLPArg(this, "Swapchain"));
+
+                lock.unlock();
+
+                std::optional<uint32_t> index;
+                std::exception_ptr exception;
+                try {
+                    uint32_t acquiredIndex;
+                    CHECK_XRCMD(xrAcquireSwapchainImage(m_swapchain, nullptr, &acquiredIndex));
+
+                    // Wait in slices, so that destroying the swapchain is never blocked by the runtime.
+                    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                    waitInfo.timeout = PrefetchWaitSlice;
+                    while (true) {
+                        const XrResult result = xrWaitSwapchainImage(m_swapchain, &waitInfo);
+                        if (result != XR_TIMEOUT_EXPIRED) {
+                            CHECK_XRCMD(result);
+                            index = acquiredIndex;
+                            break;
+                        }
+
+                        std::unique_lock exitLock(m_prefetchMutex);
+                        if (m_isPrefetchExiting) {
+                            break;
+                        }
+                    }
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+
+                lock.lock();
+
+                m_prefetchedImage = index;
+                m_prefetchException = exception;
+                m_isPrefetchRequested = false;
+                m_prefetchCompleted.notify_all();
+
+                TraceHotPathWriteStop(local, "Swapchain_Prefetch", TLArg(index.value_or(-1), "PrefetchedIndex"));
+            }
+        }
+
+        void copyBounceBuffer(IGraphicsTexture* from,
+                              IGraphicsTexture* to,
+                              const std::optional<DirtyRegion>& dirtyRegion) const {
+            if (dirtyRegion.has_value()) {
+                m_applicationDevice->copyTextureRegion(
+                    from, to, dirtyRegion->rect, dirtyRegion->firstSlice, dirtyRegion->sliceCount);
+            } else {
+                m_applicationDevice->copyTexture(from, to);
+            }
         }
 
         const XrSwapchain m_swapchain;
         const int64_t m_formatOnApplicationDevice;
         IGraphicsDevice* const m_compositionDevice;
         IGraphicsDevice* const m_applicationDevice;
+        const std::shared_ptr<SerializationTimeline> m_timeline;
+        const std::shared_ptr<TexturePool> m_texturePool;
         const bool m_accessForRead;
         const bool m_accessForWrite;
+        const bool m_hasOwnership;
 
         PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage{nullptr};
         PFN_xrWaitSwapchainImage xrWaitSwapchainImage{nullptr};
@@ -401,18 +1109,36 @@ namespace {
         PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages{nullptr};
         PFN_xrDestroySwapchain xrDestroySwapchain{nullptr};
 
+        const XrSwapchainCreateInfo m_infoOnApplicationDevice;
         XrSwapchainCreateInfo m_infoOnCompositionDevice;
 
         std::vector<std::unique_ptr<ISwapchainImage>> m_images;
         std::shared_ptr<IGraphicsTexture> m_bounceBufferOnApplicationDevice;
         std::shared_ptr<IGraphicsTexture> m_bounceBufferOnCompositionDevice;
-        std::shared_ptr<IGraphicsFence> m_fenceOnApplicationDevice;
-        std::shared_ptr<IGraphicsFence> m_fenceOnCompositionDevice;
-        mutable uint64_t m_fenceValue{0};
 
-        std::mutex m_mutex;
+        mutable std::mutex m_mutex;
         std::deque<uint32_t> m_acquiredImages;
+        bool m_isAcquiredImageWaited{false};
+        bool m_isAcquiredImageReused{false};
         std::optional<uint32_t> m_lastReleasedImage{};
+        // The image that the runtime presents when the swapchain is submitted without a new release.
+        std::optional<uint32_t> m_lastCommittedImage;
+        std::optional<DirtyRegion> m_dirtyRegion;
+        mutable SwapchainGenerations m_generations;
+
+        std::shared_ptr<ISwapchain> m_depthSwapchain;
+
+        // Acquire and wait of the next image ahead of acquireImage(), when enabled with setPrefetch().
+        std::thread m_prefetchThread;
+        std::mutex m_prefetchMutex;
+        std::condition_variable m_prefetchWakeUp;
+        std::condition_variable m_prefetchCompleted;
+        bool m_isPrefetchEnabled{false};
+        XrDuration m_prefetchTimeout{XR_INFINITE_DURATION};
+        bool m_isPrefetchRequested{false};
+        bool m_isPrefetchExiting{false};
+        std::optional<uint32_t> m_prefetchedImage;
+        std::exception_ptr m_prefetchException;
     };
 
     // A non-submittable swapchain must be accessible on both the application & composition device, however because it
@@ -422,9 +1148,12 @@ namespace {
         NonSubmittableSwapchain(const XrSwapchainCreateInfo& infoOnApplicationDevice,
                                 IGraphicsDevice* applicationDevice,
                                 IGraphicsDevice* compositionDevice,
+                                std::shared_ptr<SerializationTimeline> timeline,
+                                std::shared_ptr<TexturePool> texturePool,
                                 SwapchainMode mode)
-            : m_infoOnCompositionDevice(infoOnApplicationDevice),
-              m_formatOnApplicationDevice(infoOnApplicationDevice.format),
+            : m_infoOnApplicationDevice(infoOnApplicationDevice), m_infoOnCompositionDevice(infoOnApplicationDevice),
+              m_formatOnApplicationDevice(infoOnApplicationDevice.format), m_timeline(timeline),
+              m_texturePool(texturePool),
               m_accessForRead((mode & SwapchainMode::Read) == SwapchainMode::Read),
               m_accessForWrite((mode & SwapchainMode::Write) == SwapchainMode::Write) {
             TraceLocalActivity(local);
@@ -436,14 +1165,12 @@ namespace {
 
             // We only need 2 textures since OpenXR only allows for 1 frame in-flight and we won't submit textures to a
             // compositor that might need >2 images of history.
-            // Make the textures available on the composition device.
+            // Make the textures available on the composition device. Reuse textures from the pool when possible.
             for (uint32_t i = 0; i < 2; i++) {
-                const std::shared_ptr<IGraphicsTexture> textureOnCompositionDevice =
-                    compositionDevice->createTexture(m_infoOnCompositionDevice, true /* shareable */);
-                const std::shared_ptr<IGraphicsTexture> textureOnApplicationDevice = applicationDevice->openTexture(
-                    textureOnCompositionDevice->getTextureHandle(), infoOnApplicationDevice);
+                TexturePair textures = m_texturePool->acquire(m_infoOnCompositionDevice, infoOnApplicationDevice);
                 std::unique_ptr<SwapchainImage> image =
-                    std::make_unique<SwapchainImage>(textureOnApplicationDevice, textureOnCompositionDevice, i);
+                    std::make_unique<SwapchainImage>(textures.onApplicationDevice, textures.onCompositionDevice, i);
+                m_textures.push_back(std::move(textures));
 
                 TraceLoggingWriteTagged(local, "Swapchain_Create", TLPArg(image.get(), "Image"));
 
@@ -456,12 +1183,22 @@ namespace {
         ~NonSubmittableSwapchain() override {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "Swapchain_Destroy", TLPArg(this, "Swapchain"));
+
+            // The textures might still be in use by either device. Wait for them to be idle before handing them to
+            // future swapchains.
+            m_timeline->waitOnCpu();
+            for (TexturePair& textures : m_textures) {
+                m_texturePool->release(m_infoOnCompositionDevice, m_infoOnApplicationDevice, std::move(textures));
+            }
+
             TraceLoggingWriteStop(local, "Swapchain_Destroy");
         }
 
         ISwapchainImage* acquireImage(bool wait) override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_AcquireImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_AcquireImage", TLPArg(this, "Swapchain"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainAcquire);
 
             std::unique_lock lock(m_mutex);
 
@@ -474,15 +1211,15 @@ namespace {
 
             ISwapchainImage* const image = m_images[index].get();
 
-            TraceLoggingWriteStop(
+            TraceHotPathWriteStop(
                 local, "Swapchain_AcquireImage", TLArg(index, "AcquiredIndex"), TLPArg(image, "Image"));
 
             return image;
         }
 
         void waitImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_WaitImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_WaitImage", TLPArg(this, "Swapchain"));
 
             std::unique_lock lock(m_mutex);
 
@@ -490,12 +1227,14 @@ namespace {
                 throw std::runtime_error("No image was acquired");
             }
 
-            TraceLoggingWriteStop(local, "Swapchain_WaitImage");
+            TraceHotPathWriteStop(local, "Swapchain_WaitImage");
         }
 
         void releaseImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "Swapchain_ReleaseImage", TLPArg(this, "Swapchain"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "Swapchain_ReleaseImage", TLPArg(this, "Swapchain"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainRelease);
 
             std::unique_lock lock(m_mutex);
 
@@ -505,13 +1244,17 @@ namespace {
 
             m_lastReleasedImage = m_acquiredImages.front();
             m_acquiredImages.pop_front();
+            const uint64_t generation = m_generations.imageReleased(m_images[m_lastReleasedImage].get());
 
-            TraceLoggingWriteStop(local, "Swapchain_ReleaseImage", TLArg(m_lastReleasedImage, "ReleasedIndex"));
+            TraceHotPathWriteStop(local,
+                                  "Swapchain_ReleaseImage",
+                                  TLArg(m_lastReleasedImage, "ReleasedIndex"),
+                                  TLArg(generation, "Generation"));
         }
 
         ISwapchainImage* getLastReleasedImage() const override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
                                    "Swapchain_GetLastReleasedImage",
                                    TLPArg(this, "Swapchain"),
                                    TLArg(m_lastReleasedImage, "Index"));
@@ -522,23 +1265,59 @@ namespace {
 
             ISwapchainImage* const image = m_images[m_lastReleasedImage].get();
 
-            TraceLoggingWriteStop(local, "Swapchain_GetLastReleasedImage", TLPArg(image, "Image"));
+            // A writable swapchain is consumed when committing the composition output instead.
+            if (!m_accessForWrite) {
+                m_generations.imageConsumed();
+            }
+
+            TraceHotPathWriteStop(local, "Swapchain_GetLastReleasedImage", TLPArg(image, "Image"));
 
             return image;
         }
 
         void commitLastReleasedImage() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
                                    "Swapchain_CommitLastReleasedImage",
                                    TLPArg(this, "Swapchain"),
                                    TLArg(m_lastReleasedImage, "Index"));
 
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::SwapchainRelease);
+
             if (!m_accessForWrite) {
                 throw std::runtime_error("Not a writable swapchain");
             }
 
-            TraceLoggingWriteStop(local, "Swapchain_CommitLastReleasedImage");
+            m_generations.imageConsumed();
+
+            TraceHotPathWriteStop(local, "Swapchain_CommitLastReleasedImage");
+        }
+
+        void setPrefetch(bool enable, XrDuration timeout) override {
+            // The images are never waited on, there is nothing to prefetch.
+        }
+
+        void setLayerGeneration(uint64_t generation) override {
+            m_generations.setLayerGeneration(generation);
+        }
+
+        bool isCompositionNeeded() const override {
+            return m_generations.isCompositionNeeded();
+        }
+
+        void setDepthSwapchain(std::shared_ptr<ISwapchain> depthSwapchain) override {
+            m_depthSwapchain = std::move(depthSwapchain);
+        }
+
+        ISwapchain* getDepthSwapchain() const override {
+            return m_depthSwapchain.get();
+        }
+
+        void setDirtyRegion(const XrRect2Di& region, uint32_t firstSlice, uint32_t sliceCount) override {
+            // The textures are shared between both devices, there are never any copies to restrict.
+        }
+
+        void resetDirtyRegion() override {
         }
 
         const XrSwapchainCreateInfo& getInfoOnCompositionDevice() const override {
@@ -557,6 +1336,14 @@ namespace {
             return (uint32_t)m_images.size();
         }
 
+        bool isAcquiredImageReused() const override {
+            return false;
+        }
+
+        bool isSubmittable() const override {
+            return false;
+        }
+
         XrSwapchain getSwapchainHandle() const override {
             throw std::runtime_error("Not a submittable swapchain");
         }
@@ -565,18 +1352,25 @@ namespace {
             throw std::runtime_error("Not a submittable swapchain");
         }
 
+        const XrSwapchainCreateInfo m_infoOnApplicationDevice;
         const int64_t m_formatOnApplicationDevice;
+        const std::shared_ptr<SerializationTimeline> m_timeline;
+        const std::shared_ptr<TexturePool> m_texturePool;
         const bool m_accessForRead;
         const bool m_accessForWrite;
 
         XrSwapchainCreateInfo m_infoOnCompositionDevice;
 
         std::vector<std::unique_ptr<ISwapchainImage>> m_images;
+        std::vector<TexturePair> m_textures;
 
         std::mutex m_mutex;
         uint32_t m_nextImage{0};
         std::deque<uint32_t> m_acquiredImages;
         uint32_t m_lastReleasedImage{};
+        mutable SwapchainGenerations m_generations;
+
+        std::shared_ptr<ISwapchain> m_depthSwapchain;
     };
 
     struct CompositionFramework : ICompositionFramework {
@@ -586,7 +1380,8 @@ namespace {
                              const XrSessionCreateInfo& sessionInfo,
                              XrSession session,
                              CompositionApi compositionApi)
-            : m_instance(instance), xrGetInstanceProcAddr(xrGetInstanceProcAddr_), m_session(session) {
+            : m_instance(instance), xrGetInstanceProcAddr(xrGetInstanceProcAddr_), m_session(session),
+              m_compositionApi(compositionApi) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "CompositionFramework_Create", TLXArg(session, "Session"));
 
@@ -613,45 +1408,129 @@ namespace {
                     has_XR_KHR_D3D12_enable = true;
                 }
 #endif
+                if (extensionName == XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME) {
+                    m_hasCompositionLayerDepth = true;
+                }
             }
 
-            // Wrap the application device.
+            // Find the application device. It is only wrapped upon first use.
+            bool hasGraphicsBinding = false;
             const XrBaseInStructure* entry = reinterpret_cast<const XrBaseInStructure*>(sessionInfo.next);
-            while (entry && !m_applicationDevice) {
+            while (entry) {
 #ifdef XR_USE_GRAPHICS_API_D3D11
                 if (has_XR_KHR_D3D11_enable && entry->type == XR_TYPE_GRAPHICS_BINDING_D3D11_KHR) {
-                    m_applicationDevice =
-                        internal::wrapApplicationDevice(*reinterpret_cast<const XrGraphicsBindingD3D11KHR*>(entry));
+                    m_d3d11Bindings = *reinterpret_cast<const XrGraphicsBindingD3D11KHR*>(entry);
+                    m_d3d11Bindings->next = nullptr;
+                    hasGraphicsBinding = true;
                     break;
                 }
 #endif
 #ifdef XR_USE_GRAPHICS_API_D3D12
                 if (has_XR_KHR_D3D12_enable && entry->type == XR_TYPE_GRAPHICS_BINDING_D3D12_KHR) {
-                    m_applicationDevice =
-                        internal::wrapApplicationDevice(*reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry));
+                    m_d3d12Bindings = *reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry);
+                    m_d3d12Bindings->next = nullptr;
+                    hasGraphicsBinding = true;
                     break;
                 }
 #endif
                 entry = entry->next;
             }
 
-            if (!m_applicationDevice) {
+            if (!hasGraphicsBinding) {
                 throw std::runtime_error("Application graphics API is not supported");
             }
 
+            TraceLoggingWriteStop(local, "CompositionFramework_Create", TLPArg(this, "CompositionFramework"));
+        }
+
+        ~CompositionFramework() {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "CompositionFramework_Destroy", TLXArg(m_session, "Session"));
+
+            if (m_timeline) {
+                m_timeline->waitOnCpu();
+            }
+
+            TraceLoggingWriteStop(local,
+                                  "CompositionFramework_Destroy",
+                                  TLArg(m_isInitialized.load(std::memory_order_relaxed), "WasInitialized"));
+        }
+
+        // Called upon session or instance destruction, so the workers are never joined while holding the loader lock.
+        void stopCompositionWorkers() {
+            if (m_taskScheduler) {
+                m_taskScheduler->stop();
+            }
+        }
+
+        // The devices, fences and format tables are created upon first use. Sessions where the layer never composites
+        // do not pay for them.
+        void ensureInitialized() const {
+            if (m_isInitialized.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::unique_lock lock(m_initializeMutex);
+            if (!m_isInitialized.load(std::memory_order_relaxed)) {
+                const_cast<CompositionFramework*>(this)->initialize();
+                m_isInitialized.store(true, std::memory_order_release);
+            }
+        }
+
+        void initialize() {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "CompositionFramework_Initialize", TLXArg(m_session, "Session"));
+
+            // Wrap the application device.
+#ifdef XR_USE_GRAPHICS_API_D3D11
+            if (m_d3d11Bindings) {
+                m_applicationDevice = internal::wrapApplicationDevice(m_d3d11Bindings.value());
+            }
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+            if (m_d3d12Bindings) {
+                m_applicationDevice = internal::wrapApplicationDevice(m_d3d12Bindings.value());
+            }
+#endif
+
             // Create the device for composition according to the API layer's request.
-            switch (compositionApi) {
+            switch (m_compositionApi) {
 #ifdef XR_USE_GRAPHICS_API_D3D11
             case CompositionApi::D3D11:
                 m_compositionDevice = internal::createD3D11CompositionDevice(m_applicationDevice->getAdapterLuid());
                 break;
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+            case CompositionApi::D3D12:
+                if (m_applicationDevice->getApi() == Api::D3D12) {
+                    // Share the application's device, which lets us alias the swapchain images without any copy.
+                    m_compositionDevice =
+                        internal::createD3D12CompositionDevice(m_applicationDevice->getNativeDevice<D3D12>());
+                } else {
+                    m_compositionDevice =
+                        internal::createD3D12CompositionDevice(m_applicationDevice->getAdapterLuid());
+                }
+                break;
 #endif
             default:
                 throw std::runtime_error("Composition graphics API is not supported");
             }
 
-            m_fenceOnCompositionDevice = m_compositionDevice->createFence();
-            m_fenceOnApplicationDevice = m_applicationDevice->openFence(m_fenceOnCompositionDevice->getFenceHandle());
+            m_timeline = std::make_shared<SerializationTimeline>(m_applicationDevice.get(), m_compositionDevice.get());
+            m_timeline->setMode(m_serializationMode);
+            m_texturePool = std::make_shared<TexturePool>(m_applicationDevice.get(), m_compositionDevice.get());
+            if (m_texturePoolBudget) {
+                m_texturePool->setBudget(m_texturePoolBudget.value());
+            }
+
+            // The GPU timer costs an extra submission every frame, only pay for it when recording metrics.
+            if (metrics::IsEnabled()) {
+                m_timerPool = m_compositionDevice->createTimerPool(1);
+                m_compositionTimer = m_timerPool->createTimer("Composition");
+            }
+
+            refreshMemoryBudget();
+            m_lastMemoryBudgetRefreshTime = metrics::Now();
 
             // Check for quirks.
             PFN_xrGetInstanceProperties xrGetInstanceProperties;
@@ -659,13 +1538,14 @@ namespace {
                                               "xrGetInstanceProperties",
                                               reinterpret_cast<PFN_xrVoidFunction*>(&xrGetInstanceProperties)));
             XrInstanceProperties instanceProperties{XR_TYPE_INSTANCE_PROPERTIES};
-            CHECK_XRCMD(xrGetInstanceProperties(instance, &instanceProperties));
+            CHECK_XRCMD(xrGetInstanceProperties(m_instance, &instanceProperties));
             const std::string_view runtimeName(instanceProperties.runtimeName);
 #ifdef XR_USE_GRAPHICS_API_D3D12
             if (runtimeName.find("Windows Mixed Reality") == std::string::npos &&
-                m_applicationDevice->getApi() == Api::D3D12) {
+                m_applicationDevice->getApi() == Api::D3D12 && m_compositionDevice->getApi() != Api::D3D12) {
                 // Quirk: only WMR seems to implement a full D3D12 compositor. Other runtimes seem to use D3D11 and
                 // despite of D3D12 textures having the shareable flag, they are not shareable with D3D11.
+                // This does not apply to a D3D12 composition device, which uses the application's device.
                 m_overrideShareable = false;
             }
 #endif
@@ -695,24 +1575,11 @@ namespace {
                     m_preferredDepthFormat = format;
                 }
             }
-            TraceLoggingWriteTagged(local,
-                                    "CompositionFramework_Create",
-                                    TLArg((int64_t)m_preferredColorFormat, "PreferredColorFormat"),
-                                    TLArg((int64_t)m_preferredSRGBColorFormat, "PreferredSRGBColorFormat"),
-                                    TLArg((int64_t)m_preferredDepthFormat, "PreferredDepthFormat"));
-
-            TraceLoggingWriteStop(local, "CompositionFramework_Create", TLPArg(this, "CompositionFramework"));
-        }
-
-        ~CompositionFramework() {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "CompositionFramework_Destroy", TLXArg(m_session, "Session"));
-
-            if (m_fenceOnCompositionDevice) {
-                m_fenceOnCompositionDevice->waitOnCpu(m_fenceValue);
-            }
-
-            TraceLoggingWriteStop(local, "CompositionFramework_Destroy");
+            TraceLoggingWriteStop(local,
+                                  "CompositionFramework_Initialize",
+                                  TLArg((int64_t)m_preferredColorFormat, "PreferredColorFormat"),
+                                  TLArg((int64_t)m_preferredSRGBColorFormat, "PreferredSRGBColorFormat"),
+                                  TLArg((int64_t)m_preferredDepthFormat, "PreferredDepthFormat"));
         }
 
         XrSession getSessionHandle() const override {
@@ -752,6 +1619,8 @@ namespace {
                                    TLArg(infoOnApplicationDevice.usageFlags, "UsageFlags"),
                                    TLArg((int)mode, "Mode"));
 
+            ensureInitialized();
+
             std::shared_ptr<ISwapchain> result;
             if ((mode & SwapchainMode::Submit) == SwapchainMode::Submit) {
                 XrSwapchain swapchain;
@@ -764,11 +1633,17 @@ namespace {
                                                                 infoOnApplicationDevice,
                                                                 m_applicationDevice.get(),
                                                                 m_compositionDevice.get(),
+                                                                m_timeline,
+                                                                m_texturePool,
                                                                 mode,
                                                                 m_overrideShareable);
             } else {
-                result = std::make_shared<NonSubmittableSwapchain>(
-                    infoOnApplicationDevice, m_applicationDevice.get(), m_compositionDevice.get(), mode);
+                result = std::make_shared<NonSubmittableSwapchain>(infoOnApplicationDevice,
+                                                                   m_applicationDevice.get(),
+                                                                   m_compositionDevice.get(),
+                                                                   m_timeline,
+                                                                   m_texturePool,
+                                                                   mode);
             }
 
             TraceLoggingWriteStop(local, "CompositionFramework_CreateSwapchain", TLPArg(result.get(), "Swapchain"));
@@ -776,43 +1651,272 @@ namespace {
             return result;
         }
 
-        void serializePreComposition() override {
+        std::shared_ptr<ISwapchain> createDepthSwapchain(ISwapchain* colorSwapchain, SwapchainMode mode) override {
             TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "CompositionFramework_SerializePreComposition", TLXArg(m_session, "Session"));
+            TraceLoggingWriteStart(local,
+                                   "CompositionFramework_CreateDepthSwapchain",
+                                   TLXArg(m_session, "Session"),
+                                   TLPArg(colorSwapchain, "ColorSwapchain"),
+                                   TLArg((int)mode, "Mode"));
 
-            std::unique_lock lock(m_fenceMutex);
+            ensureInitialized();
 
-            m_fenceValue++;
-            m_fenceOnApplicationDevice->signal(m_fenceValue);
-            m_fenceOnCompositionDevice->waitOnDevice(m_fenceValue);
+            const XrSwapchainCreateInfo& colorInfo = colorSwapchain->getInfoOnCompositionDevice();
+            XrSwapchainCreateInfo depthInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            depthInfo.usageFlags = XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            if ((mode & SwapchainMode::Read) == SwapchainMode::Read) {
+                depthInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+            }
+            depthInfo.format = getPreferredSwapchainFormatOnApplicationDevice(depthInfo.usageFlags);
+            if (m_preferredDepthFormat == DXGI_FORMAT_UNKNOWN) {
+                throw std::runtime_error("No depth format is supported by the runtime");
+            }
+            depthInfo.width = colorInfo.width;
+            depthInfo.height = colorInfo.height;
+            depthInfo.arraySize = colorInfo.arraySize;
+            depthInfo.sampleCount = colorInfo.sampleCount;
+            depthInfo.faceCount = depthInfo.mipCount = 1;
+
+            std::shared_ptr<ISwapchain> result = createSwapchain(depthInfo, mode);
+            colorSwapchain->setDepthSwapchain(result);
+
+            TraceLoggingWriteStop(
+                local, "CompositionFramework_CreateDepthSwapchain", TLPArg(result.get(), "DepthSwapchain"));
+
+            return result;
+        }
+
+        bool isDepthSubmissionSupported() const override {
+            return m_hasCompositionLayerDepth;
+        }
+
+        bool attachDepthInfo(XrCompositionLayerProjectionView& view,
+                             XrCompositionLayerDepthInfoKHR& depthInfo,
+                             const ISwapchain* depthSwapchain,
+                             float nearZ,
+                             float farZ,
+                             float minDepth,
+                             float maxDepth) const override {
+            // Only a submittable depth swapchain can be attached. Anything else is ignored, not failing the frame.
+            if (!m_hasCompositionLayerDepth || !depthSwapchain || !depthSwapchain->isSubmittable() ||
+                !depthSwapchain->getSwapchainHandle()) {
+                return false;
+            }
+
+            // The depth swapchain has the dimensions of the color swapchain, and the view's sub-image applies to both.
+            depthInfo = {XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR};
+            depthInfo.subImage = view.subImage;
+            depthInfo.subImage.swapchain = depthSwapchain->getSwapchainHandle();
+            depthInfo.minDepth = minDepth;
+            depthInfo.maxDepth = maxDepth;
+            depthInfo.nearZ = nearZ;
+            depthInfo.farZ = farZ;
+
+            depthInfo.next = view.next;
+            view.next = &depthInfo;
 
-            TraceLoggingWriteStop(local, "CompositionFramework_SerializePreComposition");
+            return true;
+        }
+
+        void serializePreComposition() override {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "CompositionFramework_SerializePreComposition", TLXArg(m_session, "Session"));
+
+            // Nothing was ever created for composition, therefore there is nothing to serialize.
+            if (!m_isInitialized.load(std::memory_order_acquire)) {
+                TraceHotPathWriteStop(local, "CompositionFramework_SerializePreComposition", TLArg(true, "Skipped"));
+                return;
+            }
+
+            const uint64_t startTime = metrics::Now();
+
+            if (startTime - m_lastMemoryBudgetRefreshTime >= MemoryBudgetRefreshInterval) {
+                refreshMemoryBudget();
+                m_lastMemoryBudgetRefreshTime = startTime;
+            }
+
+            m_timeline->beginComposition();
+            if (m_compositionTimer) {
+                m_compositionTimer->start();
+            }
+            m_isCompositionInProgress = true;
+
+            if (metrics::IsEnabled()) {
+                metrics::Record(metrics::Stage::SerializePreComposition, metrics::Now() - startTime);
+            }
+
+            TraceHotPathWriteStop(local, "CompositionFramework_SerializePreComposition");
         }
 
         void serializePostComposition() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(
                 local, "CompositionFramework_SerializePostComposition", TLXArg(m_session, "Session"));
 
-            std::unique_lock lock(m_fenceMutex);
+            // Only end a composition that serializePreComposition() began.
+            if (!m_isCompositionInProgress) {
+                TraceHotPathWriteStop(local, "CompositionFramework_SerializePostComposition", TLArg(true, "Skipped"));
+                return;
+            }
+
+            const bool isMetricsEnabled = metrics::IsEnabled();
+            const uint64_t startTime = isMetricsEnabled ? metrics::Now() : 0;
 
-            m_fenceValue++;
-            m_fenceOnCompositionDevice->signal(m_fenceValue);
-            m_fenceOnApplicationDevice->waitOnDevice(m_fenceValue);
+            if (m_compositionTimer) {
+                m_compositionTimer->stop();
+            }
+            m_timeline->endComposition();
+            m_isCompositionInProgress = false;
+
+            if (isMetricsEnabled) {
+                // This is the latest completed measurement, which is typically a few frames old.
+                if (m_compositionTimer) {
+                    metrics::Record(metrics::Stage::GpuComposition, m_compositionTimer->query());
+                }
+                metrics::Record(metrics::Stage::SerializePostComposition, metrics::Now() - startTime);
+            }
+
+            TraceHotPathWriteStop(local, "CompositionFramework_SerializePostComposition");
+        }
+
+        void runCompositionTasks(const std::vector<std::function<void(IGraphicsCommandContext*)>>& tasks) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "CompositionFramework_RunCompositionTasks",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg(tasks.size(), "Count"));
+
+            ensureInitialized();
+
+            if (!m_taskScheduler) {
+                const uint32_t workerCount =
+                    std::clamp(std::thread::hardware_concurrency() / 2, 1u, MaxCompositionWorkers + 1) - 1;
+                m_taskScheduler = std::make_unique<openxr_api_layer::utils::general::TaskScheduler>(workerCount);
+            }
+
+            std::vector<std::unique_ptr<IGraphicsCommandContext>> contexts;
+            contexts.reserve(tasks.size());
+            for (size_t i = 0; i < tasks.size(); i++) {
+                contexts.push_back(m_compositionDevice->acquireCommandContext());
+            }
+
+            m_taskScheduler->parallelFor(tasks.size(), [&](size_t index) { tasks[index](contexts[index].get()); });
+
+            m_compositionDevice->submitCommandContexts(std::move(contexts));
+
+            TraceLoggingWriteStop(local, "CompositionFramework_RunCompositionTasks");
+        }
+
+        void setTexturePoolBudget(uint64_t budgetBytes) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "CompositionFramework_SetTexturePoolBudget",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg(budgetBytes, "BudgetBytes"));
+
+            if (m_isInitialized.load(std::memory_order_acquire)) {
+                m_texturePool->setBudget(budgetBytes);
+            } else {
+                std::unique_lock lock(m_initializeMutex);
+                if (m_texturePool) {
+                    m_texturePool->setBudget(budgetBytes);
+                } else {
+                    m_texturePoolBudget = budgetBytes;
+                }
+            }
+
+            TraceLoggingWriteStop(local, "CompositionFramework_SetTexturePoolBudget");
+        }
+
+        MemoryBudget getMemoryBudget() const override {
+            std::unique_lock lock(m_memoryBudgetMutex);
+
+            return m_memoryBudget;
+        }
+
+        uint64_t getAllocatedMemory(MemoryCategory category) const override {
+            if (!m_isInitialized.load(std::memory_order_acquire)) {
+                return 0;
+            }
+
+            return m_applicationDevice->getAllocatedMemory(category) +
+                   m_compositionDevice->getAllocatedMemory(category);
+        }
+
+        void setLowMemoryThreshold(float fraction) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "CompositionFramework_SetLowMemoryThreshold",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg(fraction, "Fraction"));
+
+            // Takes effect upon the next refresh of the budget.
+            m_lowMemoryThreshold.store(fraction, std::memory_order_relaxed);
+
+            TraceLoggingWriteStop(local, "CompositionFramework_SetLowMemoryThreshold");
+        }
 
-            TraceLoggingWriteStop(local, "CompositionFramework_SerializePostComposition");
+        bool isLowOnMemory() const override {
+            return m_isLowOnMemory.load(std::memory_order_relaxed);
+        }
+
+        void setSerializationMode(SerializationMode mode) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "CompositionFramework_SetSerializationMode",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg((int)mode, "Mode"));
+
+            if (m_isInitialized.load(std::memory_order_acquire)) {
+                m_timeline->setMode(mode);
+            } else {
+                std::unique_lock lock(m_initializeMutex);
+                if (m_timeline) {
+                    m_timeline->setMode(mode);
+                } else {
+                    m_serializationMode = mode;
+                }
+            }
+
+            TraceLoggingWriteStop(local, "CompositionFramework_SetSerializationMode");
         }
 
         IGraphicsDevice* getCompositionDevice() const override {
+            ensureInitialized();
             return m_compositionDevice.get();
         }
 
         IGraphicsDevice* getApplicationDevice() const override {
+            ensureInitialized();
             return m_applicationDevice.get();
         }
 
+        void getGazeUVCoordinates(const XrPosef& gaze,
+                                  const XrCompositionLayerProjectionView* views,
+                                  const XrExtent2Di* swapchainExtents,
+                                  uint32_t viewCount,
+                                  std::optional<XrVector2f>* uvs) const override {
+            for (uint32_t i = 0; i < viewCount; i++) {
+                XrVector2f uvInView;
+                if (!openxr_api_layer::utils::general::getGazeUVCoordinates(
+                        gaze, views[i].pose, views[i].fov, uvInView)) {
+                    uvs[i] = {};
+                    continue;
+                }
+
+                // Map from the image rectangle to the whole swapchain.
+                const XrRect2Di& imageRect = views[i].subImage.imageRect;
+                uvs[i] = XrVector2f{
+                    (imageRect.offset.x + uvInView.x * imageRect.extent.width) / swapchainExtents[i].width,
+                    (imageRect.offset.y + uvInView.y * imageRect.extent.height) / swapchainExtents[i].height,
+                };
+            }
+        }
+
         int64_t getPreferredSwapchainFormatOnApplicationDevice(XrSwapchainUsageFlags usageFlags,
                                                                bool preferSRGB) const override {
+            ensureInitialized();
+
             DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
             if (usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
                 format = preferSRGB ? m_preferredSRGBColorFormat : m_preferredColorFormat;
@@ -822,22 +1926,80 @@ namespace {
             return m_applicationDevice->translateFromGenericFormat(format);
         }
 
+        // Both devices are on the same adapter, so the budget is the same for both.
+        void refreshMemoryBudget() {
+            const MemoryBudget budget = m_compositionDevice->queryMemoryBudget();
+            {
+                std::unique_lock lock(m_memoryBudgetMutex);
+
+                m_memoryBudget = budget;
+            }
+
+            const double threshold = m_lowMemoryThreshold.load(std::memory_order_relaxed);
+            const bool isLowOnMemory = budget.budget && budget.currentUsage > budget.budget * threshold;
+            if (isLowOnMemory == m_isLowOnMemory.exchange(isLowOnMemory, std::memory_order_relaxed)) {
+                return;
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "CompositionFramework_MemoryBudget",
+                              TLXArg(m_session, "Session"),
+                              TLArg(isLowOnMemory, "IsLowOnMemory"),
+                              TLArg(budget.budget, "Budget"),
+                              TLArg(budget.currentUsage, "CurrentUsage"),
+                              TLArg(getAllocatedMemory(MemoryCategory::Texture), "AllocatedTextureMemory"));
+            if (isLowOnMemory) {
+                Log(fmt::format("Low on video memory: usage is {} MB, budget is {} MB, layer textures use {} MB\n",
+                                budget.currentUsage >> 20,
+                                budget.budget >> 20,
+                                getAllocatedMemory(MemoryCategory::Texture) >> 20));
+            }
+
+            m_texturePool->setLowOnMemory(isLowOnMemory);
+        }
+
         const XrInstance m_instance;
         const PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr;
         const XrSession m_session;
+        const CompositionApi m_compositionApi;
 
         std::unique_ptr<ICompositionSessionData> m_sessionData;
 
+#ifdef XR_USE_GRAPHICS_API_D3D11
+        std::optional<XrGraphicsBindingD3D11KHR> m_d3d11Bindings;
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+        std::optional<XrGraphicsBindingD3D12KHR> m_d3d12Bindings;
+#endif
+
+        mutable std::mutex m_initializeMutex;
+        mutable std::atomic<bool> m_isInitialized{false};
+        SerializationMode m_serializationMode{SerializationMode::Immediate};
+        std::optional<uint64_t> m_texturePoolBudget;
+        bool m_isCompositionInProgress{false};
+        bool m_hasCompositionLayerDepth{false};
+
         std::shared_ptr<IGraphicsDevice> m_compositionDevice;
         std::shared_ptr<IGraphicsDevice> m_applicationDevice;
         DXGI_FORMAT m_preferredColorFormat{DXGI_FORMAT_UNKNOWN};
         DXGI_FORMAT m_preferredSRGBColorFormat{DXGI_FORMAT_UNKNOWN};
         DXGI_FORMAT m_preferredDepthFormat{DXGI_FORMAT_UNKNOWN};
 
-        std::mutex m_fenceMutex;
-        std::shared_ptr<IGraphicsFence> m_fenceOnApplicationDevice;
-        std::shared_ptr<IGraphicsFence> m_fenceOnCompositionDevice;
-        uint64_t m_fenceValue{0};
+        std::shared_ptr<SerializationTimeline> m_timeline;
+        std::shared_ptr<TexturePool> m_texturePool;
+
+        std::shared_ptr<IGraphicsTimerPool> m_timerPool;
+        std::shared_ptr<IGraphicsTimer> m_compositionTimer;
+
+        mutable std::mutex m_memoryBudgetMutex;
+        MemoryBudget m_memoryBudget;
+        uint64_t m_lastMemoryBudgetRefreshTime{0};
+        std::atomic<float> m_lowMemoryThreshold{DefaultLowMemoryThreshold};
+        std::atomic<bool> m_isLowOnMemory{false};
+
+        // The calling thread always runs tasks too.
+        static constexpr uint32_t MaxCompositionWorkers = 3;
+        std::unique_ptr<openxr_api_layer::utils::general::TaskScheduler> m_taskScheduler;
 
 #ifdef XR_USE_GRAPHICS_API_D3D12
         std::optional<bool> m_overrideShareable;
@@ -875,6 +2037,10 @@ namespace {
             m_instanceInfo.enabledExtensionNames = m_instanceExtensionsArray.data();
 
             // xrCreateSession() and xrDestroySession() function pointers are chained.
+            m_hooks = {
+                {"xrCreateSession", &xrCreateSession, hookCreateSession},
+                {"xrDestroySession", &xrDestroySession, hookDestroySession},
+            };
 
             TraceLoggingWriteStop(
                 local, "CompositionFrameworkFactory_Create", TLPArg(this, "CompositionFrameworkFactory"));
@@ -884,6 +2050,11 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "CompositionFrameworkFactory_Destroy");
 
+            // Sessions that the application did not destroy.
+            m_sessions.forEach([](CompositionFramework& compositionFramework) {
+                compositionFramework.stopCompositionWorkers();
+            });
+
             std::unique_lock lock(factoryMutex);
 
             factory = nullptr;
@@ -892,26 +2063,12 @@ namespace {
         }
 
         void xrGetInstanceProcAddr_post(XrInstance instance, const char* name, PFN_xrVoidFunction* function) override {
-            const std::string_view functionName(name);
-            if (functionName == "xrCreateSession") {
-                xrCreateSession = reinterpret_cast<PFN_xrCreateSession>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookCreateSession);
-            } else if (functionName == "xrDestroySession") {
-                xrDestroySession = reinterpret_cast<PFN_xrDestroySession>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookDestroySession);
-            }
+            m_hooks.hook(name, function);
         }
 
         ICompositionFramework* getCompositionFramework(XrSession session) override {
-            std::unique_lock lock(m_sessionsMutex);
-
-            auto it = m_sessions.find(session);
-            if (it == m_sessions.end()) {
-                // The session (likely) could not be handled.
-                return nullptr;
-            }
-
-            return it->second.get();
+            // A null result means the session (likely) could not be handled.
+            return m_sessions.get(session);
         }
 
         XrResult xrCreateSession_subst(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
@@ -920,16 +2077,14 @@ namespace {
 
             const XrResult result = xrCreateSession(instance, createInfo, session);
             if (XR_SUCCEEDED(result)) {
-                std::unique_lock lock(m_sessionsMutex);
-
                 try {
-                    m_sessions.insert_or_assign(*session,
-                                                std::move(std::make_unique<CompositionFramework>(m_instanceInfo,
-                                                                                                 m_instance,
-                                                                                                 xrGetInstanceProcAddr,
-                                                                                                 *createInfo,
-                                                                                                 *session,
-                                                                                                 m_compositionApi)));
+                    m_sessions.insert(*session,
+                                      std::make_unique<CompositionFramework>(m_instanceInfo,
+                                                                             m_instance,
+                                                                             xrGetInstanceProcAddr,
+                                                                             *createInfo,
+                                                                             *session,
+                                                                             m_compositionApi));
                 } catch (std::exception& exc) {
                     TraceLoggingWriteTagged(
                         local, "CompositionFrameworkFactory_CreateSession_Error", TLArg(exc.what(), "Error"));
@@ -949,14 +2104,11 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "CompositionFrameworkFactory_DestroySession", TLXArg(session, "Session"));
 
-            {
-                std::unique_lock lock(m_sessionsMutex);
-
-                auto it = m_sessions.find(session);
-                if (it != m_sessions.end()) {
-                    m_sessions.erase(it);
-                }
+            CompositionFramework* const compositionFramework = m_sessions.get(session);
+            if (compositionFramework) {
+                compositionFramework->stopCompositionWorkers();
             }
+            m_sessions.erase(session);
             const XrResult result = xrDestroySession(session);
 
             TraceLoggingWriteStop(
@@ -972,11 +2124,11 @@ namespace {
         std::vector<std::string> m_instanceExtensions;
         std::vector<const char*> m_instanceExtensionsArray;
 
-        std::mutex m_sessionsMutex;
-        std::unordered_map<XrSession, std::unique_ptr<CompositionFramework>> m_sessions;
+        openxr_api_layer::utils::general::SessionRegistry<CompositionFramework> m_sessions;
 
         PFN_xrCreateSession xrCreateSession{nullptr};
         PFN_xrDestroySession xrDestroySession{nullptr};
+        openxr_api_layer::utils::general::FunctionHooks m_hooks;
 
         static inline std::mutex factoryMutex;
         static inline CompositionFrameworkFactory* factory{nullptr};
@@ -996,6 +2148,59 @@ namespace {
 
 namespace openxr_api_layer::utils::graphics {
 
+    namespace internal {
+
+        uint64_t estimateTextureSize(const XrSwapchainCreateInfo& info) {
+            uint64_t bitsPerPixel = 32;
+            switch ((DXGI_FORMAT)info.format) {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_UINT:
+            case DXGI_FORMAT_R32G32B32A32_SINT:
+                bitsPerPixel = 128;
+                break;
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R16G16B16A16_UINT:
+            case DXGI_FORMAT_R16G16B16A16_SNORM:
+            case DXGI_FORMAT_R16G16B16A16_SINT:
+            case DXGI_FORMAT_R32G32_FLOAT:
+            case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+                bitsPerPixel = 64;
+                break;
+            case DXGI_FORMAT_D16_UNORM:
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R8G8_UNORM:
+                bitsPerPixel = 16;
+                break;
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                bitsPerPixel = 8;
+                break;
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+                bitsPerPixel = 4;
+                break;
+            default:
+                break;
+            }
+
+            uint64_t size = (uint64_t)info.width * info.height * std::max(info.arraySize, 1u) *
+                            std::max(info.faceCount, 1u) * std::max(info.sampleCount, 1u) * bitsPerPixel / 8;
+            if (info.mipCount > 1) {
+                // A full mip chain adds about a third.
+                size += size / 3;
+            }
+            return size;
+        }
+
+    } // namespace internal
+
     std::shared_ptr<ICompositionFrameworkFactory>
     createCompositionFrameworkFactory(const XrInstanceCreateInfo& instanceInfo,
                                       XrInstance instance,
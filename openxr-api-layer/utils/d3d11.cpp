@@ -66,24 +66,19 @@ namespace {
         }
 
         void start() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "D3D11Timer_Start", TLPArg(this, "Timer"));
-
-            m_context->Begin(m_timeStampDis.Get());
-            m_context->End(m_timeStampStart.Get());
-
-            TraceLoggingWriteStop(local, "D3D11Timer_Start");
+            start(m_context.Get());
         }
 
         void stop() override {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "D3D11Timer_Stop", TLPArg(this, "Timer"));
+            stop(m_context.Get());
+        }
 
-            m_context->End(m_timeStampEnd.Get());
-            m_context->End(m_timeStampDis.Get());
-            m_valid = true;
+        void start(IGraphicsCommandContext* context) override {
+            start(context->getNativeContext<D3D11>());
+        }
 
-            TraceLoggingWriteStop(local, "D3D11Timer_Stop");
+        void stop(IGraphicsCommandContext* context) override {
+            stop(context->getNativeContext<D3D11>());
         }
 
         uint64_t query() const override {
@@ -110,6 +105,27 @@ namespace {
             return duration;
         }
 
+        void start(ID3D11DeviceContext* context) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D11Timer_Start", TLPArg(this, "Timer"));
+
+            context->Begin(m_timeStampDis.Get());
+            context->End(m_timeStampStart.Get());
+
+            TraceLoggingWriteStop(local, "D3D11Timer_Start");
+        }
+
+        void stop(ID3D11DeviceContext* context) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D11Timer_Stop", TLPArg(this, "Timer"));
+
+            context->End(m_timeStampEnd.Get());
+            context->End(m_timeStampDis.Get());
+            m_valid = true;
+
+            TraceLoggingWriteStop(local, "D3D11Timer_Stop");
+        }
+
         ComPtr<ID3D11DeviceContext> m_context;
         ComPtr<ID3D11Query> m_timeStampDis;
         ComPtr<ID3D11Query> m_timeStampStart;
@@ -119,6 +135,181 @@ namespace {
         mutable bool m_valid{false};
     };
 
+    struct D3D11TimerPool;
+
+    // A timer cycling through a ring of queries.
+    struct D3D11PooledTimer : IGraphicsTimer {
+        D3D11PooledTimer(std::shared_ptr<D3D11TimerPool> pool,
+                         ID3D11Device* device,
+                         const std::string& name,
+                         uint32_t latency)
+            : m_pool(pool), m_name(name) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D11PooledTimer_Create", TLArg(m_name.c_str(), "Name"));
+
+            device->GetImmediateContext(m_context.ReleaseAndGetAddressOf());
+
+            m_slots.resize(latency);
+            for (Slot& slot : m_slots) {
+                D3D11_QUERY_DESC queryDesc;
+                ZeroMemory(&queryDesc, sizeof(D3D11_QUERY_DESC));
+                queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+                CHECK_HRCMD(device->CreateQuery(&queryDesc, slot.timeStampDis.ReleaseAndGetAddressOf()));
+                queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+                CHECK_HRCMD(device->CreateQuery(&queryDesc, slot.timeStampStart.ReleaseAndGetAddressOf()));
+                CHECK_HRCMD(device->CreateQuery(&queryDesc, slot.timeStampEnd.ReleaseAndGetAddressOf()));
+            }
+
+            TraceLoggingWriteStop(local, "D3D11PooledTimer_Create", TLPArg(this, "Timer"));
+        }
+
+        ~D3D11PooledTimer() override;
+
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+
+        void start() override {
+            start(m_context.Get());
+        }
+
+        void stop() override {
+            stop(m_context.Get());
+        }
+
+        void start(IGraphicsCommandContext* context) override {
+            start(context->getNativeContext<D3D11>());
+        }
+
+        void stop(IGraphicsCommandContext* context) override {
+            stop(context->getNativeContext<D3D11>());
+        }
+
+        uint64_t query() const override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D11PooledTimer_Query", TLPArg(this, "Timer"), TLArg(m_name.c_str(), "Name"));
+
+            // Look for the most recent measurement that is available, without forcing a flush.
+            for (uint32_t i = 1; i <= m_slots.size(); i++) {
+                Slot& slot = m_slots[(m_nextSlot + m_slots.size() - i) % m_slots.size()];
+                if (slot.sequence <= m_lastReadSequence) {
+                    break;
+                }
+
+                UINT64 startime = 0, endtime = 0;
+                D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disData = {0};
+                if (m_context->GetData(slot.timeStampDis.Get(),
+                                       &disData,
+                                       sizeof(D3D11_QUERY_DATA_TIMESTAMP_DISJOINT),
+                                       D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                    m_context->GetData(
+                        slot.timeStampStart.Get(), &startime, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                    m_context->GetData(
+                        slot.timeStampEnd.Get(), &endtime, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK) {
+                    if (!disData.Disjoint) {
+                        m_lastDuration = static_cast<uint64_t>(((endtime - startime) * 1e6) / disData.Frequency);
+                    }
+                    m_lastReadSequence = slot.sequence;
+                    break;
+                }
+            }
+
+            TraceLoggingWriteStop(local, "D3D11PooledTimer_Query", TLArg(m_lastDuration, "Duration"));
+
+            return m_lastDuration;
+        }
+
+        struct Slot {
+            ComPtr<ID3D11Query> timeStampDis;
+            ComPtr<ID3D11Query> timeStampStart;
+            ComPtr<ID3D11Query> timeStampEnd;
+            uint64_t sequence{0};
+        };
+
+        // The queries of a deferred context execute with the context, and can be read from the immediate context.
+        void start(ID3D11DeviceContext* context) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D11PooledTimer_Start", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            Slot& slot = m_slots[m_nextSlot];
+            context->Begin(slot.timeStampDis.Get());
+            context->End(slot.timeStampStart.Get());
+
+            TraceLoggingWriteStop(local, "D3D11PooledTimer_Start");
+        }
+
+        void stop(ID3D11DeviceContext* context) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D11PooledTimer_Stop", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            Slot& slot = m_slots[m_nextSlot];
+            context->End(slot.timeStampEnd.Get());
+            context->End(slot.timeStampDis.Get());
+            slot.sequence = ++m_sequence;
+            m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+            TraceLoggingWriteStop(local, "D3D11PooledTimer_Stop");
+        }
+
+        const std::shared_ptr<D3D11TimerPool> m_pool;
+        const std::string m_name;
+        ComPtr<ID3D11DeviceContext> m_context;
+
+        mutable std::vector<Slot> m_slots;
+        uint32_t m_nextSlot{0};
+        uint64_t m_sequence{0};
+        mutable uint64_t m_lastReadSequence{0};
+        mutable uint64_t m_lastDuration{0};
+    };
+
+    // D3D11 queries are individual objects, the pool only enforces the maximum number of timers.
+    struct D3D11TimerPool : IGraphicsTimerPool, std::enable_shared_from_this<D3D11TimerPool> {
+        D3D11TimerPool(ID3D11Device* device, uint32_t maxTimers, uint32_t latency)
+            : m_device(device), m_maxTimers(maxTimers), m_latency(std::max(latency, 1u)) {
+        }
+
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+
+        std::shared_ptr<IGraphicsTimer> createTimer(const std::string& name) override {
+            {
+                std::unique_lock lock(m_mutex);
+
+                if (m_activeTimers >= m_maxTimers) {
+                    throw std::runtime_error("Timer pool is exhausted");
+                }
+                m_activeTimers++;
+            }
+
+            return std::make_shared<D3D11PooledTimer>(shared_from_this(), m_device.Get(), name, m_latency);
+        }
+
+        void releaseTimer() {
+            std::unique_lock lock(m_mutex);
+
+            m_activeTimers--;
+        }
+
+        const ComPtr<ID3D11Device> m_device;
+        const uint32_t m_maxTimers;
+        const uint32_t m_latency;
+
+        std::mutex m_mutex;
+        uint32_t m_activeTimers{0};
+    };
+
+    D3D11PooledTimer::~D3D11PooledTimer() {
+        TraceLocalActivity(local);
+        TraceLoggingWriteStart(local, "D3D11PooledTimer_Destroy", TLPArg(this, "Timer"));
+
+        m_pool->releaseTimer();
+
+        TraceLoggingWriteStop(local, "D3D11PooledTimer_Destroy");
+    }
+
     struct D3D11Fence : IGraphicsFence {
         D3D11Fence(ID3D11Fence* fence, bool shareable) : m_fence(fence), m_isShareable(shareable) {
             TraceLocalActivity(local);
@@ -172,9 +363,13 @@ namespace {
             TraceLoggingWriteStart(local, "D3D11Fence_Signal", TLPArg(this, "Fence"), TLArg(value, "Value"));
 
             CHECK_HRCMD(m_context->Signal(m_fence.Get(), value));
-            m_context->Flush();
+            if (!m_isFlushDeferred) {
+                m_context->Flush();
+            } else {
+                m_needFlush = true;
+            }
 
-            TraceLoggingWriteStop(local, "D3D11Fence_Signal");
+            TraceLoggingWriteStop(local, "D3D11Fence_Signal", TLArg(m_needFlush, "NeedFlush"));
         }
 
         void waitOnDevice(uint64_t value) override {
@@ -195,6 +390,7 @@ namespace {
             wil::unique_handle eventHandle;
             CHECK_HRCMD(m_context->Signal(m_fence.Get(), value));
             m_context->Flush();
+            m_needFlush = false;
             *eventHandle.put() = CreateEventEx(nullptr, L"D3D Fence", 0, EVENT_ALL_ACCESS);
             CHECK_HRCMD(m_fence->SetEventOnCompletion(value, eventHandle.get()));
             WaitForSingleObject(eventHandle.get(), INFINITE);
@@ -203,6 +399,25 @@ namespace {
             TraceLoggingWriteStop(local, "D3D11Fence_Wait");
         }
 
+        void setDeferredFlush(bool deferred) override {
+            m_isFlushDeferred = deferred;
+            if (!m_isFlushDeferred) {
+                flush();
+            }
+        }
+
+        void flush() override {
+            if (m_needFlush) {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "D3D11Fence_Flush", TLPArg(this, "Fence"));
+
+                m_context->Flush();
+                m_needFlush = false;
+
+                TraceLoggingWriteStop(local, "D3D11Fence_Flush");
+            }
+        }
+
         bool isShareable() const override {
             return m_isShareable;
         }
@@ -210,11 +425,16 @@ namespace {
         const ComPtr<ID3D11Fence> m_fence;
         const bool m_isShareable;
 
+        bool m_isFlushDeferred{false};
+        bool m_needFlush{false};
+
         ComPtr<ID3D11DeviceContext4> m_context;
     };
 
     struct D3D11Texture : IGraphicsTexture {
-        D3D11Texture(ID3D11Texture2D* texture) : m_texture(texture) {
+        // When a memory tracker is specified, the texture is accounted for as allocated through the device.
+        D3D11Texture(ID3D11Texture2D* texture, std::shared_ptr<internal::MemoryTracker> memoryTracker = {})
+            : m_texture(texture), m_memoryTracker(std::move(memoryTracker)) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D11Texture_Create", TLPArg(texture, "D3D11Texture"));
 
@@ -263,16 +483,28 @@ namespace {
                 }
             }
 
+            // D3D11 does not report the actual size of the allocation.
+            if (m_memoryTracker) {
+                m_allocatedSize = internal::estimateTextureSize(m_info);
+                m_memoryTracker->add(MemoryCategory::Texture, m_allocatedSize);
+            }
+
             TraceLoggingWriteStop(local,
                                   "D3D11Texture_Create",
                                   TLPArg(this, "Texture"),
                                   TLArg(m_isShareable, "Shareable"),
-                                  TLArg(m_useNtHandle, "IsNTHandle"));
+                                  TLArg(m_useNtHandle, "IsNTHandle"),
+                                  TLArg(m_allocatedSize, "AllocatedSize"));
         }
 
         ~D3D11Texture() override {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D11Texture_Destroy", TLPArg(this, "Texture"));
+
+            if (m_memoryTracker) {
+                m_memoryTracker->remove(MemoryCategory::Texture, m_allocatedSize);
+            }
+
             TraceLoggingWriteStop(local, "D3D11Texture_Destroy");
         }
 
@@ -318,10 +550,28 @@ namespace {
         }
 
         const ComPtr<ID3D11Texture2D> m_texture;
+        const std::shared_ptr<internal::MemoryTracker> m_memoryTracker;
 
         XrSwapchainCreateInfo m_info{};
         bool m_isShareable{false};
         bool m_useNtHandle{false};
+        uint64_t m_allocatedSize{0};
+    };
+
+    struct D3D11CommandContext : IGraphicsCommandContext {
+        D3D11CommandContext(ID3D11Device* device) {
+            CHECK_HRCMD(device->CreateDeferredContext(0, m_context.ReleaseAndGetAddressOf()));
+        }
+
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+
+        void* getNativeContextPtr() const override {
+            return m_context.Get();
+        }
+
+        ComPtr<ID3D11DeviceContext> m_context;
     };
 
     struct D3D11GraphicsDevice : IGraphicsDevice {
@@ -338,6 +588,9 @@ namespace {
                 CHECK_HRCMD(dxgiAdapter->GetDesc(&desc));
                 m_adapterLuid = desc.AdapterLuid;
 
+                // Only needed for the memory budget, which is not available before Windows 10.
+                dxgiAdapter->QueryInterface(IID_PPV_ARGS(m_dxgiAdapter.ReleaseAndGetAddressOf()));
+
                 TraceLoggingWriteTagged(
                     local,
                     "D3D11GraphicsDevice_Create",
@@ -374,6 +627,10 @@ namespace {
             return std::make_shared<D3D11Timer>(m_device.Get());
         }
 
+        std::shared_ptr<IGraphicsTimerPool> createTimerPool(uint32_t maxTimers, uint32_t latency) override {
+            return std::make_shared<D3D11TimerPool>(m_device.Get(), maxTimers, latency);
+        }
+
         std::shared_ptr<IGraphicsFence> createFence(bool shareable) override {
             ComPtr<ID3D11Fence> fence;
             CHECK_HRCMD(
@@ -433,7 +690,7 @@ namespace {
 
             ComPtr<ID3D11Texture2D> texture;
             CHECK_HRCMD(m_device->CreateTexture2D(&desc, nullptr, texture.ReleaseAndGetAddressOf()));
-            return std::make_shared<D3D11Texture>(texture.Get());
+            return std::make_shared<D3D11Texture>(texture.Get(), m_memoryTracker);
         }
 
         std::shared_ptr<IGraphicsTexture> openTexture(const ShareableHandle& handle,
@@ -483,6 +740,100 @@ namespace {
             TraceLoggingWriteStop(local, "D3D11Texture_Copy");
         }
 
+        void copyTextureRegion(IGraphicsTexture* from,
+                               IGraphicsTexture* to,
+                               const XrRect2Di& region,
+                               uint32_t firstSlice,
+                               uint32_t sliceCount) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "D3D11Texture_CopyRegion",
+                                   TLPArg(from, "Source"),
+                                   TLPArg(to, "Destination"),
+                                   TLArg(region.offset.x, "X"),
+                                   TLArg(region.offset.y, "Y"),
+                                   TLArg(region.extent.width, "Width"),
+                                   TLArg(region.extent.height, "Height"),
+                                   TLArg(firstSlice, "FirstSlice"),
+                                   TLArg(sliceCount, "SliceCount"));
+
+            const XrSwapchainCreateInfo& fromInfo = from->getInfo();
+            const XrSwapchainCreateInfo& toInfo = to->getInfo();
+
+            // Depth/stencil and multisampled resources can only be copied in their entirety.
+            const bool isFullCopy = (fromInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ||
+                                    fromInfo.sampleCount > 1;
+
+            const uint32_t width = std::min(fromInfo.width, toInfo.width);
+            const uint32_t height = std::min(fromInfo.height, toInfo.height);
+            D3D11_BOX box{};
+            box.left = std::min(static_cast<uint32_t>(std::max(region.offset.x, 0)), width);
+            box.top = std::min(static_cast<uint32_t>(std::max(region.offset.y, 0)), height);
+            box.right = std::min(box.left + static_cast<uint32_t>(std::max(region.extent.width, 0)), width);
+            box.bottom = std::min(box.top + static_cast<uint32_t>(std::max(region.extent.height, 0)), height);
+            box.front = 0;
+            box.back = 1;
+
+            if (isFullCopy || (box.right > box.left && box.bottom > box.top)) {
+                const uint32_t lastSlice =
+                    std::min(firstSlice + sliceCount, std::min(fromInfo.arraySize, toInfo.arraySize));
+                for (uint32_t slice = firstSlice; slice < lastSlice; slice++) {
+                    m_context->CopySubresourceRegion(to->getNativeTexture<D3D11>(),
+                                                     D3D11CalcSubresource(0, slice, toInfo.mipCount),
+                                                     isFullCopy ? 0 : box.left,
+                                                     isFullCopy ? 0 : box.top,
+                                                     0,
+                                                     from->getNativeTexture<D3D11>(),
+                                                     D3D11CalcSubresource(0, slice, fromInfo.mipCount),
+                                                     isFullCopy ? nullptr : &box);
+                }
+            }
+
+            TraceLoggingWriteStop(local, "D3D11Texture_CopyRegion");
+        }
+
+        void waitForCopies() override {
+            // All copies are submitted to the immediate context and are already ordered with subsequent work.
+        }
+
+        std::unique_ptr<IGraphicsCommandContext> acquireCommandContext() override {
+            std::unique_lock lock(m_commandContextsMutex);
+
+            if (m_availableCommandContexts.empty()) {
+                return std::make_unique<D3D11CommandContext>(m_device.Get());
+            }
+
+            std::unique_ptr<IGraphicsCommandContext> context = std::move(m_availableCommandContexts.back());
+            m_availableCommandContexts.pop_back();
+            return context;
+        }
+
+        void submitCommandContexts(std::vector<std::unique_ptr<IGraphicsCommandContext>> contexts) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "D3D11GraphicsDevice_SubmitCommandContexts",
+                                   TLPArg(this, "Device"),
+                                   TLArg(contexts.size(), "Count"));
+
+            for (auto& context : contexts) {
+                ID3D11DeviceContext* const deferredContext = context->getNativeContext<D3D11>();
+
+                ComPtr<ID3D11CommandList> commandList;
+                CHECK_HRCMD(deferredContext->FinishCommandList(FALSE, commandList.ReleaseAndGetAddressOf()));
+                m_context->ExecuteCommandList(commandList.Get(), FALSE);
+            }
+
+            {
+                std::unique_lock lock(m_commandContextsMutex);
+
+                for (auto& context : contexts) {
+                    m_availableCommandContexts.push_back(std::move(context));
+                }
+            }
+
+            TraceLoggingWriteStop(local, "D3D11GraphicsDevice_SubmitCommandContexts");
+        }
+
         GenericFormat translateToGenericFormat(int64_t format) const override {
             return (DXGI_FORMAT)format;
         }
@@ -495,11 +846,38 @@ namespace {
             return m_adapterLuid;
         }
 
+        uint64_t getAllocatedMemory(MemoryCategory category) const override {
+            return m_memoryTracker->get(category);
+        }
+
+        MemoryBudget queryMemoryBudget() const override {
+            MemoryBudget budget{};
+            DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+            if (m_dxgiAdapter &&
+                SUCCEEDED(m_dxgiAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info))) {
+                budget.budget = info.Budget;
+                budget.currentUsage = info.CurrentUsage;
+            }
+            return budget;
+        }
+
+        CommandListStatistics getCommandListStatistics() const override {
+            // The immediate context manages its command lists internally.
+            return {};
+        }
+
         const ComPtr<ID3D11Device> m_device;
         LUID m_adapterLuid{};
+        ComPtr<IDXGIAdapter3> m_dxgiAdapter;
+
+        // D3D11 queries are not accounted for, since the driver manages their memory.
+        const std::shared_ptr<internal::MemoryTracker> m_memoryTracker = std::make_shared<internal::MemoryTracker>();
 
         ComPtr<ID3D11Device5> m_deviceForFencesAndNtHandles;
         ComPtr<ID3D11DeviceContext> m_context;
+
+        std::mutex m_commandContextsMutex;
+        std::vector<std::unique_ptr<IGraphicsCommandContext>> m_availableCommandContexts;
     };
 
 } // namespace
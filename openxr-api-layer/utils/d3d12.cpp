@@ -35,6 +35,25 @@ namespace {
     using namespace openxr_api_layer::log;
     using namespace openxr_api_layer::utils::graphics;
 
+    // The completion of commands on a queue. The fence value is only known once the commands are submitted.
+    struct D3D12Completion {
+        ComPtr<ID3D12Fence> fence;
+        std::atomic<uint64_t> fenceValue{0};
+
+        void submitted(ID3D12Fence* submissionFence, uint64_t submissionFenceValue) {
+            fence = submissionFence;
+            fenceValue.store(submissionFenceValue, std::memory_order_release);
+        }
+
+        bool isCompleted() const {
+            const uint64_t value = fenceValue.load(std::memory_order_acquire);
+            return value && fence->GetCompletedValue() >= value;
+        }
+    };
+
+    // The completion of the commands recorded into a command context from D3D12GraphicsDevice.
+    std::shared_ptr<D3D12Completion> getCompletion(IGraphicsCommandContext* context);
+
     struct D3D12Timer : IGraphicsTimer {
         D3D12Timer(ID3D12Device* device, ID3D12CommandQueue* queue) : m_queue(queue) {
             TraceLocalActivity(local);
@@ -123,27 +142,50 @@ namespace {
 
             // Signal a fence for completion.
             m_queue->Signal(m_fence.Get(), ++m_fenceValue);
-            m_valid = true;
+            m_completion = std::make_shared<D3D12Completion>();
+            m_completion->submitted(m_fence.Get(), m_fenceValue);
+
+            TraceLoggingWriteStop(local, "D3D12Timer_Stop");
+        }
+
+        void start(IGraphicsCommandContext* context) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12Timer_Start", TLPArg(this, "Timer"), TLPArg(context, "Context"));
+
+            context->getNativeContext<D3D12>()->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0);
+
+            TraceLoggingWriteStop(local, "D3D12Timer_Start");
+        }
+
+        void stop(IGraphicsCommandContext* context) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12Timer_Stop", TLPArg(this, "Timer"), TLPArg(context, "Context"));
+
+            ID3D12GraphicsCommandList* const commandList = context->getNativeContext<D3D12>();
+            commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 1);
+            commandList->ResolveQueryData(
+                m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, m_queryReadbackBuffer.Get(), 0);
+            m_completion = getCompletion(context);
 
             TraceLoggingWriteStop(local, "D3D12Timer_Stop");
         }
 
         uint64_t query() const override {
             TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "D3D12Timer_Query", TLPArg(this, "Timer"), TLArg(m_valid, "Valid"));
+            TraceLoggingWriteStart(
+                local, "D3D12Timer_Query", TLPArg(this, "Timer"), TLArg(!!m_completion, "Valid"));
 
             uint64_t duration = 0;
-            if (m_valid) {
+            if (m_completion) {
                 uint64_t gpuTickFrequency;
-                if (m_fence->GetCompletedValue() >= m_fenceValue &&
-                    SUCCEEDED(m_queue->GetTimestampFrequency(&gpuTickFrequency))) {
+                if (m_completion->isCompleted() && SUCCEEDED(m_queue->GetTimestampFrequency(&gpuTickFrequency))) {
                     uint64_t* mappedBuffer;
                     D3D12_RANGE range{0, 2 * sizeof(uint64_t)};
                     CHECK_HRCMD(m_queryReadbackBuffer->Map(0, &range, reinterpret_cast<void**>(&mappedBuffer)));
                     duration = ((mappedBuffer[1] - mappedBuffer[0]) * 1000000) / gpuTickFrequency;
                     m_queryReadbackBuffer->Unmap(0, nullptr);
                 }
-                m_valid = false;
+                m_completion.reset();
             }
 
             TraceLoggingWriteStop(local, "D3D12Timer_Query", TLArg(duration, "Duration"));
@@ -159,13 +201,109 @@ namespace {
         ComPtr<ID3D12QueryHeap> m_queryHeap;
         ComPtr<ID3D12Resource> m_queryReadbackBuffer;
 
-        // Can the timer be queried (it might still only read 0).
-        mutable bool m_valid{false};
+        // Set when the timer can be queried (it might still only read 0).
+        mutable std::shared_ptr<D3D12Completion> m_completion;
+    };
+
+    // A dedicated copy queue next to a device's direct queue.
+    // Copies are ordered after the work submitted to the direct queue before them, but the direct queue only waits for
+    // the copies when needed. This lets the copies overlap with the work that is submitted to the direct queue after
+    // them, up until the direct queue has to join them (for example before an image is handed back to the runtime).
+    // The queue is only created with the first copy, so that devices that never copy on it do not pay for it.
+    struct D3D12CopyQueue {
+        D3D12CopyQueue(ID3D12Device* device, ID3D12CommandQueue* directQueue)
+            : m_device(device), m_directQueue(directQueue) {
+        }
+
+        ID3D12CommandQueue* getQueue() {
+            std::unique_lock lock(m_mutex);
+
+            ensureCreated();
+            return m_copyQueue.Get();
+        }
+
+        // Must be called before submitting copies to the copy queue.
+        void waitForDirectQueue() {
+            std::unique_lock lock(m_mutex);
+
+            ensureCreated();
+            const uint64_t value = ++m_fenceValue;
+            CHECK_HRCMD(m_directQueue->Signal(m_fence.Get(), value));
+            CHECK_HRCMD(m_copyQueue->Wait(m_fence.Get(), value));
+        }
+
+        // Must be called after submitting copies to the copy queue.
+        void copiesSubmitted() {
+            std::unique_lock lock(m_mutex);
+
+            m_hasPendingCopies = true;
+        }
+
+        // Signal a fence once the work submitted so far on both queues has completed, without making the direct queue
+        // wait. Returns false when there are no pending copies, in which case the fence can simply be signaled from the
+        // direct queue.
+        bool signalAfterCopies(ID3D12Fence* fence, uint64_t value) {
+            std::unique_lock lock(m_mutex);
+
+            if (!m_hasPendingCopies) {
+                return false;
+            }
+
+            const uint64_t directQueueValue = ++m_fenceValue;
+            CHECK_HRCMD(m_directQueue->Signal(m_fence.Get(), directQueueValue));
+            CHECK_HRCMD(m_copyQueue->Wait(m_fence.Get(), directQueueValue));
+            CHECK_HRCMD(m_copyQueue->Signal(fence, value));
+            return true;
+        }
+
+        // Make the direct queue wait for the copies submitted so far. Returns false when there was nothing to wait for.
+        bool joinDirectQueue() {
+            std::unique_lock lock(m_mutex);
+
+            if (!m_hasPendingCopies) {
+                return false;
+            }
+
+            const uint64_t value = ++m_fenceValue;
+            CHECK_HRCMD(m_copyQueue->Signal(m_fence.Get(), value));
+            CHECK_HRCMD(m_directQueue->Wait(m_fence.Get(), value));
+            m_hasPendingCopies = false;
+            return true;
+        }
+
+      private:
+        void ensureCreated() {
+            if (m_copyQueue) {
+                return;
+            }
+
+            D3D12_COMMAND_QUEUE_DESC queueDesc{};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+            queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+            CHECK_HRCMD(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_copyQueue.ReleaseAndGetAddressOf())));
+            m_copyQueue->SetName(L"Copy Command Queue");
+
+            CHECK_HRCMD(
+                m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+            m_fence->SetName(L"Copy Queue Fence");
+        }
+
+        const ComPtr<ID3D12Device> m_device;
+        const ComPtr<ID3D12CommandQueue> m_directQueue;
+        ComPtr<ID3D12CommandQueue> m_copyQueue;
+        ComPtr<ID3D12Fence> m_fence;
+
+        std::mutex m_mutex;
+        uint64_t m_fenceValue{0};
+        bool m_hasPendingCopies{false};
     };
 
     struct D3D12Fence : IGraphicsFence {
-        D3D12Fence(ID3D12Fence* fence, ID3D12CommandQueue* commandQueue, bool shareable)
-            : m_fence(fence), m_commandQueue(commandQueue), m_isShareable(shareable) {
+        D3D12Fence(ID3D12Fence* fence,
+                   ID3D12CommandQueue* commandQueue,
+                   bool shareable,
+                   std::shared_ptr<D3D12CopyQueue> copyQueue = {})
+            : m_fence(fence), m_commandQueue(commandQueue), m_isShareable(shareable), m_copyQueue(copyQueue) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(
                 local, "D3D12Fence_Create", TLPArg(fence, "D3D12Fence"), TLArg(shareable, "Shareable"));
@@ -212,7 +350,7 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D12Fence_Signal", TLPArg(this, "Fence"), TLArg(value, "Value"));
 
-            CHECK_HRCMD(m_commandQueue->Signal(m_fence.Get(), value));
+            signalAfterPendingWork(value);
 
             TraceLoggingWriteStop(local, "D3D12Fence_Signal");
         }
@@ -233,7 +371,7 @@ namespace {
                 local, "D3D12Fence_Wait", TLPArg(this, "Fence"), TLArg("Host", "WaitType"), TLArg(value, "Value"));
 
             wil::unique_handle eventHandle;
-            CHECK_HRCMD(m_commandQueue->Signal(m_fence.Get(), value));
+            signalAfterPendingWork(value);
             *eventHandle.put() = CreateEventEx(nullptr, L"D3D Fence", 0, EVENT_ALL_ACCESS);
             CHECK_HRCMD(m_fence->SetEventOnCompletion(value, eventHandle.get()));
             WaitForSingleObject(eventHandle.get(), INFINITE);
@@ -242,19 +380,39 @@ namespace {
             TraceLoggingWriteStop(local, "D3D12Fence_Wait");
         }
 
+        void setDeferredFlush(bool deferred) override {
+            // Signals on a D3D12 command queue are always submitted immediately.
+        }
+
+        void flush() override {
+        }
+
         bool isShareable() const override {
             return m_isShareable;
         }
 
+        // Copies in flight on the copy queue must complete before the fence is signaled.
+        void signalAfterPendingWork(uint64_t value) {
+            if (!m_copyQueue || !m_copyQueue->signalAfterCopies(m_fence.Get(), value)) {
+                CHECK_HRCMD(m_commandQueue->Signal(m_fence.Get(), value));
+            }
+        }
+
         const ComPtr<ID3D12Fence> m_fence;
         const ComPtr<ID3D12CommandQueue> m_commandQueue;
         const bool m_isShareable;
+        const std::shared_ptr<D3D12CopyQueue> m_copyQueue;
 
         ComPtr<ID3D12Device> m_device;
     };
 
     struct D3D12Texture : IGraphicsTexture {
-        D3D12Texture(ID3D12Resource* texture) : m_texture(texture) {
+        // The default state is the state the texture is in whenever it is not used by the copy queue. When a memory
+        // tracker is specified, the texture is accounted for as allocated through the device.
+        D3D12Texture(ID3D12Resource* texture,
+                     D3D12_RESOURCE_STATES defaultState,
+                     std::shared_ptr<internal::MemoryTracker> memoryTracker = {})
+            : m_texture(texture), m_defaultState(defaultState), m_memoryTracker(std::move(memoryTracker)) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D12Texture_Create", TLPArg(texture, "D3D12Texture"));
 
@@ -298,13 +456,26 @@ namespace {
             CHECK_HRCMD(m_texture->GetHeapProperties(nullptr, &heapFlags));
             m_isShareable = heapFlags & D3D12_HEAP_FLAG_SHARED;
 
-            TraceLoggingWriteStop(
-                local, "D3D12Texture_Create", TLPArg(this, "Texture"), TLArg(m_isShareable, "Shareable"));
+            if (m_memoryTracker) {
+                m_allocatedSize = m_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+                m_memoryTracker->add(MemoryCategory::Texture, m_allocatedSize);
+            }
+
+            TraceLoggingWriteStop(local,
+                                  "D3D12Texture_Create",
+                                  TLPArg(this, "Texture"),
+                                  TLArg(m_isShareable, "Shareable"),
+                                  TLArg(m_allocatedSize, "AllocatedSize"));
         }
 
         ~D3D12Texture() override {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D12Texture_Destroy", TLPArg(this, "Texture"));
+
+            if (m_memoryTracker) {
+                m_memoryTracker->remove(MemoryCategory::Texture, m_allocatedSize);
+            }
+
             TraceLoggingWriteStop(local, "D3D12Texture_Destroy");
         }
 
@@ -344,18 +515,358 @@ namespace {
         }
 
         const ComPtr<ID3D12Resource> m_texture;
+        const D3D12_RESOURCE_STATES m_defaultState;
+        const std::shared_ptr<internal::MemoryTracker> m_memoryTracker;
         ComPtr<ID3D12Device> m_device;
 
         XrSwapchainCreateInfo m_info{};
         bool m_isShareable{false};
+        uint64_t m_allocatedSize{0};
     };
 
+    // The state of swapchain images outside of the copy queue, as mandated by XR_KHR_D3D12_enable. This is also the
+    // initial state of textures created with createTexture().
+    D3D12_RESOURCE_STATES getDefaultResourceState(const XrSwapchainCreateInfo& info) {
+        if (info.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        }
+        if (info.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+            return D3D12_RESOURCE_STATE_RENDER_TARGET;
+        }
+        return D3D12_RESOURCE_STATE_COMMON;
+    }
+
+    D3D12_RESOURCE_BARRIER makeTransitionBarrier(ID3D12Resource* resource,
+                                                 D3D12_RESOURCE_STATES before,
+                                                 D3D12_RESOURCE_STATES after) {
+        D3D12_RESOURCE_BARRIER barrier{};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = resource;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = before;
+        barrier.Transition.StateAfter = after;
+        return barrier;
+    }
+
+    // Depth/stencil formats store stencil in a second plane, which must be addressed as its own subresource.
+    uint32_t getFormatPlaneCount(ID3D12Device* device, DXGI_FORMAT format) {
+        D3D12_FEATURE_DATA_FORMAT_INFO formatInfo{format};
+        if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_FORMAT_INFO, &formatInfo, sizeof(formatInfo)))) {
+            return 1;
+        }
+        return formatInfo.PlaneCount;
+    }
+
+    uint32_t calcSubresource(
+        uint32_t mipSlice, uint32_t arraySlice, uint32_t planeSlice, uint32_t mipCount, uint32_t arraySize) {
+        return mipSlice + arraySlice * mipCount + planeSlice * mipCount * arraySize;
+    }
+
     struct D3D12ReusableCommandList {
+        D3D12_COMMAND_LIST_TYPE type{D3D12_COMMAND_LIST_TYPE_DIRECT};
         ComPtr<ID3D12CommandAllocator> allocator;
         ComPtr<ID3D12GraphicsCommandList> commandList;
-        uint32_t completedFenceValue{0};
+        uint64_t completedFenceValue{0};
+
+        // Where the command list lives in its pool. Command lists beyond the capacity of the pool have no entry.
+        uint32_t slotIndex{0};
+        int32_t entryIndex{-1};
+        bool isRecording{false};
+    };
+
+    // A pool of command lists submitted to a single queue.
+    // Each thread gets its own slot of command lists and its own fence, so that getting and submitting command lists
+    // does not take any lock. Completed command lists are retired in bulk by reading the fence of the slot once. A slot
+    // keeps up to MaxCommandListsPerThread command lists. Once they are all in flight, the CPU waits for the oldest one
+    // to complete. Additional command lists are only allocated when the slot's command lists are all being recorded,
+    // and they are released once completed. Threads beyond MaxThreads share a single slot protected by a mutex, which
+    // also holds the command lists recorded on one thread and submitted from another. A thread gives its slot back
+    // when it exits, and the next thread to claim the slot inherits its command lists. Fences are only created for the
+    // slots that are used.
+    struct D3D12CommandListPool {
+        static constexpr uint32_t MaxThreads = 16;
+        static constexpr uint32_t MaxCommandListsPerThread = 8;
+        static constexpr uint32_t SharedSlotIndex = MaxThreads;
+
+        D3D12CommandListPool(ID3D12Device* device, ID3D12CommandQueue* commandQueue, D3D12_COMMAND_LIST_TYPE type)
+            : m_device(device), m_commandQueue(commandQueue), m_type(type) {
+        }
+
+        // The command list must be submitted from the same thread.
+        D3D12ReusableCommandList getCommandList() {
+            return getCommandListFromSlot(getSlotIndex());
+        }
+
+        // The command list can be recorded and submitted from any thread, and must be submitted with
+        // submitSharedCommandLists().
+        D3D12ReusableCommandList getSharedCommandList() {
+            return getCommandListFromSlot(SharedSlotIndex);
+        }
+
+        void submitCommandList(D3D12ReusableCommandList commandList) {
+            Slot& slot = m_slots[commandList.slotIndex];
+            std::unique_lock lock(m_sharedSlotMutex, std::defer_lock);
+            if (commandList.slotIndex == SharedSlotIndex) {
+                lock.lock();
+            }
+
+            CHECK_HRCMD(commandList.commandList->Close());
+            m_commandQueue->ExecuteCommandLists(
+                1, reinterpret_cast<ID3D12CommandList**>(commandList.commandList.GetAddressOf()));
+            commandList.completedFenceValue = ++slot.fenceValue;
+            CHECK_HRCMD(m_commandQueue->Signal(slot.fence.Get(), commandList.completedFenceValue));
+            commandListSubmitted(slot, std::move(commandList));
+        }
+
+        // Submit command lists from getSharedCommandList() in order, with a single signal of the fence. Returns the
+        // fence and the value it reaches once they complete.
+        std::pair<ComPtr<ID3D12Fence>, uint64_t>
+        submitSharedCommandLists(std::vector<D3D12ReusableCommandList> commandLists) {
+            std::vector<ID3D12CommandList*> nativeCommandLists;
+            nativeCommandLists.reserve(commandLists.size());
+            for (const D3D12ReusableCommandList& commandList : commandLists) {
+                CHECK_HRCMD(commandList.commandList->Close());
+                nativeCommandLists.push_back(commandList.commandList.Get());
+            }
+
+            Slot& slot = m_slots[SharedSlotIndex];
+            std::unique_lock lock(m_sharedSlotMutex);
+
+            m_commandQueue->ExecuteCommandLists(static_cast<UINT>(nativeCommandLists.size()),
+                                                nativeCommandLists.data());
+            const uint64_t fenceValue = ++slot.fenceValue;
+            CHECK_HRCMD(m_commandQueue->Signal(slot.fence.Get(), fenceValue));
+            for (D3D12ReusableCommandList& commandList : commandLists) {
+                commandList.completedFenceValue = fenceValue;
+                commandListSubmitted(slot, std::move(commandList));
+            }
+            return {slot.fence, fenceValue};
+        }
+
+        // Give back a command list from getSharedCommandList() that will not be submitted.
+        void discardSharedCommandList(D3D12ReusableCommandList commandList) {
+            CHECK_HRCMD(commandList.commandList->Close());
+
+            std::unique_lock lock(m_sharedSlotMutex);
+
+            commandListSubmitted(m_slots[SharedSlotIndex], std::move(commandList));
+        }
+
+        CommandListStatistics getStatistics() const {
+            CommandListStatistics statistics;
+            for (const auto& slot : m_slots) {
+                statistics.hits += slot.hits.load(std::memory_order_relaxed);
+                statistics.misses += slot.misses.load(std::memory_order_relaxed);
+                statistics.stalls += slot.stalls.load(std::memory_order_relaxed);
+            }
+            return statistics;
+        }
+
+      private:
+        D3D12ReusableCommandList getCommandListFromSlot(uint32_t slotIndex) {
+            Slot& slot = m_slots[slotIndex];
+            std::unique_lock lock(m_sharedSlotMutex, std::defer_lock);
+            if (slotIndex == SharedSlotIndex) {
+                lock.lock();
+            }
+
+            if (!slot.fence) {
+                CHECK_HRCMD(m_device->CreateFence(
+                    0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(slot.fence.ReleaseAndGetAddressOf())));
+                slot.commandLists.reserve(MaxCommandListsPerThread);
+            }
+            retireCommandLists(slot);
+
+            // Reuse a completed command list.
+            D3D12ReusableCommandList* oldest = nullptr;
+            for (D3D12ReusableCommandList& entry : slot.commandLists) {
+                if (entry.isRecording) {
+                    continue;
+                }
+                if (entry.completedFenceValue <= slot.completedFenceValue) {
+                    slot.hits.fetch_add(1, std::memory_order_relaxed);
+                    return reuseCommandList(entry);
+                }
+                if (!oldest || entry.completedFenceValue < oldest->completedFenceValue) {
+                    oldest = &entry;
+                }
+            }
+
+            // When the pool is exhausted, wait for the oldest command list to complete.
+            if (slot.commandLists.size() >= MaxCommandListsPerThread && oldest) {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local,
+                                       "D3D12CommandListPool_Stall",
+                                       TLPArg(this, "Pool"),
+                                       TLArg(oldest->completedFenceValue, "FenceValue"));
+
+                wil::unique_handle eventHandle;
+                *eventHandle.put() = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+                CHECK_HRCMD(slot.fence->SetEventOnCompletion(oldest->completedFenceValue, eventHandle.get()));
+                WaitForSingleObject(eventHandle.get(), INFINITE);
+                slot.completedFenceValue = slot.fence->GetCompletedValue();
+                slot.stalls.fetch_add(1, std::memory_order_relaxed);
+
+                TraceLoggingWriteStop(local, "D3D12CommandListPool_Stall");
+
+                return reuseCommandList(*oldest);
+            }
+
+            // Allocate a new command list if needed.
+            D3D12ReusableCommandList commandList;
+            commandList.type = m_type;
+            commandList.slotIndex = slotIndex;
+            CHECK_HRCMD(
+                m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(commandList.allocator.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(m_device->CreateCommandList(0,
+                                                    m_type,
+                                                    commandList.allocator.Get(),
+                                                    nullptr,
+                                                    IID_PPV_ARGS(commandList.commandList.ReleaseAndGetAddressOf())));
+            commandList.isRecording = true;
+            slot.misses.fetch_add(1, std::memory_order_relaxed);
+            if (slot.commandLists.size() < MaxCommandListsPerThread) {
+                commandList.entryIndex = static_cast<int32_t>(slot.commandLists.size());
+                slot.commandLists.push_back(commandList);
+            }
+            return commandList;
+        }
+
+        // Which thread owns each slot. Shared with the threads, so that they can give up their slots when they exit,
+        // even after the pool is gone.
+        using SlotOwners = std::array<std::atomic<DWORD>, MaxThreads>;
+
+        // The slots claimed by the current thread, released when the thread exits.
+        struct ThreadSlots {
+            ~ThreadSlots() {
+                const DWORD threadId = GetCurrentThreadId();
+                for (const auto& [owners, slotIndex] : claimedSlots) {
+                    if (const auto ownersRef = owners.lock()) {
+                        DWORD owner = threadId;
+                        (*ownersRef)[slotIndex].compare_exchange_strong(owner, 0, std::memory_order_acq_rel);
+                    }
+                }
+            }
+
+            std::vector<std::pair<std::weak_ptr<SlotOwners>, uint32_t>> claimedSlots;
+        };
+
+        static inline thread_local ThreadSlots t_threadSlots;
+
+        struct Slot {
+            ComPtr<ID3D12Fence> fence;
+            uint64_t fenceValue{0};
+            uint64_t completedFenceValue{0};
+
+            std::vector<D3D12ReusableCommandList> commandLists;
+            std::vector<D3D12ReusableCommandList> overflowCommandLists;
+
+            // Only written by the thread owning the slot, but read from any thread.
+            std::atomic<uint64_t> hits{0};
+            std::atomic<uint64_t> misses{0};
+            std::atomic<uint64_t> stalls{0};
+        };
+
+        D3D12ReusableCommandList reuseCommandList(D3D12ReusableCommandList& entry) {
+            // Reset the command list before reuse.
+            CHECK_HRCMD(entry.allocator->Reset());
+            CHECK_HRCMD(entry.commandList->Reset(entry.allocator.Get(), nullptr));
+            entry.isRecording = true;
+            return entry;
+        }
+
+        void commandListSubmitted(Slot& slot, D3D12ReusableCommandList commandList) {
+            if (commandList.entryIndex >= 0) {
+                D3D12ReusableCommandList& entry = slot.commandLists[commandList.entryIndex];
+                entry.completedFenceValue = commandList.completedFenceValue;
+                entry.isRecording = false;
+            } else {
+                // Keep the command list alive until it completes.
+                commandList.isRecording = false;
+                slot.overflowCommandLists.push_back(std::move(commandList));
+            }
+        }
+
+        uint32_t getSlotIndex() {
+            const DWORD threadId = GetCurrentThreadId();
+            for (uint32_t i = 0; i < MaxThreads; i++) {
+                if ((*m_owners)[i].load(std::memory_order_acquire) == threadId) {
+                    return i;
+                }
+            }
+            for (uint32_t i = 0; i < MaxThreads; i++) {
+                DWORD owner = 0;
+                if ((*m_owners)[i].compare_exchange_strong(owner, threadId, std::memory_order_acq_rel)) {
+                    // Forget about the pools that are gone.
+                    auto& claimedSlots = t_threadSlots.claimedSlots;
+                    claimedSlots.erase(std::remove_if(claimedSlots.begin(),
+                                                      claimedSlots.end(),
+                                                      [](const auto& entry) { return entry.first.expired(); }),
+                                       claimedSlots.end());
+                    claimedSlots.push_back({m_owners, i});
+                    return i;
+                }
+            }
+            return SharedSlotIndex;
+        }
+
+        void retireCommandLists(Slot& slot) {
+            slot.completedFenceValue = slot.fence->GetCompletedValue();
+
+            // Trim the command lists beyond the capacity of the slot.
+            slot.overflowCommandLists.erase(std::remove_if(slot.overflowCommandLists.begin(),
+                                                           slot.overflowCommandLists.end(),
+                                                           [&](const D3D12ReusableCommandList& commandList) {
+                                                               return commandList.completedFenceValue <=
+                                                                      slot.completedFenceValue;
+                                                           }),
+                                            slot.overflowCommandLists.end());
+        }
+
+        const ComPtr<ID3D12Device> m_device;
+        const ComPtr<ID3D12CommandQueue> m_commandQueue;
+        const D3D12_COMMAND_LIST_TYPE m_type;
+
+        const std::shared_ptr<SlotOwners> m_owners = std::make_shared<SlotOwners>();
+        std::array<Slot, MaxThreads + 1> m_slots;
+        std::mutex m_sharedSlotMutex;
+    };
+
+    // A command list from the shared slot of the device's command list pool.
+    struct D3D12CommandContext : IGraphicsCommandContext {
+        D3D12CommandContext(std::shared_ptr<D3D12CommandListPool> commandListPool)
+            : m_commandListPool(commandListPool), m_commandList(commandListPool->getSharedCommandList()) {
+        }
+
+        ~D3D12CommandContext() override {
+            // The context was never submitted.
+            if (m_commandList.commandList) {
+                m_commandListPool->discardSharedCommandList(std::move(m_commandList));
+            }
+        }
+
+        Api getApi() const override {
+            return Api::D3D12;
+        }
+
+        void* getNativeContextPtr() const override {
+            return m_commandList.commandList.Get();
+        }
+
+        const std::shared_ptr<D3D12CommandListPool> m_commandListPool;
+        D3D12ReusableCommandList m_commandList;
+
+        // Outlives the context, since it may still be referenced by timers.
+        const std::shared_ptr<D3D12Completion> m_completion{std::make_shared<D3D12Completion>()};
     };
 
+    std::shared_ptr<D3D12Completion> getCompletion(IGraphicsCommandContext* context) {
+        if (context->getApi() != Api::D3D12) {
+            throw std::runtime_error("Api mismatch");
+        }
+        return static_cast<D3D12CommandContext*>(context)->m_completion;
+    }
+
     struct D3D12GraphicsDevice : IGraphicsDevice {
         D3D12GraphicsDevice(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
             : m_device(device), m_commandQueue(commandQueue) {
@@ -382,13 +893,17 @@ namespace {
                             "D3D12GraphicsDevice_Create",
                             TLArg(desc.Description, "Adapter"),
                             TLArg(fmt::format("{}:{}", adapterLuid.HighPart, adapterLuid.LowPart).c_str(), " Luid"));
+
+                        // Only needed for the memory budget, which is not available before Windows 10.
+                        dxgiAdapter->QueryInterface(IID_PPV_ARGS(m_dxgiAdapter.ReleaseAndGetAddressOf()));
                         break;
                     }
                 }
             }
 
-            CHECK_HRCMD(m_device->CreateFence(
-                0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_commandListPoolFence.ReleaseAndGetAddressOf())));
+            m_commandListPool = std::make_shared<D3D12CommandListPool>(
+                m_device.Get(), m_commandQueue.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+            m_copyQueue = std::make_shared<D3D12CopyQueue>(m_device.Get(), m_commandQueue.Get());
 
             TraceLoggingWriteStop(local, "D3D12GraphicsDevice_Create", TLPArg(this, "Device"));
         }
@@ -396,6 +911,14 @@ namespace {
         ~D3D12GraphicsDevice() override {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D12GraphicsDevice_Destroy", TLPArg(this, "Device"));
+
+            const CommandListStatistics statistics = getCommandListStatistics();
+            TraceLoggingWriteTagged(local,
+                                    "D3D12GraphicsDevice_Destroy",
+                                    TLArg(statistics.hits, "CommandListPoolHits"),
+                                    TLArg(statistics.misses, "CommandListPoolMisses"),
+                                    TLArg(statistics.stalls, "CommandListPoolStalls"));
+
             TraceLoggingWriteStop(local, "D3D12GraphicsDevice_Destroy");
         }
 
@@ -415,12 +938,14 @@ namespace {
             return std::make_shared<D3D12Timer>(m_device.Get(), m_commandQueue.Get());
         }
 
+        std::shared_ptr<IGraphicsTimerPool> createTimerPool(uint32_t maxTimers, uint32_t latency) override;
+
         std::shared_ptr<IGraphicsFence> createFence(bool shareable) override {
             ComPtr<ID3D12Fence> fence;
             CHECK_HRCMD(m_device->CreateFence(0,
                                               shareable ? D3D12_FENCE_FLAG_SHARED : D3D12_FENCE_FLAG_NONE,
                                               IID_PPV_ARGS(fence.ReleaseAndGetAddressOf())));
-            return std::make_shared<D3D12Fence>(fence.Get(), m_commandQueue.Get(), shareable);
+            return std::make_shared<D3D12Fence>(fence.Get(), m_commandQueue.Get(), shareable, m_copyQueue);
         }
 
         std::shared_ptr<IGraphicsFence> openFence(const ShareableHandle& handle) override {
@@ -439,7 +964,7 @@ namespace {
                                                    IID_PPV_ARGS(fence.ReleaseAndGetAddressOf())));
 
             std::shared_ptr<IGraphicsFence> result =
-                std::make_shared<D3D12Fence>(fence.Get(), m_commandQueue.Get(), false /* shareable */);
+                std::make_shared<D3D12Fence>(fence.Get(), m_commandQueue.Get(), false /* shareable */, m_copyQueue);
 
             TraceLoggingWriteStop(local, "D3D12Fence_Import", TLPArg(result.get(), "Fence"));
 
@@ -481,7 +1006,7 @@ namespace {
                                                           initialState,
                                                           nullptr,
                                                           IID_PPV_ARGS(texture.ReleaseAndGetAddressOf())));
-            return std::make_shared<D3D12Texture>(texture.Get());
+            return std::make_shared<D3D12Texture>(texture.Get(), initialState, m_memoryTracker);
         }
 
         std::shared_ptr<IGraphicsTexture> openTexture(const ShareableHandle& handle,
@@ -496,7 +1021,9 @@ namespace {
             CHECK_HRCMD(m_device->OpenSharedHandle(handle.isNtHandle ? handle.ntHandle.get() : handle.handle,
                                                    IID_PPV_ARGS(texture.ReleaseAndGetAddressOf())));
 
-            std::shared_ptr<IGraphicsTexture> result = std::make_shared<D3D12Texture>(texture.Get());
+            // Resources opened from a shared handle start in the COMMON state, and are never transitioned by us.
+            std::shared_ptr<IGraphicsTexture> result =
+                std::make_shared<D3D12Texture>(texture.Get(), D3D12_RESOURCE_STATE_COMMON);
 
             TraceLoggingWriteStop(local, "D3D12Texture_Import", TLPArg(result.get(), "Texture"));
 
@@ -510,7 +1037,8 @@ namespace {
 
             ID3D12Resource* texture = reinterpret_cast<ID3D12Resource*>(nativeTexturePtr);
 
-            std::shared_ptr<IGraphicsTexture> result = std::make_shared<D3D12Texture>(texture);
+            std::shared_ptr<IGraphicsTexture> result =
+                std::make_shared<D3D12Texture>(texture, getDefaultResourceState(info));
 
             TraceLoggingWriteStop(local, "D3D12Texture_Import", TLPArg(result.get(), "Texture"));
 
@@ -521,11 +1049,151 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "D3D12Texture_Copy", TLPArg(from, "Source"), TLPArg(to, "Destination"));
 
-            D3D12ReusableCommandList commandList = getCommandList();
+            const bool useCopyQueue = canUseCopyQueue(from, to);
+            std::unique_lock<std::mutex> copyQueueLock;
+            if (useCopyQueue) {
+                copyQueueLock = beginCopyOnCopyQueue(from, to);
+            }
+            D3D12ReusableCommandList commandList =
+                getCommandList(useCopyQueue ? D3D12_COMMAND_LIST_TYPE_COPY : D3D12_COMMAND_LIST_TYPE_DIRECT);
             commandList.commandList->CopyResource(to->getNativeTexture<D3D12>(), from->getNativeTexture<D3D12>());
             submitCommandList(std::move(commandList));
+            if (useCopyQueue) {
+                m_copyQueue->copiesSubmitted();
+            }
+
+            TraceLoggingWriteStop(local, "D3D12Texture_Copy", TLArg(useCopyQueue, "CopyQueue"));
+        }
+
+        void copyTextureRegion(IGraphicsTexture* from,
+                               IGraphicsTexture* to,
+                               const XrRect2Di& region,
+                               uint32_t firstSlice,
+                               uint32_t sliceCount) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "D3D12Texture_CopyRegion",
+                                   TLPArg(from, "Source"),
+                                   TLPArg(to, "Destination"),
+                                   TLArg(region.offset.x, "X"),
+                                   TLArg(region.offset.y, "Y"),
+                                   TLArg(region.extent.width, "Width"),
+                                   TLArg(region.extent.height, "Height"),
+                                   TLArg(firstSlice, "FirstSlice"),
+                                   TLArg(sliceCount, "SliceCount"));
+
+            const XrSwapchainCreateInfo& fromInfo = from->getInfo();
+            const XrSwapchainCreateInfo& toInfo = to->getInfo();
+
+            // Depth/stencil and multisampled resources can only be copied in their entirety.
+            const bool isFullCopy = (fromInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ||
+                                    fromInfo.sampleCount > 1;
+
+            const uint32_t width = std::min(fromInfo.width, toInfo.width);
+            const uint32_t height = std::min(fromInfo.height, toInfo.height);
+            D3D12_BOX box{};
+            box.left = std::min(static_cast<uint32_t>(std::max(region.offset.x, 0)), width);
+            box.top = std::min(static_cast<uint32_t>(std::max(region.offset.y, 0)), height);
+            box.right = std::min(box.left + static_cast<uint32_t>(std::max(region.extent.width, 0)), width);
+            box.bottom = std::min(box.top + static_cast<uint32_t>(std::max(region.extent.height, 0)), height);
+            box.front = 0;
+            box.back = 1;
+
+            bool useCopyQueue = false;
+            if (isFullCopy || (box.right > box.left && box.bottom > box.top)) {
+                useCopyQueue = canUseCopyQueue(from, to);
+                std::unique_lock<std::mutex> copyQueueLock;
+                if (useCopyQueue) {
+                    copyQueueLock = beginCopyOnCopyQueue(from, to);
+                }
+                D3D12ReusableCommandList commandList =
+                    getCommandList(useCopyQueue ? D3D12_COMMAND_LIST_TYPE_COPY : D3D12_COMMAND_LIST_TYPE_DIRECT);
+                const uint32_t lastSlice =
+                    std::min(firstSlice + sliceCount, std::min(fromInfo.arraySize, toInfo.arraySize));
+                const uint32_t planeCount =
+                    getFormatPlaneCount(m_device.Get(), from->getNativeTexture<D3D12>()->GetDesc().Format);
+                for (uint32_t slice = firstSlice; slice < lastSlice; slice++) {
+                    for (uint32_t plane = 0; plane < planeCount; plane++) {
+                        D3D12_TEXTURE_COPY_LOCATION source{};
+                        source.pResource = from->getNativeTexture<D3D12>();
+                        source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+                        source.SubresourceIndex =
+                            calcSubresource(0, slice, plane, fromInfo.mipCount, fromInfo.arraySize);
+                        D3D12_TEXTURE_COPY_LOCATION destination{};
+                        destination.pResource = to->getNativeTexture<D3D12>();
+                        destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+                        destination.SubresourceIndex =
+                            calcSubresource(0, slice, plane, toInfo.mipCount, toInfo.arraySize);
+
+                        commandList.commandList->CopyTextureRegion(&destination,
+                                                                   isFullCopy ? 0 : box.left,
+                                                                   isFullCopy ? 0 : box.top,
+                                                                   0,
+                                                                   &source,
+                                                                   isFullCopy ? nullptr : &box);
+                    }
+                }
+                submitCommandList(std::move(commandList));
+                if (useCopyQueue) {
+                    m_copyQueue->copiesSubmitted();
+                }
+            }
 
-            TraceLoggingWriteStop(local, "D3D12Texture_Copy");
+            TraceLoggingWriteStop(local, "D3D12Texture_CopyRegion", TLArg(useCopyQueue, "CopyQueue"));
+        }
+
+        void waitForCopies() override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12GraphicsDevice_WaitForCopies", TLPArg(this, "Device"));
+
+            std::unique_lock lock(m_copyQueueResourcesMutex);
+
+            const bool hadPendingCopies = m_copyQueue->joinDirectQueue();
+
+            // Return the textures to the states expected outside of the copy queue.
+            if (!m_copyQueueResources.empty()) {
+                std::vector<D3D12_RESOURCE_BARRIER> barriers;
+                for (const auto& [resource, state] : m_copyQueueResources) {
+                    barriers.push_back(makeTransitionBarrier(resource.Get(), D3D12_RESOURCE_STATE_COMMON, state));
+                }
+                D3D12ReusableCommandList commandList = getCommandList();
+                commandList.commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+                submitCommandList(std::move(commandList));
+                m_copyQueueResources.clear();
+            }
+
+            TraceLoggingWriteStop(local, "D3D12GraphicsDevice_WaitForCopies", TLArg(hadPendingCopies, "Waited"));
+        }
+
+        std::unique_ptr<IGraphicsCommandContext> acquireCommandContext() override {
+            // Command contexts may be recorded on a different thread than the one submitting them.
+            return std::make_unique<D3D12CommandContext>(m_commandListPool);
+        }
+
+        void submitCommandContexts(std::vector<std::unique_ptr<IGraphicsCommandContext>> contexts) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "D3D12GraphicsDevice_SubmitCommandContexts",
+                                   TLPArg(this, "Device"),
+                                   TLArg(contexts.size(), "Count"));
+
+            if (!contexts.empty()) {
+                std::vector<D3D12ReusableCommandList> commandLists;
+                commandLists.reserve(contexts.size());
+                for (const auto& context : contexts) {
+                    if (context->getApi() != Api::D3D12) {
+                        throw std::runtime_error("Api mismatch");
+                    }
+                    commandLists.push_back(std::move(static_cast<D3D12CommandContext*>(context.get())->m_commandList));
+                }
+
+                const auto [fence, fenceValue] = m_commandListPool->submitSharedCommandLists(std::move(commandLists));
+                for (const auto& context : contexts) {
+                    static_cast<D3D12CommandContext*>(context.get())->m_completion->submitted(fence.Get(), fenceValue);
+                }
+            }
+
+            TraceLoggingWriteStop(local, "D3D12GraphicsDevice_SubmitCommandContexts");
         }
 
         GenericFormat translateToGenericFormat(int64_t format) const override {
@@ -540,64 +1208,488 @@ namespace {
             return m_device->GetAdapterLuid();
         }
 
-        D3D12ReusableCommandList getCommandList() {
-            std::unique_lock lock(m_commandListPoolMutex);
-
-            if (m_availableCommandList.empty()) {
-                // Recycle completed command lists.
-                while (!m_pendingCommandList.empty() && m_commandListPoolFence->GetCompletedValue() >=
-                                                            m_pendingCommandList.front().completedFenceValue) {
-                    m_availableCommandList.push_back(std::move(m_pendingCommandList.front()));
-                    m_pendingCommandList.pop_front();
-                }
+        uint64_t getAllocatedMemory(MemoryCategory category) const override {
+            return m_memoryTracker->get(category);
+        }
+
+        MemoryBudget queryMemoryBudget() const override {
+            MemoryBudget budget{};
+            DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+            if (m_dxgiAdapter &&
+                SUCCEEDED(m_dxgiAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info))) {
+                budget.budget = info.Budget;
+                budget.currentUsage = info.CurrentUsage;
             }
+            return budget;
+        }
 
-            D3D12ReusableCommandList commandList;
-            if (m_availableCommandList.empty()) {
-                // Allocate a new command list if needed.
-                CHECK_HRCMD(m_device->CreateCommandAllocator(
-                    D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(commandList.allocator.ReleaseAndGetAddressOf())));
-                CHECK_HRCMD(
-                    m_device->CreateCommandList(0,
-                                                D3D12_COMMAND_LIST_TYPE_DIRECT,
-                                                commandList.allocator.Get(),
-                                                nullptr,
-                                                IID_PPV_ARGS(commandList.commandList.ReleaseAndGetAddressOf())));
-            } else {
-                commandList = m_availableCommandList.front();
-                m_availableCommandList.pop_front();
+        CommandListStatistics getCommandListStatistics() const override {
+            CommandListStatistics statistics = m_commandListPool->getStatistics();
+            if (m_hasCopyCommandListPool.load(std::memory_order_acquire)) {
+                const CommandListStatistics copyStatistics = m_copyCommandListPool->getStatistics();
+                statistics.hits += copyStatistics.hits;
+                statistics.misses += copyStatistics.misses;
+                statistics.stalls += copyStatistics.stalls;
+            }
+            return statistics;
+        }
 
-                // Reset the command list before reuse.
-                CHECK_HRCMD(commandList.commandList->Reset(commandList.allocator.Get(), nullptr));
+        D3D12ReusableCommandList getCommandList(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) {
+            if (type == D3D12_COMMAND_LIST_TYPE_COPY) {
+                // The copy pool is only created with the first copy, like the copy queue itself.
+                std::call_once(m_copyCommandListPoolCreated, [&] {
+                    m_copyCommandListPool = std::make_unique<D3D12CommandListPool>(
+                        m_device.Get(), m_copyQueue->getQueue(), D3D12_COMMAND_LIST_TYPE_COPY);
+                    m_hasCopyCommandListPool.store(true, std::memory_order_release);
+                });
+                return m_copyCommandListPool->getCommandList();
             }
-            return commandList;
+            return m_commandListPool->getCommandList();
         }
 
         void submitCommandList(D3D12ReusableCommandList commandList) {
-            std::unique_lock lock(m_commandListPoolMutex);
+            (commandList.type == D3D12_COMMAND_LIST_TYPE_COPY ? m_copyCommandListPool : m_commandListPool)
+                ->submitCommandList(std::move(commandList));
+        }
 
-            CHECK_HRCMD(commandList.commandList->Close());
-            m_commandQueue->ExecuteCommandLists(
-                1, reinterpret_cast<ID3D12CommandList**>(commandList.commandList.GetAddressOf()));
-            commandList.completedFenceValue = m_commandListPoolFenceValue + 1;
-            m_commandQueue->Signal(m_commandListPoolFence.Get(), commandList.completedFenceValue);
-            m_pendingCommandList.push_back(std::move(commandList));
+        // The copy queue cannot copy multisampled resources.
+        bool canUseCopyQueue(IGraphicsTexture* from, IGraphicsTexture* to) const {
+            return from->getInfo().sampleCount <= 1 && to->getInfo().sampleCount <= 1;
+        }
+
+        // Textures accessed from the copy queue must be in the COMMON state. Transition them on the direct queue, and
+        // order the copy queue after all the work submitted so far on the direct queue. The returned lock must be held
+        // until the copy is submitted, so that waitForCopies() cannot restore the textures while the copy is pending.
+        std::unique_lock<std::mutex> beginCopyOnCopyQueue(IGraphicsTexture* from, IGraphicsTexture* to) {
+            std::unique_lock lock(m_copyQueueResourcesMutex);
+
+            std::vector<D3D12_RESOURCE_BARRIER> barriers;
+            for (IGraphicsTexture* texture : {from, to}) {
+                ID3D12Resource* const resource = texture->getNativeTexture<D3D12>();
+                const D3D12_RESOURCE_STATES state = static_cast<D3D12Texture*>(texture)->m_defaultState;
+                if (state == D3D12_RESOURCE_STATE_COMMON ||
+                    std::find_if(m_copyQueueResources.cbegin(), m_copyQueueResources.cend(), [&](const auto& entry) {
+                        return entry.first.Get() == resource;
+                    }) != m_copyQueueResources.cend()) {
+                    continue;
+                }
+
+                barriers.push_back(makeTransitionBarrier(resource, state, D3D12_RESOURCE_STATE_COMMON));
+                m_copyQueueResources.push_back({resource, state});
+            }
+            if (!barriers.empty()) {
+                D3D12ReusableCommandList commandList = getCommandList();
+                commandList.commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+                submitCommandList(std::move(commandList));
+            }
+
+            m_copyQueue->waitForDirectQueue();
+
+            return lock;
         }
 
         const ComPtr<ID3D12Device> m_device;
         const ComPtr<ID3D12CommandQueue> m_commandQueue;
+        ComPtr<IDXGIAdapter3> m_dxgiAdapter;
+
+        const std::shared_ptr<internal::MemoryTracker> m_memoryTracker = std::make_shared<internal::MemoryTracker>();
 
-        std::mutex m_commandListPoolMutex;
-        std::deque<D3D12ReusableCommandList> m_availableCommandList;
-        std::deque<D3D12ReusableCommandList> m_pendingCommandList;
-        ComPtr<ID3D12Fence> m_commandListPoolFence;
-        uint32_t m_commandListPoolFenceValue{0};
+        std::shared_ptr<D3D12CommandListPool> m_commandListPool;
+
+        std::shared_ptr<D3D12CopyQueue> m_copyQueue;
+        std::once_flag m_copyCommandListPoolCreated;
+        std::unique_ptr<D3D12CommandListPool> m_copyCommandListPool;
+        std::atomic<bool> m_hasCopyCommandListPool{false};
+
+        // Textures left in the COMMON state for the copy queue, with the state to restore.
+        std::mutex m_copyQueueResourcesMutex;
+        std::vector<std::pair<ComPtr<ID3D12Resource>, D3D12_RESOURCE_STATES>> m_copyQueueResources;
     };
 
+    // A pool of timers sharing a single query heap and readback buffer. Each timer owns latency consecutive pairs
+    // of timestamps in the heap.
+    struct D3D12TimerPool : IGraphicsTimerPool, std::enable_shared_from_this<D3D12TimerPool> {
+        D3D12TimerPool(D3D12GraphicsDevice* device, uint32_t maxTimers, uint32_t latency)
+            : m_device(device->m_device), m_commandQueue(device->m_commandQueue),
+              m_commandListPool(device->m_commandListPool), m_memoryTracker(device->m_memoryTracker),
+              m_maxTimers(maxTimers), m_latency(std::max(latency, 1u)) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D12TimerPool_Create", TLArg(maxTimers, "MaxTimers"), TLArg(m_latency, "Latency"));
+
+            ID3D12Device* const nativeDevice = m_device.Get();
+
+            D3D12_QUERY_HEAP_DESC heapDesc{};
+            heapDesc.Count = m_maxTimers * m_latency * 2;
+            heapDesc.NodeMask = 0;
+            heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+            CHECK_HRCMD(nativeDevice->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())));
+            m_queryHeap->SetName(L"Timer Pool Query Heap");
+
+            D3D12_HEAP_PROPERTIES heapType{};
+            heapType.Type = D3D12_HEAP_TYPE_READBACK;
+            heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
+            D3D12_RESOURCE_DESC readbackDesc{};
+            readbackDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+            readbackDesc.Width = heapDesc.Count * sizeof(uint64_t);
+            readbackDesc.Height = readbackDesc.DepthOrArraySize = readbackDesc.MipLevels =
+                readbackDesc.SampleDesc.Count = 1;
+            readbackDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+            CHECK_HRCMD(nativeDevice->CreateCommittedResource(
+                &heapType,
+                D3D12_HEAP_FLAG_NONE,
+                &readbackDesc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_queryReadbackBuffer.ReleaseAndGetAddressOf())));
+            m_queryReadbackBuffer->SetName(L"Timer Pool Readback Buffer");
+
+            // The size of the query heap is not reported, assume one timestamp per query.
+            m_allocatedSize = nativeDevice->GetResourceAllocationInfo(0, 1, &readbackDesc).SizeInBytes +
+                              heapDesc.Count * sizeof(uint64_t);
+            m_memoryTracker->add(MemoryCategory::Query, m_allocatedSize);
+
+            CHECK_HRCMD(
+                nativeDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+            m_fence->SetName(L"Timer Pool Readback Fence");
+
+            if (FAILED(m_commandQueue->GetTimestampFrequency(&m_gpuTickFrequency))) {
+                m_gpuTickFrequency = 0;
+            }
+
+            m_freeIndices.reserve(m_maxTimers);
+            for (uint32_t i = 0; i < m_maxTimers; i++) {
+                m_freeIndices.push_back(m_maxTimers - i - 1);
+            }
+
+            TraceLoggingWriteStop(local, "D3D12TimerPool_Create", TLPArg(this, "TimerPool"));
+        }
+
+        ~D3D12TimerPool() override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12TimerPool_Destroy", TLPArg(this, "TimerPool"));
+
+            m_memoryTracker->remove(MemoryCategory::Query, m_allocatedSize);
+
+            TraceLoggingWriteStop(local, "D3D12TimerPool_Destroy");
+        }
+
+        Api getApi() const override {
+            return Api::D3D12;
+        }
+
+        std::shared_ptr<IGraphicsTimer> createTimer(const std::string& name) override;
+
+        uint32_t allocateIndex() {
+            std::unique_lock lock(m_mutex);
+
+            recycleIndicesLocked(false /* wait */);
+            if (m_freeIndices.empty() && !m_releasedIndices.empty()) {
+                recycleIndicesLocked(true /* wait */);
+            }
+            if (m_freeIndices.empty()) {
+                throw std::runtime_error("Timer pool is exhausted");
+            }
+            const uint32_t index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+            return index;
+        }
+
+        // The queries of a released timer might still be written or resolved by the GPU, so its index is only reused
+        // once the commands submitted so far, including the given completions, have completed.
+        void releaseIndex(uint32_t index, std::vector<std::shared_ptr<D3D12Completion>> completions) {
+            std::unique_lock lock(m_mutex);
+
+            const uint64_t fenceValue = ++m_fenceValue;
+            CHECK_HRCMD(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+            m_releasedIndices.push_back({index, fenceValue, std::move(completions)});
+        }
+
+        // Record a timestamp into a command list. When resolve is true, the pair of timestamps ending at this one is
+        // copied to the readback buffer.
+        void recordTimestamp(ID3D12GraphicsCommandList* commandList, uint32_t query, bool resolve) {
+            commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+            if (resolve) {
+                commandList->ResolveQueryData(m_queryHeap.Get(),
+                                              D3D12_QUERY_TYPE_TIMESTAMP,
+                                              query - 1,
+                                              2,
+                                              m_queryReadbackBuffer.Get(),
+                                              (query - 1) * sizeof(uint64_t));
+            }
+        }
+
+        // Record and submit a timestamp on its own, for work that is not recorded into a command context. When resolve
+        // is true, the completion to wait for before reading the pair of timestamps is returned.
+        std::shared_ptr<D3D12Completion> submitTimestamp(uint32_t query, bool resolve) {
+            D3D12ReusableCommandList commandList = m_commandListPool->getCommandList();
+            recordTimestamp(commandList.commandList.Get(), query, resolve);
+            m_commandListPool->submitCommandList(std::move(commandList));
+
+            if (!resolve) {
+                return {};
+            }
+
+            std::unique_lock lock(m_mutex);
+
+            const uint64_t fenceValue = ++m_fenceValue;
+            CHECK_HRCMD(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+            std::shared_ptr<D3D12Completion> completion = std::make_shared<D3D12Completion>();
+            completion->submitted(m_fence.Get(), fenceValue);
+            return completion;
+        }
+
+        struct ReleasedIndex {
+            uint32_t index;
+            uint64_t fenceValue;
+            std::vector<std::shared_ptr<D3D12Completion>> completions;
+        };
+
+        void recycleIndicesLocked(bool wait) {
+            for (auto it = m_releasedIndices.begin(); it != m_releasedIndices.end();) {
+                if (wait) {
+                    // Only wait for the oldest release, which is the first to complete.
+                    wait = false;
+                    if (m_fence->GetCompletedValue() < it->fenceValue) {
+                        CHECK_HRCMD(m_fence->SetEventOnCompletion(it->fenceValue, nullptr));
+                    }
+                }
+
+                // A completion that was never submitted belongs to a command context that was discarded.
+                const bool isCompleted =
+                    m_fence->GetCompletedValue() >= it->fenceValue &&
+                    std::all_of(it->completions.cbegin(), it->completions.cend(), [](const auto& completion) {
+                        return !completion->fenceValue.load(std::memory_order_acquire) || completion->isCompleted();
+                    });
+                if (!isCompleted) {
+                    ++it;
+                    continue;
+                }
+
+                m_freeIndices.push_back(it->index);
+                it = m_releasedIndices.erase(it);
+            }
+        }
+
+        // Returns the duration in microseconds, or nothing if the measurement is not available yet.
+        std::optional<uint64_t> readDuration(uint32_t firstQuery, const D3D12Completion& completion) {
+            if (!m_gpuTickFrequency || !completion.isCompleted()) {
+                return {};
+            }
+
+            uint64_t* mappedBuffer;
+            D3D12_RANGE range{firstQuery * sizeof(uint64_t), (firstQuery + 2) * sizeof(uint64_t)};
+            CHECK_HRCMD(m_queryReadbackBuffer->Map(0, &range, reinterpret_cast<void**>(&mappedBuffer)));
+            const uint64_t duration =
+                ((mappedBuffer[firstQuery + 1] - mappedBuffer[firstQuery]) * 1000000) / m_gpuTickFrequency;
+            const D3D12_RANGE writtenRange{0, 0};
+            m_queryReadbackBuffer->Unmap(0, &writtenRange);
+
+            return duration;
+        }
+
+        // The pool may outlive the D3D12GraphicsDevice that created it.
+        const ComPtr<ID3D12Device> m_device;
+        const ComPtr<ID3D12CommandQueue> m_commandQueue;
+        const std::shared_ptr<D3D12CommandListPool> m_commandListPool;
+        const std::shared_ptr<internal::MemoryTracker> m_memoryTracker;
+        const uint32_t m_maxTimers;
+        const uint32_t m_latency;
+
+        ComPtr<ID3D12QueryHeap> m_queryHeap;
+        ComPtr<ID3D12Resource> m_queryReadbackBuffer;
+        uint64_t m_allocatedSize{0};
+        ComPtr<ID3D12Fence> m_fence;
+        uint64_t m_gpuTickFrequency{0};
+
+        std::mutex m_mutex;
+        std::vector<uint32_t> m_freeIndices;
+        std::deque<ReleasedIndex> m_releasedIndices;
+        uint64_t m_fenceValue{0};
+    };
+
+    // A timer cycling through its slots in the pool's query heap.
+    struct D3D12PooledTimer : IGraphicsTimer {
+        D3D12PooledTimer(std::shared_ptr<D3D12TimerPool> pool, const std::string& name)
+            : m_pool(pool), m_name(name), m_index(pool->allocateIndex()), m_slots(pool->m_latency) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "D3D12PooledTimer_Create",
+                                   TLArg(m_name.c_str(), "Name"),
+                                   TLArg(m_index, "Index"));
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Create", TLPArg(this, "Timer"));
+        }
+
+        ~D3D12PooledTimer() override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12PooledTimer_Destroy", TLPArg(this, "Timer"));
+
+            std::vector<std::shared_ptr<D3D12Completion>> completions;
+            for (const Slot& slot : m_slots) {
+                if (slot.completion) {
+                    completions.push_back(slot.completion);
+                }
+            }
+            m_pool->releaseIndex(m_index, std::move(completions));
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Destroy");
+        }
+
+        Api getApi() const override {
+            return Api::D3D12;
+        }
+
+        void start() override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D12PooledTimer_Start", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            m_pool->submitTimestamp(getFirstQuery(m_nextSlot), false /* resolve */);
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Start");
+        }
+
+        void stop() override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12PooledTimer_Stop", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            completeSlot(m_pool->submitTimestamp(getFirstQuery(m_nextSlot) + 1, true /* resolve */));
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Stop");
+        }
+
+        void start(IGraphicsCommandContext* context) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D12PooledTimer_Start", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            m_pool->recordTimestamp(
+                context->getNativeContext<D3D12>(), getFirstQuery(m_nextSlot), false /* resolve */);
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Start");
+        }
+
+        void stop(IGraphicsCommandContext* context) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "D3D12PooledTimer_Stop", TLPArg(this, "Timer"), TLArg(m_nextSlot, "Slot"));
+
+            m_pool->recordTimestamp(
+                context->getNativeContext<D3D12>(), getFirstQuery(m_nextSlot) + 1, true /* resolve */);
+            completeSlot(getCompletion(context));
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Stop");
+        }
+
+        uint64_t query() const override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(
+                local, "D3D12PooledTimer_Query", TLPArg(this, "Timer"), TLArg(m_name.c_str(), "Name"));
+
+            // Look for the most recent measurement that has completed.
+            const uint32_t latency = m_pool->m_latency;
+            for (uint32_t i = 1; i <= latency; i++) {
+                const uint32_t index = (m_nextSlot + latency - i) % latency;
+                const Slot& slot = m_slots[index];
+                if (!slot.completion || slot.sequence <= m_lastReadSequence) {
+                    break;
+                }
+
+                const std::optional<uint64_t> duration = m_pool->readDuration(getFirstQuery(index), *slot.completion);
+                if (duration.has_value()) {
+                    m_lastDuration = duration.value();
+                    m_lastReadSequence = slot.sequence;
+                    break;
+                }
+            }
+
+            TraceLoggingWriteStop(local, "D3D12PooledTimer_Query", TLArg(m_lastDuration, "Duration"));
+
+            return m_lastDuration;
+        }
+
+        struct Slot {
+            // The completion to wait for before reading the slot.
+            std::shared_ptr<D3D12Completion> completion;
+            uint64_t sequence{0};
+        };
+
+        uint32_t getFirstQuery(uint32_t slot) const {
+            return (m_index * m_pool->m_latency + slot) * 2;
+        }
+
+        void completeSlot(std::shared_ptr<D3D12Completion> completion) {
+            m_slots[m_nextSlot] = {std::move(completion), ++m_sequence};
+            m_nextSlot = (m_nextSlot + 1) % m_pool->m_latency;
+        }
+
+        const std::shared_ptr<D3D12TimerPool> m_pool;
+        const std::string m_name;
+        const uint32_t m_index;
+
+        std::vector<Slot> m_slots;
+        uint32_t m_nextSlot{0};
+        uint64_t m_sequence{0};
+        mutable uint64_t m_lastReadSequence{0};
+        mutable uint64_t m_lastDuration{0};
+    };
+
+    std::shared_ptr<IGraphicsTimer> D3D12TimerPool::createTimer(const std::string& name) {
+        return std::make_shared<D3D12PooledTimer>(shared_from_this(), name);
+    }
+
+    std::shared_ptr<IGraphicsTimerPool> D3D12GraphicsDevice::createTimerPool(uint32_t maxTimers, uint32_t latency) {
+        return std::make_shared<D3D12TimerPool>(this, maxTimers, latency);
+    }
+
 } // namespace
 
 namespace openxr_api_layer::utils::graphics::internal {
 
+    std::shared_ptr<IGraphicsDevice> createD3D12CompositionDevice(LUID adapterLuid) {
+        // Find the adapter.
+        ComPtr<IDXGIFactory1> dxgiFactory;
+        CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
+        ComPtr<IDXGIAdapter1> dxgiAdapter;
+        for (UINT adapterIndex = 0;; adapterIndex++) {
+            // EnumAdapters1 will fail with DXGI_ERROR_NOT_FOUND when there are no more adapters to
+            // enumerate.
+            CHECK_HRCMD(dxgiFactory->EnumAdapters1(adapterIndex, dxgiAdapter.ReleaseAndGetAddressOf()));
+
+            DXGI_ADAPTER_DESC1 desc;
+            CHECK_HRCMD(dxgiAdapter->GetDesc1(&desc));
+            if (!memcmp(&desc.AdapterLuid, &adapterLuid, sizeof(LUID))) {
+                break;
+            }
+        }
+
+#ifdef _DEBUG
+        ComPtr<ID3D12Debug> debug;
+        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(debug.ReleaseAndGetAddressOf())))) {
+            debug->EnableDebugLayer();
+        }
+#endif
+
+        // Create our own device on the same adapter.
+        ComPtr<ID3D12Device> device;
+        CHECK_HRCMD(
+            D3D12CreateDevice(dxgiAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(device.ReleaseAndGetAddressOf())));
+
+        return createD3D12CompositionDevice(device.Get());
+    }
+
+    std::shared_ptr<IGraphicsDevice> createD3D12CompositionDevice(ID3D12Device* device) {
+        // Use our own queue, so that composition is not serialized with the application's submissions more than
+        // needed.
+        ComPtr<ID3D12CommandQueue> commandQueue;
+        D3D12_COMMAND_QUEUE_DESC queueDesc{};
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+        CHECK_HRCMD(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(commandQueue.ReleaseAndGetAddressOf())));
+        commandQueue->SetName(L"Composition Command Queue");
+
+        return std::make_shared<D3D12GraphicsDevice>(device, commandQueue.Get());
+    }
+
     std::shared_ptr<IGraphicsDevice> wrapApplicationDevice(const XrGraphicsBindingD3D12KHR& bindings) {
         return std::make_shared<D3D12GraphicsDevice>(bindings.device, bindings.queue);
     }
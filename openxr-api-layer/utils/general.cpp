@@ -88,6 +88,112 @@ namespace {
 
 namespace openxr_api_layer::utils::general {
 
+    TaskScheduler::TaskScheduler(uint32_t workerCount) {
+        m_workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back([this] { workerMain(); });
+        }
+    }
+
+    TaskScheduler::~TaskScheduler() {
+        stop();
+    }
+
+    void TaskScheduler::stop() {
+        std::unique_lock parallelForLock(m_parallelForMutex);
+
+        if (m_workers.empty()) {
+            return;
+        }
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_isExiting = true;
+        }
+        m_wakeUp.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+    }
+
+    void TaskScheduler::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+        if (!count) {
+            return;
+        }
+
+        std::unique_lock parallelForLock(m_parallelForMutex);
+
+        uint64_t generation;
+        {
+            std::unique_lock lock(m_mutex);
+            m_task = &task;
+            m_count = count;
+            m_nextIndex = 0;
+            m_completedCount = 0;
+            m_exception = nullptr;
+            generation = ++m_generation;
+        }
+        if (count > 1) {
+            m_wakeUp.notify_all();
+        }
+
+        // The calling thread takes its share of the tasks.
+        runTasks(generation);
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock lock(m_mutex);
+            m_batchCompleted.wait(lock, [&] { return m_completedCount == m_count; });
+            m_task = nullptr;
+            std::swap(exception, m_exception);
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void TaskScheduler::workerMain() {
+        uint64_t lastGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock lock(m_mutex);
+                m_wakeUp.wait(lock, [&] { return m_isExiting || m_generation != lastGeneration; });
+                if (m_isExiting) {
+                    return;
+                }
+                lastGeneration = m_generation;
+            }
+
+            runTasks(lastGeneration);
+        }
+    }
+
+    void TaskScheduler::runTasks(uint64_t generation) {
+        std::unique_lock lock(m_mutex);
+        // A worker waking up late must not pick up tasks from a newer batch with a stale generation.
+        while (m_generation == generation && m_nextIndex < m_count) {
+            const size_t index = m_nextIndex++;
+            const std::function<void(size_t)>& task = *m_task;
+            lock.unlock();
+
+            std::exception_ptr exception;
+            try {
+                task(index);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            if (exception && !m_exception) {
+                m_exception = exception;
+            }
+            if (++m_completedCount == m_count) {
+                m_batchCompleted.notify_all();
+            }
+        }
+    }
+
     std::shared_ptr<ITimer> createTimer() {
         return std::make_shared<CpuTimer>();
     }
@@ -121,6 +227,170 @@ namespace openxr_api_layer::utils::general {
         return rayIntersectQuad(rayPosition, rayDirection, v0, v1, v2, v3, &hitPose, distance);
     }
 
+    void QuadSet::resize(size_t count) {
+        const size_t previousCount = m_poses.size();
+        const size_t paddedCount = (count + 3) & ~static_cast<size_t>(3);
+
+        m_poses.resize(count, xr::math::Pose::Identity());
+        m_sizes.resize(count, {0, 0});
+        for (auto* lanes : {&m_centerX,
+                            &m_centerY,
+                            &m_centerZ,
+                            &m_normalX,
+                            &m_normalY,
+                            &m_normalZ,
+                            &m_rightX,
+                            &m_rightY,
+                            &m_rightZ,
+                            &m_upX,
+                            &m_upY,
+                            &m_upZ,
+                            &m_halfWidth,
+                            &m_halfHeight}) {
+            lanes->resize(paddedCount, 0.f);
+        }
+
+        // Quads that have not been set yet and padding quads must never be hit.
+        for (size_t i = std::min(previousCount, count); i < paddedCount; i++) {
+            m_halfWidth[i] = m_halfHeight[i] = -1.f;
+        }
+    }
+
+    void QuadSet::setQuad(uint32_t index, const XrPosef& quadCenter, const XrExtent2Df& quadSize) {
+        using namespace DirectX;
+
+        if (index >= m_poses.size()) {
+            throw std::runtime_error("Invalid quad index");
+        }
+
+        m_poses[index] = quadCenter;
+        m_sizes[index] = quadSize;
+
+        const XMVECTOR rotation = xr::math::LoadXrQuaternion(quadCenter.orientation);
+        XMFLOAT3 normal, right, up;
+        XMStoreFloat3(&normal, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotation));
+        XMStoreFloat3(&right, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), rotation));
+        XMStoreFloat3(&up, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), rotation));
+
+        m_centerX[index] = quadCenter.position.x;
+        m_centerY[index] = quadCenter.position.y;
+        m_centerZ[index] = quadCenter.position.z;
+        m_normalX[index] = normal.x;
+        m_normalY[index] = normal.y;
+        m_normalZ[index] = normal.z;
+        m_rightX[index] = right.x;
+        m_rightY[index] = right.y;
+        m_rightZ[index] = right.z;
+        m_upX[index] = up.x;
+        m_upY[index] = up.y;
+        m_upZ[index] = up.z;
+        m_halfWidth[index] = quadSize.width / 2.f;
+        m_halfHeight[index] = quadSize.height / 2.f;
+    }
+
+    void QuadSet::setQuads(const XrPosef* quadCenters, const XrExtent2Df* quadSizes, size_t count) {
+        resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            setQuad(i, quadCenters[i], quadSizes[i]);
+        }
+    }
+
+    bool QuadSet::hitTest(const XrPosef& ray, Hit& hit) const {
+        using namespace DirectX;
+
+        const XMVECTOR rayPosition = xr::math::LoadXrVector3(ray.position);
+        const XMVECTOR rayDirection =
+            XMVector3Rotate(XMVectorSet(0, 0, -1, 0), xr::math::LoadXrQuaternion(ray.orientation));
+
+        const XMVECTOR originX = XMVectorSplatX(rayPosition);
+        const XMVECTOR originY = XMVectorSplatY(rayPosition);
+        const XMVECTOR originZ = XMVectorSplatZ(rayPosition);
+        const XMVECTOR directionX = XMVectorSplatX(rayDirection);
+        const XMVECTOR directionY = XMVectorSplatY(rayDirection);
+        const XMVECTOR directionZ = XMVectorSplatZ(rayDirection);
+        const XMVECTOR epsilon = XMVectorReplicate(1e-6f);
+        const XMVECTOR noHit = XMVectorReplicate(FLT_MAX);
+
+        const auto load = [](const std::vector<float>& lanes, size_t i) {
+            return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&lanes[i]));
+        };
+
+        float nearestDistance = FLT_MAX;
+        size_t nearestIndex = 0;
+        for (size_t i = 0; i < m_halfWidth.size(); i += 4) {
+            // Intersect with the plane of each quad (double-sided).
+            const XMVECTOR normalX = load(m_normalX, i);
+            const XMVECTOR normalY = load(m_normalY, i);
+            const XMVECTOR normalZ = load(m_normalZ, i);
+            const XMVECTOR toCenterX = XMVectorSubtract(load(m_centerX, i), originX);
+            const XMVECTOR toCenterY = XMVectorSubtract(load(m_centerY, i), originY);
+            const XMVECTOR toCenterZ = XMVectorSubtract(load(m_centerZ, i), originZ);
+            const XMVECTOR denominator = XMVectorMultiplyAdd(
+                normalZ, directionZ, XMVectorMultiplyAdd(normalY, directionY, XMVectorMultiply(normalX, directionX)));
+            const XMVECTOR numerator = XMVectorMultiplyAdd(
+                normalZ, toCenterZ, XMVectorMultiplyAdd(normalY, toCenterY, XMVectorMultiply(normalX, toCenterX)));
+            const XMVECTOR distance = XMVectorDivide(numerator, denominator);
+
+            // Project the hit point, relative to the quad center, onto the quad axes.
+            const XMVECTOR pointX = XMVectorMultiplyAdd(distance, directionX, XMVectorNegate(toCenterX));
+            const XMVECTOR pointY = XMVectorMultiplyAdd(distance, directionY, XMVectorNegate(toCenterY));
+            const XMVECTOR pointZ = XMVectorMultiplyAdd(distance, directionZ, XMVectorNegate(toCenterZ));
+            const XMVECTOR u = XMVectorMultiplyAdd(
+                load(m_rightZ, i),
+                pointZ,
+                XMVectorMultiplyAdd(load(m_rightY, i), pointY, XMVectorMultiply(load(m_rightX, i), pointX)));
+            const XMVECTOR v = XMVectorMultiplyAdd(
+                load(m_upZ, i),
+                pointZ,
+                XMVectorMultiplyAdd(load(m_upY, i), pointY, XMVectorMultiply(load(m_upX, i), pointX)));
+
+            XMVECTOR isHit = XMVectorGreater(XMVectorAbs(denominator), epsilon);
+            isHit = XMVectorAndInt(isHit, XMVectorGreaterOrEqual(distance, XMVectorZero()));
+            isHit = XMVectorAndInt(isHit, XMVectorLessOrEqual(XMVectorAbs(u), load(m_halfWidth, i)));
+            isHit = XMVectorAndInt(isHit, XMVectorLessOrEqual(XMVectorAbs(v), load(m_halfHeight, i)));
+            if (XMVector4EqualInt(isHit, XMVectorFalseInt())) {
+                continue;
+            }
+
+            XMFLOAT4 distances;
+            XMStoreFloat4(&distances, XMVectorSelect(noHit, distance, isHit));
+            const float lanes[] = {distances.x, distances.y, distances.z, distances.w};
+            for (size_t j = 0; j < 4; j++) {
+                if (lanes[j] < nearestDistance) {
+                    nearestDistance = lanes[j];
+                    nearestIndex = i + j;
+                }
+            }
+        }
+
+        if (nearestDistance == FLT_MAX) {
+            return false;
+        }
+
+        const XrPosef& quadCenter = m_poses[nearestIndex];
+        const XMVECTOR hitPosition = XMVectorMultiplyAdd(XMVectorReplicate(nearestDistance), rayDirection, rayPosition);
+        const XMVECTOR normal =
+            XMVectorSet(m_normalX[nearestIndex], m_normalY[nearestIndex], m_normalZ[nearestIndex], 0);
+        const XMVECTOR center = xr::math::LoadXrVector3(quadCenter.position);
+        const XMVECTOR plane = XMVectorSetW(normal, -XMVectorGetX(XMVector3Dot(normal, center)));
+
+        // Same orientation as rayIntersectQuad(): from the ray position projected onto the plane, look towards the
+        // hit position and make the plane's normal "up".
+        const float t = XMVectorGetX(XMVector3Dot(plane, rayPosition)) + XMVectorGetW(plane);
+        const XMVECTOR projPoint = XMVectorSubtract(rayPosition, XMVectorMultiply(XMVectorSet(t, t, t, 0), plane));
+        const XMVECTOR forward = XMVectorSubtract(hitPosition, projPoint);
+        const XMMATRIX virtualToGazeOrientation = XMMatrixLookToRH(hitPosition, forward, plane);
+
+        hit.index = static_cast<uint32_t>(nearestIndex);
+        hit.distance = nearestDistance;
+        xr::math::StoreXrPose(&hit.pose, XMMatrixInverse(nullptr, virtualToGazeOrientation));
+        XrVector3f pointOnQuad;
+        xr::math::StoreXrVector3(&pointOnQuad, XMVectorSubtract(hitPosition, center));
+        hit.uv = getUVCoordinates(pointOnQuad, quadCenter, m_sizes[nearestIndex]);
+
+        return true;
+    }
+
     // https://gamedev.stackexchange.com/questions/136652/uv-world-mapping-in-shader-with-unity/136720#136720
     XrVector2f getUVCoordinates(const XrVector3f& point, const XrPosef& quadCenter, const XrExtent2Df& quadSize) {
         using namespace xr::math;
@@ -142,4 +412,32 @@ namespace openxr_api_layer::utils::general {
         };
     }
 
+    bool getGazeUVCoordinates(const XrPosef& gaze, const XrPosef& viewPose, const XrFovf& fov, XrVector2f& uv) {
+        using namespace DirectX;
+
+        // The eyes are close enough to each other that only the direction of the gaze matters, not its origin.
+        const XMVECTOR gazeDirection =
+            XMVector3Rotate(XMVectorSet(0, 0, -1, 0), xr::math::LoadXrQuaternion(gaze.orientation));
+        const XMVECTOR directionInView =
+            XMVector3InverseRotate(gazeDirection, xr::math::LoadXrQuaternion(viewPose.orientation));
+
+        XrVector3f direction;
+        xr::math::StoreXrVector3(&direction, directionInView);
+        if (direction.z >= 0.f) {
+            return false;
+        }
+
+        const float tanX = direction.x / -direction.z;
+        const float tanY = direction.y / -direction.z;
+        const float tanLeft = std::tan(fov.angleLeft);
+        const float tanRight = std::tan(fov.angleRight);
+        const float tanUp = std::tan(fov.angleUp);
+        const float tanDown = std::tan(fov.angleDown);
+
+        uv.x = (tanX - tanLeft) / (tanRight - tanLeft);
+        uv.y = (tanUp - tanY) / (tanUp - tanDown);
+
+        return uv.x >= 0.f && uv.x <= 1.f && uv.y >= 0.f && uv.y <= 1.f;
+    }
+
 } // namespace openxr_api_layer::utils::general
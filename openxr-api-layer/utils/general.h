@@ -56,9 +56,260 @@ namespace openxr_api_layer::utils::general {
         return pos != std::string::npos && pos == str.size() - substr.size();
     }
 
+    // A table of OpenXR functions to hook after chaining to the upstream xrGetInstanceProcAddr() implementation.
+    // The table is sorted once upon construction, and lookups are done with a binary search without any allocation.
+    class FunctionHooks {
+      public:
+        class Hook {
+          public:
+            // The upstream function pointer is stored into next, and hook is returned instead. Both must have the
+            // type of the hooked function.
+            template <typename Pfn>
+            Hook(std::string_view name, Pfn* next, Pfn hook)
+                : name(name), m_next(next), m_hook(reinterpret_cast<PFN_xrVoidFunction>(hook)), m_apply(&apply<Pfn>) {
+                static_assert(std::is_function_v<std::remove_pointer_t<Pfn>>, "Must be an OpenXR function pointer");
+            }
+
+            void operator()(PFN_xrVoidFunction* function) const {
+                m_apply(m_next, m_hook, function);
+            }
+
+            std::string_view name;
+
+          private:
+            // Each pointer is only ever converted back to its original type.
+            template <typename Pfn>
+            static void apply(void* next, PFN_xrVoidFunction hook, PFN_xrVoidFunction* function) {
+                *static_cast<Pfn*>(next) = reinterpret_cast<Pfn>(*function);
+                *function = hook;
+            }
+
+            void* m_next;
+            PFN_xrVoidFunction m_hook;
+            void (*m_apply)(void* next, PFN_xrVoidFunction hook, PFN_xrVoidFunction* function);
+        };
+
+        FunctionHooks() = default;
+        FunctionHooks(std::initializer_list<Hook> hooks) : m_hooks(hooks) {
+            std::sort(m_hooks.begin(), m_hooks.end(), [](const Hook& a, const Hook& b) { return a.name < b.name; });
+        }
+
+        // Returns true if the function was hooked.
+        bool hook(const char* name, PFN_xrVoidFunction* function) const {
+            const std::string_view functionName(name);
+            const auto it = std::lower_bound(
+                m_hooks.cbegin(), m_hooks.cend(), functionName, [](const Hook& entry, const std::string_view& name) {
+                    return entry.name < name;
+                });
+            if (it == m_hooks.cend() || it->name != functionName) {
+                return false;
+            }
+
+            (*it)(function);
+            return true;
+        }
+
+      private:
+        std::vector<Hook> m_hooks;
+    };
+
+    // A registry of per-session objects optimized for lookups from the frame loop.
+    // The first FastCapacity sessions are published into a flat array that can be scanned without taking a lock. Any
+    // additional session falls back to a mutex-protected map. Insertion and removal always take the lock.
+    // Removal does not need to wait for concurrent readers: xrDestroySession() requires external synchronization of
+    // the session handle, therefore no other call may be looking up that session while it is being removed.
+    template <typename T, size_t FastCapacity = 4>
+    class SessionRegistry {
+      public:
+        SessionRegistry() = default;
+        SessionRegistry(const SessionRegistry&) = delete;
+        SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+        ~SessionRegistry() {
+            clear();
+        }
+
+        T* insert(XrSession session, std::unique_ptr<T> object) {
+            std::unique_lock lock(m_mutex);
+
+            removeLocked(session);
+
+            T* const raw = object.get();
+            m_objects.insert_or_assign(session, std::move(object));
+            for (auto& slot : m_slots) {
+                if (slot.session.load(std::memory_order_relaxed) == XR_NULL_HANDLE) {
+                    // Publish the object before the handle, so that a reader matching the handle sees the object.
+                    slot.object.store(raw, std::memory_order_relaxed);
+                    slot.session.store(session, std::memory_order_release);
+                    return raw;
+                }
+            }
+            m_overflowCount.fetch_add(1, std::memory_order_release);
+
+            return raw;
+        }
+
+        void erase(XrSession session) {
+            std::unique_lock lock(m_mutex);
+
+            removeLocked(session);
+        }
+
+        void clear() {
+            std::unique_lock lock(m_mutex);
+
+            for (auto& slot : m_slots) {
+                slot.session.store(XR_NULL_HANDLE, std::memory_order_release);
+                slot.object.store(nullptr, std::memory_order_relaxed);
+            }
+            m_overflowCount.store(0, std::memory_order_release);
+            m_objects.clear();
+        }
+
+        template <typename F>
+        void forEach(F&& callback) const {
+            std::unique_lock lock(m_mutex);
+
+            for (const auto& [session, object] : m_objects) {
+                callback(*object);
+            }
+        }
+
+        // Returns nullptr if the session is not registered.
+        T* get(XrSession session) const {
+            if (session == XR_NULL_HANDLE) {
+                return nullptr;
+            }
+
+            for (const auto& slot : m_slots) {
+                if (slot.session.load(std::memory_order_acquire) == session) {
+                    return slot.object.load(std::memory_order_relaxed);
+                }
+            }
+
+            if (m_overflowCount.load(std::memory_order_acquire) == 0) {
+                return nullptr;
+            }
+
+            std::unique_lock lock(m_mutex);
+
+            const auto it = m_objects.find(session);
+            return it != m_objects.cend() ? it->second.get() : nullptr;
+        }
+
+      private:
+        struct Slot {
+            std::atomic<XrSession> session{XR_NULL_HANDLE};
+            std::atomic<T*> object{nullptr};
+        };
+
+        void removeLocked(XrSession session) {
+            auto it = m_objects.find(session);
+            if (it == m_objects.end()) {
+                return;
+            }
+
+            bool wasFast = false;
+            for (auto& slot : m_slots) {
+                if (slot.session.load(std::memory_order_relaxed) == session) {
+                    slot.session.store(XR_NULL_HANDLE, std::memory_order_release);
+                    slot.object.store(nullptr, std::memory_order_relaxed);
+                    wasFast = true;
+                    break;
+                }
+            }
+            if (!wasFast) {
+                m_overflowCount.fetch_sub(1, std::memory_order_release);
+            }
+
+            m_objects.erase(it);
+        }
+
+        std::array<Slot, FastCapacity> m_slots;
+        std::atomic<size_t> m_overflowCount{0};
+
+        // Owns all the objects, including the ones published into the fast slots.
+        mutable std::mutex m_mutex;
+        std::unordered_map<XrSession, std::unique_ptr<T>> m_objects;
+    };
+
+    // A fixed set of worker threads running batches of independent tasks.
+    class TaskScheduler {
+      public:
+        explicit TaskScheduler(uint32_t workerCount);
+        // Owners should call stop() beforehand: the destructor may run while holding the loader lock.
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        // Run task(0) to task(count - 1) on the workers and on the calling thread, and wait for all of them to
+        // complete. The first exception thrown by a task is rethrown once all tasks have completed.
+        void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+        // Join the workers. Subsequent batches run entirely on the calling thread.
+        // Must not be called while holding the loader lock.
+        void stop();
+
+      private:
+        void workerMain();
+        void runTasks(uint64_t generation);
+
+        std::vector<std::thread> m_workers;
+
+        // Only one batch runs at a time.
+        std::mutex m_parallelForMutex;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_batchCompleted;
+        bool m_isExiting{false};
+        uint64_t m_generation{0};
+        const std::function<void(size_t)>* m_task{nullptr};
+        size_t m_count{0};
+        size_t m_nextIndex{0};
+        size_t m_completedCount{0};
+        std::exception_ptr m_exception;
+    };
+
     // Both ray and quadCenter poses must be located using the same base space.
     bool hitTest(const XrPosef& ray, const XrPosef& quadCenter, const XrExtent2Df& quadSize, XrPosef& hitPose);
 
+    // A set of quads to hit-test rays against.
+    // The quads are stored as structure-of-arrays so that a ray is tested against 4 quads at a time. The plane and axes
+    // of each quad are only computed when the quad is set, not for every hit-test.
+    class QuadSet {
+      public:
+        struct Hit {
+            uint32_t index;
+            float distance;
+            XrPosef pose;
+            XrVector2f uv;
+        };
+
+        size_t size() const {
+            return m_poses.size();
+        }
+
+        void resize(size_t count);
+        void setQuad(uint32_t index, const XrPosef& quadCenter, const XrExtent2Df& quadSize);
+        void setQuads(const XrPosef* quadCenters, const XrExtent2Df* quadSizes, size_t count);
+
+        // The ray and all quads must be located using the same base space. Returns the nearest hit, if any.
+        bool hitTest(const XrPosef& ray, Hit& hit) const;
+
+      private:
+        std::vector<XrPosef> m_poses;
+        std::vector<XrExtent2Df> m_sizes;
+
+        // Padded to a multiple of 4. Padding quads have a negative size and are never hit.
+        std::vector<float> m_centerX, m_centerY, m_centerZ;
+        std::vector<float> m_normalX, m_normalY, m_normalZ;
+        std::vector<float> m_rightX, m_rightY, m_rightZ;
+        std::vector<float> m_upX, m_upY, m_upZ;
+        std::vector<float> m_halfWidth, m_halfHeight;
+    };
+
     // Get UV coordinates for a point on quad.
     XrVector2f getUVCoordinates(const XrVector3f& point, const XrPosef& quadCenter, const XrExtent2Df& quadSize);
     static inline POINT getUVCoordinates(const XrVector3f& point,
@@ -69,4 +320,9 @@ namespace openxr_api_layer::utils::general {
         return {static_cast<LONG>(uv.x * quadPixelSize.width), static_cast<LONG>(uv.y * quadPixelSize.height)};
     }
 
+    // Project the direction of a gaze ray onto the image plane of a view. The gaze and view poses must be located using
+    // the same base space. Returns false if the gaze falls outside of the field of view. UV coordinates are relative to
+    // the view's image, with (0, 0) being the top-left corner.
+    bool getGazeUVCoordinates(const XrPosef& gaze, const XrPosef& viewPose, const XrFovf& fov, XrVector2f& uv);
+
 } // namespace openxr_api_layer::utils::general
@@ -37,6 +37,11 @@ namespace openxr_api_layer::utils::graphics {
     enum class CompositionApi {
 #ifdef XR_USE_GRAPHICS_API_D3D11
         D3D11,
+#endif
+#ifdef XR_USE_GRAPHICS_API_D3D12
+        // When the application uses D3D12, the composition device is created on the application's device and the
+        // runtime's swapchain images are accessed directly without copies.
+        D3D12,
 #endif
     };
 
@@ -48,6 +53,7 @@ namespace openxr_api_layer::utils::graphics {
 
         using Device = ID3D11Device*;
         using Context = ID3D11DeviceContext*;
+        using CommandContext = ID3D11DeviceContext*;
         using Texture = ID3D11Texture2D*;
         using Fence = ID3D11Fence*;
     };
@@ -59,6 +65,7 @@ namespace openxr_api_layer::utils::graphics {
 
         using Device = ID3D12Device*;
         using Context = ID3D12CommandQueue*;
+        using CommandContext = ID3D12GraphicsCommandList*;
         using Texture = ID3D12Resource*;
         using Fence = ID3D12Fence*;
     };
@@ -74,11 +81,64 @@ namespace openxr_api_layer::utils::graphics {
         Api origin{};
     };
 
+    // Categories of the memory allocated by the layer on a device.
+    enum class MemoryCategory {
+        // Textures created with IGraphicsDevice::createTexture(), including swapchain images and bounce buffers
+        // created by the composition framework.
+        Texture,
+
+        // Query heaps and readback buffers of timer pools.
+        Query,
+
+        Count,
+    };
+
+    // The local video memory of the adapter as reported by DXGI. All values are 0 when DXGI cannot report them.
+    struct MemoryBudget {
+        // How much memory the process can use before being subject to residency thrashing. This changes over time.
+        uint64_t budget{0};
+
+        // The memory currently used by the process, including the application's own allocations.
+        uint64_t currentUsage{0};
+    };
+
+    // How well the device recycles the command lists it records internally. All values are 0 when the API does not
+    // expose command lists.
+    struct CommandListStatistics {
+        // A completed command list was reused.
+        uint64_t hits{0};
+        // A new command list was allocated.
+        uint64_t misses{0};
+        // The CPU waited for a command list to complete.
+        uint64_t stalls{0};
+    };
+
+    struct IGraphicsCommandContext;
+
     // A timer on the GPU.
     struct IGraphicsTimer : openxr_api_layer::utils::general::ITimer {
         virtual ~IGraphicsTimer() = default;
 
         virtual Api getApi() const = 0;
+
+        using ITimer::start;
+        using ITimer::stop;
+
+        // Record the measurement into the command context performing the work being timed, instead of submitting it
+        // separately. The measurement completes once the context is submitted with submitCommandContexts().
+        virtual void start(IGraphicsCommandContext* context) = 0;
+        virtual void stop(IGraphicsCommandContext* context) = 0;
+    };
+
+    // A pool of GPU timers. Each timer cycles through several sets of queries, so that query() returns the latest
+    // completed measurement without ever waiting for the GPU.
+    struct IGraphicsTimerPool {
+        virtual ~IGraphicsTimerPool() = default;
+
+        virtual Api getApi() const = 0;
+
+        // The name is used for tracing.
+        virtual std::shared_ptr<IGraphicsTimer> createTimer(const std::string& name) = 0;
     };
 
     // A fence.
@@ -93,6 +153,11 @@ namespace openxr_api_layer::utils::graphics {
         virtual void waitOnDevice(uint64_t value) = 0;
         virtual void waitOnCpu(uint64_t value) = 0;
 
+        // When deferred flush is enabled, signal() does not submit the commands to the GPU, and flush() must be called
+        // before another device or the CPU depends on the signaled value. waitOnCpu() always flushes.
+        virtual void setDeferredFlush(bool deferred) = 0;
+        virtual void flush() = 0;
+
         virtual bool isShareable() const = 0;
 
         template <typename ApiTraits>
@@ -124,6 +189,24 @@ namespace openxr_api_layer::utils::graphics {
         }
     };
 
+    // A context to record commands into, possibly from a worker thread. The commands are only executed once the
+    // context is submitted to its device. With D3D11, this is a deferred context. With D3D12, this is a direct command
+    // list.
+    struct IGraphicsCommandContext {
+        virtual ~IGraphicsCommandContext() = default;
+
+        virtual Api getApi() const = 0;
+        virtual void* getNativeContextPtr() const = 0;
+
+        template <typename ApiTraits>
+        typename ApiTraits::CommandContext getNativeContext() const {
+            if (ApiTraits::Api != getApi()) {
+                throw std::runtime_error("Api mismatch");
+            }
+            return reinterpret_cast<typename ApiTraits::CommandContext>(getNativeContextPtr());
+        }
+    };
+
     // A graphics device and execution context.
     struct IGraphicsDevice {
         virtual ~IGraphicsDevice() = default;
@@ -133,6 +216,8 @@ namespace openxr_api_layer::utils::graphics {
         virtual void* getNativeContextPtr() const = 0;
 
         virtual std::shared_ptr<IGraphicsTimer> createTimer() = 0;
+        // Up to maxTimers timers with up to latency measurements in-flight each.
+        virtual std::shared_ptr<IGraphicsTimerPool> createTimerPool(uint32_t maxTimers, uint32_t latency = 4) = 0;
         virtual std::shared_ptr<IGraphicsFence> createFence(bool shareable = true) = 0;
         virtual std::shared_ptr<IGraphicsFence> openFence(const ShareableHandle& handle) = 0;
         virtual std::shared_ptr<IGraphicsTexture> createTexture(const XrSwapchainCreateInfo& info,
@@ -143,12 +228,38 @@ namespace openxr_api_layer::utils::graphics {
                                                                  const XrSwapchainCreateInfo& info) = 0;
 
         virtual void copyTexture(IGraphicsTexture* from, IGraphicsTexture* to) = 0;
+        // Copy a region of the first mip level of a range of array slices. The region is clamped to the dimensions of
+        // the textures. Depth and multisampled textures are always copied in their entirety for each slice.
+        virtual void copyTextureRegion(IGraphicsTexture* from,
+                                       IGraphicsTexture* to,
+                                       const XrRect2Di& region,
+                                       uint32_t firstSlice,
+                                       uint32_t sliceCount) = 0;
+        // Copies may execute asynchronously from the rest of the work submitted to the device. Make the subsequent
+        // work wait for the copies submitted so far, for example before handing a copied swapchain image back to the
+        // runtime or to the application.
+        virtual void waitForCopies() = 0;
+
+        // Command contexts are recycled once submitted. A command context can be recorded from any thread, but only
+        // from one thread at a time.
+        virtual std::unique_ptr<IGraphicsCommandContext> acquireCommandContext() = 0;
+        // Execute the commands recorded into the command contexts, in order. Must be called from the thread using the
+        // device's execution context.
+        virtual void submitCommandContexts(std::vector<std::unique_ptr<IGraphicsCommandContext>> contexts) = 0;
 
         virtual GenericFormat translateToGenericFormat(int64_t format) const = 0;
         virtual int64_t translateFromGenericFormat(GenericFormat format) const = 0;
 
         virtual LUID getAdapterLuid() const = 0;
 
+        // Memory allocated through this device and not yet released. Textures opened from existing resources are not
+        // accounted for.
+        virtual uint64_t getAllocatedMemory(MemoryCategory category) const = 0;
+        // This queries DXGI and should not be called more than once per frame.
+        virtual MemoryBudget queryMemoryBudget() const = 0;
+        // Cumulated since the creation of the device.
+        virtual CommandListStatistics getCommandListStatistics() const = 0;
+
         template <typename ApiTraits>
         typename ApiTraits::Device getNativeDevice() const {
             if (ApiTraits::Api != getApi()) {
@@ -205,11 +316,42 @@ namespace openxr_api_layer::utils::graphics {
         virtual ISwapchainImage* getLastReleasedImage() const = 0;
         virtual void commitLastReleasedImage() = 0;
 
+        // Acquire and wait for the next image on a worker thread as soon as the last released image is committed, so
+        // that acquireImage() finds it ready. Only for swapchains owned by the layer. With a finite timeout,
+        // acquireImage() stops waiting for a pending prefetch after that duration and returns the last committed image
+        // instead, without acquiring it (see isAcquiredImageReused()): the caller should then skip rendering, not
+        // release the image, and submit the swapchain as-is, so that the runtime reuses the previous image.
+        virtual void setPrefetch(bool enable, XrDuration timeout = XR_INFINITE_DURATION) = 0;
+
+        // Whether the last acquireImage() returned the previous image after a prefetch timeout.
+        virtual bool isAcquiredImageReused() const = 0;
+
+        // Dirty tracking. Every releaseImage() produces a new content generation, and the layer declares the generation
+        // of its own composition inputs with setLayerGeneration(). isCompositionNeeded() returns false when neither
+        // changed since the last released image was consumed, with commitLastReleasedImage() or, for a read-only
+        // swapchain, with getLastReleasedImage(): the layer may then skip composition for this swapchain entirely and
+        // submit the previously composited layer without touching the GPU.
+        virtual void setLayerGeneration(uint64_t generation) = 0;
+        virtual bool isCompositionNeeded() const = 0;
+
+        // The depth swapchain paired with this color swapchain, if any. The color swapchain keeps it alive. See
+        // ICompositionFramework::createDepthSwapchain().
+        virtual void setDepthSwapchain(std::shared_ptr<ISwapchain> depthSwapchain) = 0;
+        virtual ISwapchain* getDepthSwapchain() const = 0;
+
+        // Declare the region and array slices that will be accessed during composition. Copies that might be needed
+        // in getLastReleasedImage() and commitLastReleasedImage() are restricted to it, until resetDirtyRegion().
+        virtual void setDirtyRegion(const XrRect2Di& region, uint32_t firstSlice = 0, uint32_t sliceCount = 1) = 0;
+        virtual void resetDirtyRegion() = 0;
+
         virtual const XrSwapchainCreateInfo& getInfoOnCompositionDevice() const = 0;
         virtual int64_t getFormatOnApplicationDevice() const = 0;
         virtual ISwapchainImage* getImage(uint32_t index) const = 0;
         virtual uint32_t getLength() const = 0;
 
+        // Whether the swapchain was created with SwapchainMode::Submit.
+        virtual bool isSubmittable() const = 0;
+
         // Can only be called if the swapchain is submittable.
         virtual XrSwapchain getSwapchainHandle() const = 0;
         virtual XrSwapchainSubImage getSubImage() const = 0;
@@ -224,6 +366,22 @@ namespace openxr_api_layer::utils::graphics {
         virtual IGraphicsTexture* getTextureForWrite() const = 0;
 
         virtual uint32_t getIndex() const = 0;
+
+        // The content generation of the swapchain when this image was last released, see
+        // ISwapchain::isCompositionNeeded(). Layers can derive the generation of their inputs from it.
+        virtual uint64_t getGeneration() const = 0;
+    };
+
+    // Modes of serialization between the application device and the composition device.
+    enum class SerializationMode {
+        // Every operation on a swapchain synchronizes the two devices immediately.
+        Immediate,
+
+        // Synchronization is tracked and batched into (at most) one timeline point per frame in each direction.
+        // Application-to-composition synchronization is deferred until a swapchain image texture is accessed on the
+        // composition device, and commits of swapchain images between serializePreComposition() and
+        // serializePostComposition() are deferred until serializePostComposition().
+        Batched,
     };
 
     // A container for user session data.
@@ -246,6 +404,28 @@ namespace openxr_api_layer::utils::graphics {
         virtual std::shared_ptr<ISwapchain> createSwapchain(const XrSwapchainCreateInfo& infoOnApplicationDevice,
                                                             SwapchainMode mode) = 0;
 
+        // Create a depth swapchain with the dimensions, array size and sample count of a color swapchain, using the
+        // preferred depth format, and pair it with the color swapchain. Like any submittable swapchain, its images are
+        // shared with the composition device without copies when the runtime allows it.
+        virtual std::shared_ptr<ISwapchain> createDepthSwapchain(ISwapchain* colorSwapchain,
+                                                                 SwapchainMode mode = SwapchainMode::Submit |
+                                                                                      SwapchainMode::Write) = 0;
+
+        // Whether the application enabled XR_KHR_composition_layer_depth, which is required to submit depth.
+        virtual bool isDepthSubmissionSupported() const = 0;
+
+        // Chain depth information to a projection view, for use by the runtime's reprojection. The depth swapchain
+        // must be submittable and its last released image must be committed along with the color image. The sub-image
+        // matches the view's. depthInfo must remain valid until the upstream xrEndFrame() returns. Returns false and
+        // leaves the view untouched if depth cannot be submitted.
+        virtual bool attachDepthInfo(XrCompositionLayerProjectionView& view,
+                                     XrCompositionLayerDepthInfoKHR& depthInfo,
+                                     const ISwapchain* depthSwapchain,
+                                     float nearZ,
+                                     float farZ,
+                                     float minDepth = 0.f,
+                                     float maxDepth = 1.f) const = 0;
+
         // Must be called at the beginning of the layer's xrEndFrame() implementation to serialize application commands
         // prior to composition.
         virtual void serializePreComposition() = 0;
@@ -254,6 +434,40 @@ namespace openxr_api_layer::utils::graphics {
         // prior to submission.
         virtual void serializePostComposition() = 0;
 
+        // Run independent composition tasks (eg: one per swapchain) in parallel, each recording into its own command
+        // context on the composition device. The commands are submitted in the order of the tasks once all the tasks
+        // have completed. Must be called between serializePreComposition() and serializePostComposition().
+        // The tasks must only record commands: swapchain images must be acquired or resolved beforehand.
+        virtual void runCompositionTasks(const std::vector<std::function<void(IGraphicsCommandContext*)>>& tasks) = 0;
+
+        // Locate the gaze point (eg: from IInputFramework::locateEyeGaze()) for each projection view, for use with
+        // foveated composition. The gaze and the views must be located using the same base space. uvs[i] is in the UV
+        // space of the whole swapchain (of extent swapchainExtents[i]), within views[i].subImage.imageRect. It is empty
+        // when the gaze falls outside of views[i].
+        virtual void getGazeUVCoordinates(const XrPosef& gaze,
+                                          const XrCompositionLayerProjectionView* views,
+                                          const XrExtent2Di* swapchainExtents,
+                                          uint32_t viewCount,
+                                          std::optional<XrVector2f>* uvs) const = 0;
+
+        // The memory budget of the adapter, refreshed at most once per second in serializePreComposition(), and the
+        // memory allocated by the framework and the layer for this session on both devices.
+        virtual MemoryBudget getMemoryBudget() const = 0;
+        virtual uint64_t getAllocatedMemory(MemoryCategory category) const = 0;
+
+        // The framework is low on memory when the usage of the process exceeds this fraction of the budget (0.9 by
+        // default). It then stops keeping textures of destroyed swapchains for reuse, and the layer should scale down
+        // its own allocations (eg: fewer or smaller intermediate textures) while isLowOnMemory() returns true.
+        virtual void setLowMemoryThreshold(float fraction) = 0;
+        virtual bool isLowOnMemory() const = 0;
+
+        // Select how the application device and the composition device are synchronized. Immediate is the default.
+        virtual void setSerializationMode(SerializationMode mode) = 0;
+
+        // Textures of destroyed swapchains are kept for reuse by new swapchains with identical properties, up to this
+        // (estimated) amount of memory.
+        virtual void setTexturePoolBudget(uint64_t budgetBytes) = 0;
+
         virtual IGraphicsDevice* getCompositionDevice() const = 0;
         virtual IGraphicsDevice* getApplicationDevice() const = 0;
         virtual int64_t getPreferredSwapchainFormatOnApplicationDevice(XrSwapchainUsageFlags usageFlags,
@@ -285,12 +499,37 @@ namespace openxr_api_layer::utils::graphics {
 
     namespace internal {
 
+        // Rough estimate of the memory occupation of a texture, for budgeting purposes.
+        uint64_t estimateTextureSize(const XrSwapchainCreateInfo& info);
+
+        // Accounting of the memory allocated through a device. Resources hold a reference to it, since they may be
+        // released after their device.
+        struct MemoryTracker {
+            void add(MemoryCategory category, uint64_t bytes) {
+                m_allocated[(size_t)category].fetch_add(bytes, std::memory_order_relaxed);
+            }
+
+            void remove(MemoryCategory category, uint64_t bytes) {
+                m_allocated[(size_t)category].fetch_sub(bytes, std::memory_order_relaxed);
+            }
+
+            uint64_t get(MemoryCategory category) const {
+                return m_allocated[(size_t)category].load(std::memory_order_relaxed);
+            }
+
+          private:
+            std::array<std::atomic<uint64_t>, (size_t)MemoryCategory::Count> m_allocated{};
+        };
+
 #ifdef XR_USE_GRAPHICS_API_D3D11
         std::shared_ptr<IGraphicsDevice> createD3D11CompositionDevice(LUID adapterLuid);
         std::shared_ptr<IGraphicsDevice> wrapApplicationDevice(const XrGraphicsBindingD3D11KHR& bindings);
 #endif
 
 #ifdef XR_USE_GRAPHICS_API_D3D12
+        std::shared_ptr<IGraphicsDevice> createD3D12CompositionDevice(LUID adapterLuid);
+        // Create a composition device with its own command queue on an existing device.
+        std::shared_ptr<IGraphicsDevice> createD3D12CompositionDevice(ID3D12Device* device);
         std::shared_ptr<IGraphicsDevice> wrapApplicationDevice(const XrGraphicsBindingD3D12KHR& bindings);
 #endif
 
@@ -24,6 +24,7 @@
 
 #include "log.h"
 #include "inputs.h"
+#include "metrics.h"
 
 namespace xr {
 
@@ -52,8 +53,40 @@ namespace {
     using namespace openxr_api_layer::utils::general;
     using namespace openxr_api_layer::utils::inputs;
     using namespace xr::math;
+    namespace metrics = openxr_api_layer::metrics;
 
     constexpr float ThumbstickDeadzone = 0.2f;
+    constexpr uint32_t MotionControllerButtonCount = 4;
+
+    XrVector2f applyThumbstickDeadzone(const XrActionStateVector2f& state) {
+        if (state.isActive) {
+            const float length =
+                std::sqrt(state.currentState.x * state.currentState.x + state.currentState.y * state.currentState.y);
+            if (length >= ThumbstickDeadzone) {
+                XrVector2f normalizedInput{state.currentState.x / length, state.currentState.y / length};
+                const float scaling = (length - ThumbstickDeadzone) / (1 - ThumbstickDeadzone);
+                return {normalizedInput.x * scaling, normalizedInput.y * scaling};
+            }
+        }
+        return {0, 0};
+    }
+
+    // The state of all the framework actions for the current frame.
+    struct ActionStateSnapshot {
+        bool isValid{false};
+        bool buttons[Hands::Count][MotionControllerButtonCount]{};
+        XrVector2f thumbsticks[Hands::Count]{};
+        XrSpaceLocationFlags locationFlags[Hands::Count]{};
+        XrPosef poses[Hands::Count]{Pose::Identity(), Pose::Identity()};
+    };
+
+    // The motion controller poses relocated right before composition.
+    struct LatchedPoses {
+        bool isValid{false};
+        XrSpace baseSpace{XR_NULL_HANDLE};
+        XrSpaceLocationFlags locationFlags[Hands::Count]{};
+        XrPosef poses[Hands::Count]{Pose::Identity(), Pose::Identity()};
+    };
 
     struct FrameworkActions {
         XrActionSet actionSet{XR_NULL_HANDLE};
@@ -64,9 +97,83 @@ namespace {
         XrAction thumbstickClickAction{XR_NULL_HANDLE};
         XrAction thumbstickPositionAction{XR_NULL_HANDLE};
         XrAction hapticAction{XR_NULL_HANDLE};
+        XrAction eyeGazeAction{XR_NULL_HANDLE};
         bool isOpenComposite{false};
     };
 
+    // A bidirectional intern table for XrPath, populated lazily.
+    // Paths remain valid for the lifetime of the instance, therefore entries are never evicted. Lookups do not allocate
+    // once a path has been interned.
+    class PathCache {
+      public:
+        PathCache(XrInstance instance, PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr) : m_instance(instance) {
+            CHECK_XRCMD(xrGetInstanceProcAddr(
+                instance, "xrStringToPath", reinterpret_cast<PFN_xrVoidFunction*>(&xrStringToPath)));
+            CHECK_XRCMD(xrGetInstanceProcAddr(
+                instance, "xrPathToString", reinterpret_cast<PFN_xrVoidFunction*>(&xrPathToString)));
+        }
+
+        XrPath getPath(std::string_view path) {
+            std::unique_lock lock(m_mutex);
+
+            const auto it = m_paths.find(path);
+            if (it != m_paths.cend()) {
+                return it->second;
+            }
+
+            std::string str(path);
+            XrPath xrPath;
+            CHECK_XRCMD(xrStringToPath(m_instance, str.c_str(), &xrPath));
+            m_strings.insert_or_assign(xrPath, str);
+            m_paths.insert_or_assign(std::move(str), xrPath);
+
+            return xrPath;
+        }
+
+        const std::string& getString(XrPath path) {
+            static const std::string nullPath = "<null>";
+            if (path == XR_NULL_PATH) {
+                return nullPath;
+            }
+
+            std::unique_lock lock(m_mutex);
+
+            const auto it = m_strings.find(path);
+            if (it != m_strings.cend()) {
+                return it->second;
+            }
+
+            char buf[XR_MAX_PATH_LENGTH];
+            uint32_t count;
+            CHECK_XRCMD(xrPathToString(m_instance, path, sizeof(buf), &count, buf));
+            std::string str(buf, count - 1);
+            m_paths.insert_or_assign(str, path);
+
+            return m_strings.insert_or_assign(path, std::move(str)).first->second;
+        }
+
+      private:
+        const XrInstance m_instance;
+
+        std::mutex m_mutex;
+        std::map<std::string, XrPath, std::less<>> m_paths;
+        std::unordered_map<XrPath, std::string> m_strings;
+
+        PFN_xrStringToPath xrStringToPath{nullptr};
+        PFN_xrPathToString xrPathToString{nullptr};
+    };
+
+    // Make sure our bindings are complete. We only submit suggestions for the interaction profiles in the core spec,
+    // and hope runtimes do the right thing for implicit remapping.
+    constexpr std::string_view CoreInteractionProfiles[] = {"/interaction_profiles/khr/simple_controller",
+                                                            "/interaction_profiles/htc/vive_controller",
+                                                            "/interaction_profiles/microsoft/motion_controller",
+                                                            "/interaction_profiles/oculus/touch_controller",
+                                                            "/interaction_profiles/valve/index_controller"};
+
+    constexpr std::string_view EyeGazeInteractionProfile = "/interaction_profiles/ext/eye_gaze_interaction";
+    constexpr std::string_view EyeGazePosePath = "/user/eyes_ext/input/gaze_ext/pose";
+
     struct ForwardDispatch {
         PFN_xrWaitFrame xrWaitFrame{nullptr};
         PFN_xrBeginFrame xrBeginFrame{nullptr};
@@ -83,11 +190,12 @@ namespace {
                        const FrameworkActions& frameworkActions,
                        PFN_xrSuggestInteractionProfileBindings xrSuggestInteractionProfileBindings_,
                        const ForwardDispatch& forwardDispatch,
+                       PathCache& pathCache,
                        InputMethod methods)
             : m_instance(instance), xrGetInstanceProcAddr(xrGetInstanceProcAddr_), m_session(session),
               m_frameworkActions(frameworkActions),
               xrSuggestInteractionProfileBindings(xrSuggestInteractionProfileBindings_),
-              m_forwardDispatch(forwardDispatch) {
+              m_forwardDispatch(forwardDispatch), m_pathCache(pathCache) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(
                 local, "InputFramework_Create", TLXArg(session, "Session"), TLArg((int)methods, "InputMethods"));
@@ -106,13 +214,16 @@ namespace {
                                               reinterpret_cast<PFN_xrVoidFunction*>(&xrGetActionStateVector2f)));
             CHECK_XRCMD(xrGetInstanceProcAddr(
                 instance, "xrApplyHapticFeedback", reinterpret_cast<PFN_xrVoidFunction*>(&xrApplyHapticFeedback)));
-            CHECK_XRCMD(xrGetInstanceProcAddr(
-                instance, "xrStringToPath", reinterpret_cast<PFN_xrVoidFunction*>(&xrStringToPath)));
-            CHECK_XRCMD(xrGetInstanceProcAddr(
-                instance, "xrPathToString", reinterpret_cast<PFN_xrVoidFunction*>(&xrPathToString)));
+#ifdef XR_KHR_locate_spaces
+            // Only available if the application enabled the extension.
+            if (XR_FAILED(xrGetInstanceProcAddr(
+                    instance, "xrLocateSpacesKHR", reinterpret_cast<PFN_xrVoidFunction*>(&xrLocateSpacesKHR)))) {
+                xrLocateSpacesKHR = nullptr;
+            }
+#endif
 
-            CHECK_XRCMD(xrStringToPath(m_instance, "/user/hand/left", &m_sidePath[Hands::Left]));
-            CHECK_XRCMD(xrStringToPath(m_instance, "/user/hand/right", &m_sidePath[Hands::Right]));
+            m_sidePath[Hands::Left] = m_pathCache.getPath("/user/hand/left");
+            m_sidePath[Hands::Right] = m_pathCache.getPath("/user/hand/right");
 
             // Create the necessary action spaces for motion controller tracking.
             if (m_frameworkActions.aimAction != XR_NULL_HANDLE) {
@@ -129,6 +240,36 @@ namespace {
                 CHECK_XRCMD(xrCreateActionSpace(m_session, &actionSpaceInfo, &m_aimActionSpace[Hands::Right]));
             }
 
+            // Create the action space for eye tracking, if the system supports it.
+            if (m_frameworkActions.eyeGazeAction != XR_NULL_HANDLE) {
+                m_isEyeGazeRequested = true;
+
+#ifdef XR_EXT_eye_gaze_interaction
+                PFN_xrGetSystemProperties xrGetSystemProperties;
+                CHECK_XRCMD(xrGetInstanceProcAddr(
+                    instance, "xrGetSystemProperties", reinterpret_cast<PFN_xrVoidFunction*>(&xrGetSystemProperties)));
+
+                XrSystemEyeGazeInteractionPropertiesEXT eyeGazeProperties{
+                    XR_TYPE_SYSTEM_EYE_GAZE_INTERACTION_PROPERTIES_EXT};
+                XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES, &eyeGazeProperties};
+                CHECK_XRCMD(xrGetSystemProperties(instance, sessionInfo.systemId, &systemProperties));
+                TraceLoggingWriteTagged(local,
+                                        "InputFramework_Create_EyeGaze",
+                                        TLArg(!!eyeGazeProperties.supportsEyeGazeInteraction, "Supported"));
+
+                if (eyeGazeProperties.supportsEyeGazeInteraction) {
+                    PFN_xrCreateActionSpace xrCreateActionSpace;
+                    CHECK_XRCMD(xrGetInstanceProcAddr(
+                        instance, "xrCreateActionSpace", reinterpret_cast<PFN_xrVoidFunction*>(&xrCreateActionSpace)));
+
+                    XrActionSpaceCreateInfo actionSpaceInfo{XR_TYPE_ACTION_SPACE_CREATE_INFO};
+                    actionSpaceInfo.action = m_frameworkActions.eyeGazeAction;
+                    actionSpaceInfo.poseInActionSpace = Pose::Identity();
+                    CHECK_XRCMD(xrCreateActionSpace(m_session, &actionSpaceInfo, &m_eyeGazeActionSpace));
+                }
+#endif
+            }
+
             TraceLoggingWriteStop(local, "InputFramework_Create", TLPArg(this, "InputFramework"));
         }
 
@@ -144,6 +285,9 @@ namespace {
                         xrDestroySpace(m_aimActionSpace[side]);
                     }
                 }
+                if (m_eyeGazeActionSpace != XR_NULL_HANDLE) {
+                    xrDestroySpace(m_eyeGazeActionSpace);
+                }
             }
 
             TraceLoggingWriteStop(local, "InputFramework_Destroy");
@@ -179,44 +323,150 @@ namespace {
             TraceLoggingWriteStop(local, "InputFramework_BlockApplicationInput");
         }
 
+        XrTime getCurrentFrameTime() const {
+            return m_currentFrameTime;
+        }
+
         XrSpaceLocationFlags locateMotionController(uint32_t side, XrSpace baseSpace, XrPosef& pose) const {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(
                 local, "InputFramework_LocateMotionController", TLXArg(m_session, "Session"), TLArg(side, "Side"));
 
-            if (side >= Hands::Count) {
-                throw std::runtime_error("Invalid hand");
-            }
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
 
-            if (m_aimActionSpace[side] == XR_NULL_HANDLE) {
-                throw std::runtime_error(
-                    "Motion controller tracking is not available (did you specify MotionControllerSpatial methods?)");
-            }
+            checkMotionControllerSpace(side);
 
             if (!m_wasActionSetsAttached) {
                 return 0;
             }
 
-            // Prevent error before the first frame.
-            XrSpaceLocationFlags locationFlags = 0;
-            if (m_currentFrameTime) {
-                XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
-                CHECK_XRCMD(xrLocateSpace(m_aimActionSpace[side], baseSpace, m_currentFrameTime, &location));
-                if (Pose::IsPoseValid(location.locationFlags)) {
-                    pose = location.pose;
-                } else {
-                    pose = Pose::Identity();
+            {
+                std::unique_lock lock(m_snapshotMutex);
+
+                if (m_latchedPoses.isValid && baseSpace == m_latchedPoses.baseSpace) {
+                    pose = m_latchedPoses.poses[side];
+
+                    TraceHotPathWriteStop(local,
+                                          "InputFramework_LocateMotionController",
+                                          TLArg(m_latchedPoses.locationFlags[side], "LocationFlags"),
+                                          TLArg(true, "FromLatch"));
+
+                    return m_latchedPoses.locationFlags[side];
                 }
 
-                locationFlags = location.locationFlags;
+                if (m_snapshot.isValid && baseSpace == m_snapshotBaseSpace) {
+                    pose = m_snapshot.poses[side];
+
+                    TraceHotPathWriteStop(local,
+                                          "InputFramework_LocateMotionController",
+                                          TLArg(m_snapshot.locationFlags[side], "LocationFlags"),
+                                          TLArg(true, "FromSnapshot"));
+
+                    return m_snapshot.locationFlags[side];
+                }
             }
 
-            TraceLoggingWriteStop(
+            const XrSpaceLocationFlags locationFlags =
+                locateMotionControllerAt(side, baseSpace, m_currentFrameTime, pose);
+
+            TraceHotPathWriteStop(
+                local, "InputFramework_LocateMotionController", TLArg(locationFlags, "LocationFlags"));
+
+            return locationFlags;
+        }
+
+        XrSpaceLocationFlags
+        locateMotionController(uint32_t side, XrSpace baseSpace, XrTime time, XrPosef& pose) const {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
+                                   "InputFramework_LocateMotionController",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg(side, "Side"),
+                                   TLArg(time, "Time"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
+
+            checkMotionControllerSpace(side);
+
+            if (!m_wasActionSetsAttached) {
+                return 0;
+            }
+
+            const XrSpaceLocationFlags locationFlags = locateMotionControllerAt(side, baseSpace, time, pose);
+
+            TraceHotPathWriteStop(
                 local, "InputFramework_LocateMotionController", TLArg(locationFlags, "LocationFlags"));
 
             return locationFlags;
         }
 
+        void latchMotionControllerPoses(XrSpace baseSpace, XrTime time) override {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
+                                   "InputFramework_LatchMotionControllerPoses",
+                                   TLXArg(m_session, "Session"),
+                                   TLXArg(baseSpace, "BaseSpace"),
+                                   TLArg(time, "Time"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
+
+            checkMotionControllerSpace(Hands::Left);
+
+            std::unique_lock lock(m_frameMutex);
+
+            if (!time) {
+                time = m_currentFrameTime;
+            }
+
+            // Prevent error before the first frame.
+            if (!m_wasActionSetsAttached || !time) {
+                TraceHotPathWriteStop(local, "InputFramework_LatchMotionControllerPoses", TLArg(false, "Latched"));
+                return;
+            }
+
+            LatchedPoses latchedPoses;
+            latchedPoses.baseSpace = baseSpace;
+#ifdef XR_KHR_locate_spaces
+            if (xrLocateSpacesKHR) {
+                XrSpacesLocateInfoKHR locateInfo{XR_TYPE_SPACES_LOCATE_INFO_KHR};
+                locateInfo.baseSpace = baseSpace;
+                locateInfo.time = time;
+                locateInfo.spaceCount = Hands::Count;
+                locateInfo.spaces = m_aimActionSpace;
+
+                XrSpaceLocationDataKHR locationData[Hands::Count]{};
+                XrSpaceLocationsKHR locations{XR_TYPE_SPACE_LOCATIONS_KHR};
+                locations.locationCount = Hands::Count;
+                locations.locations = locationData;
+                CHECK_XRCMD(xrLocateSpacesKHR(m_session, &locateInfo, &locations));
+
+                for (uint32_t side = 0; side < Hands::Count; side++) {
+                    if (Pose::IsPoseValid(locationData[side].locationFlags)) {
+                        latchedPoses.poses[side] = locationData[side].pose;
+                    }
+                    latchedPoses.locationFlags[side] = locationData[side].locationFlags;
+                }
+            } else
+#endif
+            {
+                for (uint32_t side = 0; side < Hands::Count; side++) {
+                    latchedPoses.locationFlags[side] =
+                        locateMotionControllerAt(side, baseSpace, time, latchedPoses.poses[side]);
+                }
+            }
+            latchedPoses.isValid = true;
+            {
+                std::unique_lock snapshotLock(m_snapshotMutex);
+                m_latchedPoses = latchedPoses;
+            }
+
+            TraceHotPathWriteStop(local,
+                                  "InputFramework_LatchMotionControllerPoses",
+                                  TLArg(true, "Latched"),
+                                  TLArg(latchedPoses.locationFlags[Hands::Left], "LeftLocationFlags"),
+                                  TLArg(latchedPoses.locationFlags[Hands::Right], "RightLocationFlags"));
+        }
+
         XrSpace getMotionControllerSpace(uint32_t side) const {
             if (side >= Hands::Count) {
                 throw std::runtime_error("Invalid hand");
@@ -226,35 +476,20 @@ namespace {
         }
 
         bool getMotionControllerButtonState(uint32_t side, MotionControllerButton button) const {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
                                    "InputFramework_GetMotionControllerButtonState",
                                    TLXArg(m_session, "Session"),
                                    TLArg(side, "Side"),
                                    TLArg(xr::ToString(button).c_str(), "Button"));
 
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
+
             if (side >= Hands::Count) {
                 throw std::runtime_error("Invalid hand");
             }
 
-            XrAction action;
-            switch (button) {
-            case MotionControllerButton::Select:
-                action = m_frameworkActions.selectAction;
-                break;
-            case MotionControllerButton::Menu:
-                action = m_frameworkActions.menuAction;
-                break;
-            case MotionControllerButton::Squeeze:
-                action = m_frameworkActions.squeezeAction;
-                break;
-            case MotionControllerButton::ThumbstickClick:
-                action = m_frameworkActions.thumbstickClickAction;
-                break;
-            default:
-                throw std::runtime_error("Invalid button");
-            }
-
+            const XrAction action = getButtonAction(button);
             if (action == XR_NULL_HANDLE) {
                 throw std::runtime_error("Motion controller buttons are not available (did you specify the "
                                          "MotionControllerButtons input method?)");
@@ -264,6 +499,21 @@ namespace {
                 return false;
             }
 
+            {
+                std::unique_lock lock(m_snapshotMutex);
+
+                if (m_snapshot.isValid) {
+                    const bool state = m_snapshot.buttons[side][static_cast<uint32_t>(button)];
+
+                    TraceHotPathWriteStop(local,
+                                          "InputFramework_GetMotionControllerButtonState",
+                                          TLArg(state, "State"),
+                                          TLArg(true, "FromSnapshot"));
+
+                    return state;
+                }
+            }
+
             XrActionStateGetInfo actionInfo{XR_TYPE_ACTION_STATE_GET_INFO};
             actionInfo.action = action;
             actionInfo.subactionPath = m_sidePath[side];
@@ -271,7 +521,7 @@ namespace {
             XrActionStateBoolean state{XR_TYPE_ACTION_STATE_BOOLEAN};
             CHECK_XRCMD(xrGetActionStateBoolean(m_session, &actionInfo, &state));
 
-            TraceLoggingWriteStop(local,
+            TraceHotPathWriteStop(local,
                                   "InputFramework_GetMotionControllerButtonState",
                                   TLArg(!!state.isActive, "IsActive"),
                                   TLArg(!!state.currentState, "State"));
@@ -280,12 +530,14 @@ namespace {
         }
 
         XrVector2f getMotionControllerThumbstickState(uint32_t side) const {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local,
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local,
                                    "InputFramework_GetMotionControllerThumbstickState",
                                    TLXArg(m_session, "Session"),
                                    TLArg(side, "Side"));
 
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
+
             if (side >= Hands::Count) {
                 throw std::runtime_error("Invalid hand");
             }
@@ -299,6 +551,21 @@ namespace {
                 return {0, 0};
             }
 
+            {
+                std::unique_lock lock(m_snapshotMutex);
+
+                if (m_snapshot.isValid) {
+                    const XrVector2f state = m_snapshot.thumbsticks[side];
+
+                    TraceHotPathWriteStop(local,
+                                          "InputFramework_GetMotionControllerThumbstickState",
+                                          TLArg(fmt::format("x:{}, y:{}", state.x, state.y).c_str(), "State"),
+                                          TLArg(true, "FromSnapshot"));
+
+                    return state;
+                }
+            }
+
             XrActionStateGetInfo actionInfo{XR_TYPE_ACTION_STATE_GET_INFO};
             actionInfo.action = m_frameworkActions.thumbstickPositionAction;
             actionInfo.subactionPath = m_sidePath[side];
@@ -306,22 +573,13 @@ namespace {
             XrActionStateVector2f state{XR_TYPE_ACTION_STATE_VECTOR2F};
             CHECK_XRCMD(xrGetActionStateVector2f(m_session, &actionInfo, &state));
 
-            TraceLoggingWriteStop(
+            TraceHotPathWriteStop(
                 local,
                 "InputFramework_GetMotionControllerThumbstickState",
                 TLArg(!!state.isActive, "IsActive"),
                 TLArg(fmt::format("x:{}, y:{}", state.currentState.x, state.currentState.y).c_str(), "State"));
 
-            if (state.isActive) {
-                const float length = std::sqrt(state.currentState.x * state.currentState.x +
-                                               state.currentState.y * state.currentState.y);
-                if (length >= ThumbstickDeadzone) {
-                    XrVector2f normalizedInput{state.currentState.x / length, state.currentState.y / length};
-                    const float scaling = (length - ThumbstickDeadzone) / (1 - ThumbstickDeadzone);
-                    return {normalizedInput.x * scaling, normalizedInput.y * scaling};
-                }
-            }
-            return {0, 0};
+            return applyThumbstickDeadzone(state);
         }
 
         void pulseMotionControllerHaptics(uint32_t side, float strength) const {
@@ -362,13 +620,72 @@ namespace {
             TraceLoggingWriteStop(local, "InputFramework_PulseMotionControllerHaptics");
         }
 
+        bool isEyeGazeAvailable() const override {
+            checkEyeGazeRequested();
+
+            return m_eyeGazeActionSpace != XR_NULL_HANDLE;
+        }
+
+        XrSpaceLocationFlags locateEyeGaze(XrSpace baseSpace, XrPosef& pose) const override {
+            return locateEyeGaze(baseSpace, m_currentFrameTime, pose);
+        }
+
+        XrSpaceLocationFlags locateEyeGaze(XrSpace baseSpace, XrTime time, XrPosef& pose) const override {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(
+                local, "InputFramework_LocateEyeGaze", TLXArg(m_session, "Session"), TLArg(time, "Time"));
+
+            const metrics::ScopedRecord metricsRecord(metrics::Stage::InputQueries);
+
+            checkEyeGazeRequested();
+
+            if (!m_wasActionSetsAttached || m_eyeGazeActionSpace == XR_NULL_HANDLE) {
+                pose = Pose::Identity();
+                return 0;
+            }
+
+            const XrSpaceLocationFlags locationFlags = locateSpaceAt(m_eyeGazeActionSpace, baseSpace, time, pose);
+
+            TraceHotPathWriteStop(local, "InputFramework_LocateEyeGaze", TLArg(locationFlags, "LocationFlags"));
+
+            return locationFlags;
+        }
+
+        void setActionStateSnapshot(bool enabled, XrSpace baseSpace) override {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "InputFramework_SetActionStateSnapshot",
+                                   TLXArg(m_session, "Session"),
+                                   TLArg(enabled, "Enabled"),
+                                   TLXArg(baseSpace, "BaseSpace"));
+
+            std::unique_lock lock(m_frameMutex);
+
+            m_useSnapshot = enabled;
+            {
+                std::unique_lock snapshotLock(m_snapshotMutex);
+
+                m_snapshotBaseSpace = baseSpace;
+
+                // Wait for the next frame to populate a snapshot.
+                m_snapshot.isValid = false;
+            }
+
+            TraceLoggingWriteStop(local, "InputFramework_SetActionStateSnapshot");
+        }
+
         void updateNeedPollEvent(bool needPollEvent) {
             m_needPollEvent = needPollEvent;
         }
 
+        // The current interaction profiles are only queried again after the runtime signals a change.
+        void invalidateInteractionProfile() {
+            m_isInteractionProfileDirty.store(true, std::memory_order_release);
+        }
+
         XrResult xrWaitFrame_subst(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "InputFramework_WaitFrame", TLXArg(session, "Session"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "InputFramework_WaitFrame", TLXArg(session, "Session"));
 
             const XrResult result = m_forwardDispatch.xrWaitFrame(session, frameWaitInfo, frameState);
             if (XR_SUCCEEDED(result)) {
@@ -377,7 +694,7 @@ namespace {
                 m_waitedFrameTime.push_back(frameState->predictedDisplayTime);
             }
 
-            TraceLoggingWriteStop(local,
+            TraceHotPathWriteStop(local,
                                   "InputFramework_WaitFrame",
                                   TLArg(xr::ToCString(result), "Result"),
                                   TLArg(frameState->predictedDisplayTime, "PredictedDisplayTime"));
@@ -386,15 +703,16 @@ namespace {
         }
 
         XrResult xrBeginFrame_subst(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "InputFramework_BeginFrame", TLXArg(session, "Session"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "InputFramework_BeginFrame", TLXArg(session, "Session"));
 
             const XrResult result = m_forwardDispatch.xrBeginFrame(session, frameBeginInfo);
             if (XR_SUCCEEDED(result)) {
+                const metrics::ScopedRecord metricsRecord(metrics::Stage::InputBeginFrame);
                 std::unique_lock lock(m_frameMutex);
 
                 if (m_frameworkActions.actionSet != XR_NULL_HANDLE) {
-                    TraceLoggingWriteTagged(local,
+                    TraceHotPathWriteTagged(local,
                                             "InputFramework_BeginFrame_State",
                                             TLArg(m_wasActionSetsAttached, "WasActionSetsAttached"),
                                             TLArg(m_needPollEvent, "NeedPollEvent"),
@@ -408,22 +726,20 @@ namespace {
                     // initialization of its action system.
                     if (!m_wasActionSetsAttached &&
                         (!m_frameworkActions.isOpenComposite || m_isInteractionProfileValid)) {
-                        TraceLoggingWriteTagged(local, "InputFramework_BeginFrame_SetupFrameworkActionSet");
-
-                        // Make sure our bindings are complete. We only submit suggestions for the interaction profiles
-                        // in the core spec, and hope runtimes do the right thing for implicit remapping.
-                        const char* coreInteractionProfiles[] = {"/interaction_profiles/khr/simple_controller",
-                                                                 "/interaction_profiles/htc/vive_controller",
-                                                                 "/interaction_profiles/microsoft/motion_controller",
-                                                                 "/interaction_profiles/oculus/touch_controller",
-                                                                 "/interaction_profiles/valve/index_controller"};
-                        for (const auto& interationProfile : coreInteractionProfiles) {
+                        TraceHotPathWriteTagged(local, "InputFramework_BeginFrame_SetupFrameworkActionSet");
+
+                        std::vector<std::string_view> interactionProfiles(std::cbegin(CoreInteractionProfiles),
+                                                                          std::cend(CoreInteractionProfiles));
+                        if (m_frameworkActions.eyeGazeAction != XR_NULL_HANDLE) {
+                            interactionProfiles.push_back(EyeGazeInteractionProfile);
+                        }
+                        for (const auto& interationProfile : interactionProfiles) {
                             XrInteractionProfileSuggestedBinding bindings{
                                 XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING};
-                            CHECK_XRCMD(xrStringToPath(m_instance, interationProfile, &bindings.interactionProfile));
+                            bindings.interactionProfile = m_pathCache.getPath(interationProfile);
                             const XrResult suggestResult = xrSuggestInteractionProfileBindings(m_instance, &bindings);
                             if (XR_FAILED(suggestResult)) {
-                                TraceLoggingWriteTagged(
+                                TraceHotPathWriteTagged(
                                     local,
                                     "InputFramework_BeginFrame_SuggestInteractionProfileBindings_Error",
                                     TLArg(xr::ToString(suggestResult).c_str(), "Result"));
@@ -436,7 +752,7 @@ namespace {
                         XrSessionActionSetsAttachInfo attachInfo{XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO};
                         const XrResult attachResult = xrAttachSessionActionSets_subst(session, &attachInfo);
                         if (XR_FAILED(attachResult)) {
-                            TraceLoggingWriteTagged(local,
+                            TraceHotPathWriteTagged(local,
                                                     "InputFramework_BeginFrame_AttachSessionActionSets_Error",
                                                     TLArg(xr::ToString(attachResult).c_str(), "Result"));
                             ErrorLog(fmt::format("Could not attach framework's actionset for session: {}\n",
@@ -449,49 +765,184 @@ namespace {
                         // If the application does not poll for events, we need to do it ourselves to avoid the
                         // session remaining stuck in the non-focused state (which will make xrSyncActions() fail).
                         if (m_needPollEvent) {
-                            TraceLoggingWriteTagged(local, "InputFramework_BeginFrame_PollEvent");
+                            TraceHotPathWriteTagged(local, "InputFramework_BeginFrame_PollEvent");
 
                             while (true) {
                                 XrEventDataBuffer buf{XR_TYPE_EVENT_DATA_BUFFER};
                                 if (xrPollEvent(m_instance, &buf) != XR_SUCCESS) {
                                     break;
                                 }
+                                if (buf.type == XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED &&
+                                    reinterpret_cast<const XrEventDataInteractionProfileChanged*>(&buf)->session ==
+                                        m_session) {
+                                    invalidateInteractionProfile();
+                                }
                             }
                         }
 
-                        TraceLoggingWriteTagged(local, "InputFramework_BeginFrame_SyncFrameworkActions");
+                        TraceHotPathWriteTagged(local, "InputFramework_BeginFrame_SyncFrameworkActions");
                         XrActionsSyncInfo syncInfo{XR_TYPE_ACTIONS_SYNC_INFO};
                         XrActiveActionSet frameworkActionSet{m_frameworkActions.actionSet, XR_NULL_PATH};
                         syncInfo.activeActionSets = &frameworkActionSet;
                         syncInfo.countActiveActionSets = 1;
                         CHECK_XRCMD(m_forwardDispatch.xrSyncActions(session, &syncInfo));
 
-                        // Dump the interaction profiles for tracing.
-                        XrInteractionProfileState leftState{XR_TYPE_INTERACTION_PROFILE_STATE};
-                        CHECK_XRCMD(xrGetCurrentInteractionProfile(m_session, m_sidePath[xr::Side::Left], &leftState));
-                        XrInteractionProfileState rightState{XR_TYPE_INTERACTION_PROFILE_STATE};
-                        CHECK_XRCMD(
-                            xrGetCurrentInteractionProfile(m_session, m_sidePath[xr::Side::Right], &rightState));
-                        TraceLoggingWriteTagged(local,
-                                                "InputFramework_BeginFrame_CurrentInteractionProfiles",
-                                                TLArg(getXrPath(leftState.interactionProfile).c_str(), "Left"),
-                                                TLArg(getXrPath(rightState.interactionProfile).c_str(), "Right"));
-
-                        m_isInteractionProfileValid = leftState.interactionProfile != XR_NULL_PATH ||
-                                                      rightState.interactionProfile != XR_NULL_PATH;
+                        if (m_isInteractionProfileDirty.exchange(false, std::memory_order_acquire)) {
+                            XrInteractionProfileState leftState{XR_TYPE_INTERACTION_PROFILE_STATE};
+                            CHECK_XRCMD(
+                                xrGetCurrentInteractionProfile(m_session, m_sidePath[xr::Side::Left], &leftState));
+                            XrInteractionProfileState rightState{XR_TYPE_INTERACTION_PROFILE_STATE};
+                            CHECK_XRCMD(
+                                xrGetCurrentInteractionProfile(m_session, m_sidePath[xr::Side::Right], &rightState));
+                            m_currentInteractionProfile[Hands::Left] = leftState.interactionProfile;
+                            m_currentInteractionProfile[Hands::Right] = rightState.interactionProfile;
+
+                            // Dump the interaction profiles for tracing.
+                            TraceHotPathWriteTagged(
+                                local,
+                                "InputFramework_BeginFrame_CurrentInteractionProfiles",
+                                TLArg(m_pathCache.getString(m_currentInteractionProfile[Hands::Left]).c_str(), "Left"),
+                                TLArg(m_pathCache.getString(m_currentInteractionProfile[Hands::Right]).c_str(),
+                                      "Right"));
+                        }
+
+                        m_isInteractionProfileValid = m_currentInteractionProfile[Hands::Left] != XR_NULL_PATH ||
+                                                      m_currentInteractionProfile[Hands::Right] != XR_NULL_PATH;
                     }
                 }
 
                 // We keep track of the current frame time in order to query the tracking information for that frame.
                 m_currentFrameTime = m_waitedFrameTime.front();
                 m_waitedFrameTime.pop_front();
+                {
+                    std::unique_lock snapshotLock(m_snapshotMutex);
+                    m_latchedPoses.isValid = false;
+                }
+
+                if (m_useSnapshot) {
+                    takeActionStateSnapshot();
+                }
             }
 
-            TraceLoggingWriteStop(local, "InputFramework_BeginFrame", TLArg(xr::ToCString(result), "Result"));
+            TraceHotPathWriteStop(local, "InputFramework_BeginFrame", TLArg(xr::ToCString(result), "Result"));
 
             return result;
         }
 
+        void checkMotionControllerSpace(uint32_t side) const {
+            if (side >= Hands::Count) {
+                throw std::runtime_error("Invalid hand");
+            }
+
+            if (m_aimActionSpace[side] == XR_NULL_HANDLE) {
+                throw std::runtime_error(
+                    "Motion controller tracking is not available (did you specify MotionControllerSpatial methods?)");
+            }
+        }
+
+        void checkEyeGazeRequested() const {
+            if (!m_isEyeGazeRequested) {
+                throw std::runtime_error(
+                    "Eye gaze tracking is not available (did you specify the EyeGaze input method and enable the "
+                    "XR_EXT_eye_gaze_interaction extension?)");
+            }
+        }
+
+        XrSpaceLocationFlags
+        locateMotionControllerAt(uint32_t side, XrSpace baseSpace, XrTime time, XrPosef& pose) const {
+            return locateSpaceAt(m_aimActionSpace[side], baseSpace, time, pose);
+        }
+
+        XrSpaceLocationFlags locateSpaceAt(XrSpace space, XrSpace baseSpace, XrTime time, XrPosef& pose) const {
+            // Prevent error before the first frame.
+            if (!time) {
+                return 0;
+            }
+
+            XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+            CHECK_XRCMD(xrLocateSpace(space, baseSpace, time, &location));
+            if (Pose::IsPoseValid(location.locationFlags)) {
+                pose = location.pose;
+            } else {
+                pose = Pose::Identity();
+            }
+
+            return location.locationFlags;
+        }
+
+        XrAction getButtonAction(MotionControllerButton button) const {
+            switch (button) {
+            case MotionControllerButton::Select:
+                return m_frameworkActions.selectAction;
+            case MotionControllerButton::Menu:
+                return m_frameworkActions.menuAction;
+            case MotionControllerButton::Squeeze:
+                return m_frameworkActions.squeezeAction;
+            case MotionControllerButton::ThumbstickClick:
+                return m_frameworkActions.thumbstickClickAction;
+            default:
+                throw std::runtime_error("Invalid button");
+            }
+        }
+
+        // Must be called with m_frameMutex held. The snapshot is built without holding m_snapshotMutex, so that the
+        // queries only wait for it to be published.
+        void takeActionStateSnapshot() {
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "InputFramework_TakeActionStateSnapshot", TLXArg(m_session, "Session"));
+
+            if (m_frameworkActions.actionSet == XR_NULL_HANDLE || !m_wasActionSetsAttached) {
+                std::unique_lock lock(m_snapshotMutex);
+                m_snapshot = {};
+
+                TraceHotPathWriteStop(local, "InputFramework_TakeActionStateSnapshot", TLArg(false, "Valid"));
+                return;
+            }
+
+            ActionStateSnapshot snapshot;
+
+            for (uint32_t side = 0; side < Hands::Count; side++) {
+                XrActionStateGetInfo actionInfo{XR_TYPE_ACTION_STATE_GET_INFO};
+                actionInfo.subactionPath = m_sidePath[side];
+
+                for (uint32_t i = 0; i < MotionControllerButtonCount; i++) {
+                    actionInfo.action = getButtonAction(static_cast<MotionControllerButton>(i));
+                    if (actionInfo.action == XR_NULL_HANDLE) {
+                        continue;
+                    }
+
+                    XrActionStateBoolean state{XR_TYPE_ACTION_STATE_BOOLEAN};
+                    CHECK_XRCMD(xrGetActionStateBoolean(m_session, &actionInfo, &state));
+                    snapshot.buttons[side][i] = state.isActive && state.currentState;
+                }
+
+                if (m_frameworkActions.thumbstickPositionAction != XR_NULL_HANDLE) {
+                    actionInfo.action = m_frameworkActions.thumbstickPositionAction;
+
+                    XrActionStateVector2f state{XR_TYPE_ACTION_STATE_VECTOR2F};
+                    CHECK_XRCMD(xrGetActionStateVector2f(m_session, &actionInfo, &state));
+                    snapshot.thumbsticks[side] = applyThumbstickDeadzone(state);
+                }
+
+                if (m_aimActionSpace[side] != XR_NULL_HANDLE && m_snapshotBaseSpace != XR_NULL_HANDLE) {
+                    XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+                    CHECK_XRCMD(
+                        xrLocateSpace(m_aimActionSpace[side], m_snapshotBaseSpace, m_currentFrameTime, &location));
+                    if (Pose::IsPoseValid(location.locationFlags)) {
+                        snapshot.poses[side] = location.pose;
+                    }
+                    snapshot.locationFlags[side] = location.locationFlags;
+                }
+            }
+            snapshot.isValid = true;
+            {
+                std::unique_lock lock(m_snapshotMutex);
+                m_snapshot = snapshot;
+            }
+
+            TraceHotPathWriteStop(local, "InputFramework_TakeActionStateSnapshot", TLArg(true, "Valid"));
+        }
+
         XrResult xrAttachSessionActionSets_subst(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "InputFramework_AttachSessionActionSets", TLXArg(session, "Session"));
@@ -528,8 +979,8 @@ namespace {
         }
 
         XrResult xrSyncActions_subst(XrSession session, const XrActionsSyncInfo* syncInfo) {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "InputFramework_SyncActions", TLXArg(session, "Session"));
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "InputFramework_SyncActions", TLXArg(session, "Session"));
 
             if (syncInfo->type != XR_TYPE_ACTIONS_SYNC_INFO) {
                 return XR_ERROR_VALIDATION_FAILURE;
@@ -539,55 +990,56 @@ namespace {
             if (!m_blockApplicationInputs) {
                 result = m_forwardDispatch.xrSyncActions(session, syncInfo);
             } else {
-                TraceLoggingWriteTagged(local, "InputFramework_SyncActions_Block");
+                TraceHotPathWriteTagged(local, "InputFramework_SyncActions_Block");
             }
 
-            TraceLoggingWriteStop(local, "InputFramework_SyncActions", TLArg(xr::ToCString(result), "Result"));
+            TraceHotPathWriteStop(local, "InputFramework_SyncActions", TLArg(xr::ToCString(result), "Result"));
 
             return result;
         }
 
-        const std::string getXrPath(XrPath path) {
-            if (path == XR_NULL_PATH) {
-                return "<null>";
-            }
-
-            char buf[XR_MAX_PATH_LENGTH];
-            uint32_t count;
-            CHECK_XRCMD(xrPathToString(m_instance, path, sizeof(buf), &count, buf));
-            std::string str;
-            str.assign(buf, count - 1);
-            return str;
-        }
-
         const XrInstance m_instance;
         const PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr;
         const XrSession m_session;
         const FrameworkActions m_frameworkActions;
         const PFN_xrSuggestInteractionProfileBindings xrSuggestInteractionProfileBindings;
         const ForwardDispatch& m_forwardDispatch;
+        PathCache& m_pathCache;
 
         std::unique_ptr<IInputSessionData> m_sessionData;
 
         bool m_blockApplicationInputs{false};
         XrPath m_sidePath[Hands::Count]{{XR_NULL_PATH}, {XR_NULL_PATH}};
         XrSpace m_aimActionSpace[Hands::Count]{{XR_NULL_HANDLE}, {XR_NULL_HANDLE}};
+        bool m_isEyeGazeRequested{false};
+        XrSpace m_eyeGazeActionSpace{XR_NULL_HANDLE};
         bool m_wasActionSetsAttached{false};
         bool m_needPollEvent{false};
         bool m_isInteractionProfileValid{false};
+        std::atomic<bool> m_isInteractionProfileDirty{true};
+        XrPath m_currentInteractionProfile[Hands::Count]{{XR_NULL_PATH}, {XR_NULL_PATH}};
 
         std::mutex m_frameMutex;
         std::deque<XrTime> m_waitedFrameTime;
         XrTime m_currentFrameTime{0};
 
+        bool m_useSnapshot{false};
+
+        // Guards the snapshot and the latched poses, which are read by the queries from any thread.
+        mutable std::mutex m_snapshotMutex;
+        XrSpace m_snapshotBaseSpace{XR_NULL_HANDLE};
+        ActionStateSnapshot m_snapshot;
+        LatchedPoses m_latchedPoses;
+
         PFN_xrPollEvent xrPollEvent{nullptr};
         PFN_xrGetCurrentInteractionProfile xrGetCurrentInteractionProfile{nullptr};
         PFN_xrLocateSpace xrLocateSpace{nullptr};
         PFN_xrGetActionStateBoolean xrGetActionStateBoolean{nullptr};
         PFN_xrGetActionStateVector2f xrGetActionStateVector2f{nullptr};
         PFN_xrApplyHapticFeedback xrApplyHapticFeedback{nullptr};
-        PFN_xrStringToPath xrStringToPath{nullptr};
-        PFN_xrPathToString xrPathToString{nullptr};
+#ifdef XR_KHR_locate_spaces
+        PFN_xrLocateSpacesKHR xrLocateSpacesKHR{nullptr};
+#endif
     };
 
     struct InputFrameworkFactory : IInputFrameworkFactory {
@@ -596,7 +1048,7 @@ namespace {
                               PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr_,
                               InputMethod methods)
             : m_instanceInfo(instanceInfo), m_instance(instance), xrGetInstanceProcAddr(xrGetInstanceProcAddr_),
-              m_methods(methods) {
+              m_methods(methods), m_pathCache(instance, xrGetInstanceProcAddr_) {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "InputFrameworkFactory_Create", TLArg((int)methods, "InputMethods"));
 
@@ -620,15 +1072,30 @@ namespace {
             }
             m_instanceInfo.enabledExtensionNames = m_instanceExtensionsArray.data();
 
-            CHECK_XRCMD(xrGetInstanceProcAddr(
-                instance, "xrStringToPath", reinterpret_cast<PFN_xrVoidFunction*>(&xrStringToPath)));
-            CHECK_XRCMD(xrGetInstanceProcAddr(
-                instance, "xrPathToString", reinterpret_cast<PFN_xrVoidFunction*>(&xrPathToString)));
+            // Intern the paths used in the frame loop ahead of time.
+            for (const auto& interactionProfile : CoreInteractionProfiles) {
+                m_pathCache.getPath(interactionProfile);
+            }
+
+            // Eye gaze needs the application's instance to have the extension enabled.
+            bool useEyeGaze = false;
+            if ((methods & InputMethod::EyeGaze) == InputMethod::EyeGaze) {
+#ifdef XR_EXT_eye_gaze_interaction
+                useEyeGaze = std::find(m_instanceExtensions.cbegin(),
+                                       m_instanceExtensions.cend(),
+                                       XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME) != m_instanceExtensions.cend();
+#endif
+                TraceLoggingWriteTagged(local, "InputFrameworkFactory_Create_EyeGaze", TLArg(useEyeGaze, "Enabled"));
+                if (!useEyeGaze) {
+                    ErrorLog("Eye gaze was requested but XR_EXT_eye_gaze_interaction is not enabled\n");
+                }
+            }
 
-            // When using motion controllers, create the necessary actions tied to the instance.
+            // When using motion controllers or eye gaze, create the necessary actions tied to the instance.
             if ((methods & InputMethod::MotionControllerSpatial) == InputMethod::MotionControllerSpatial ||
                 (methods & InputMethod::MotionControllerButtons) == InputMethod::MotionControllerButtons ||
-                (methods & InputMethod::MotionControllerHaptics) == InputMethod::MotionControllerHaptics) {
+                (methods & InputMethod::MotionControllerHaptics) == InputMethod::MotionControllerHaptics ||
+                useEyeGaze) {
                 PFN_xrCreateActionSet xrCreateActionSet;
                 CHECK_XRCMD(xrGetInstanceProcAddr(
                     instance, "xrCreateActionSet", reinterpret_cast<PFN_xrVoidFunction*>(&xrCreateActionSet)));
@@ -644,8 +1111,8 @@ namespace {
                 CHECK_XRCMD(xrCreateActionSet(m_instance, &actionSetInfo, &m_frameworkActions.actionSet));
 
                 XrPath subactionPaths[Hands::Count];
-                CHECK_XRCMD(xrStringToPath(m_instance, "/user/hand/left", &subactionPaths[Hands::Left]));
-                CHECK_XRCMD(xrStringToPath(m_instance, "/user/hand/right", &subactionPaths[Hands::Right]));
+                subactionPaths[Hands::Left] = m_pathCache.getPath("/user/hand/left");
+                subactionPaths[Hands::Right] = m_pathCache.getPath("/user/hand/right");
 
                 if ((methods & InputMethod::MotionControllerSpatial) == InputMethod::MotionControllerSpatial) {
                     XrActionCreateInfo actionInfo{XR_TYPE_ACTION_CREATE_INFO};
@@ -721,10 +1188,36 @@ namespace {
                     CHECK_XRCMD(
                         xrCreateAction(m_frameworkActions.actionSet, &actionInfo, &m_frameworkActions.hapticAction));
                 }
+
+                if (useEyeGaze) {
+                    XrActionCreateInfo actionInfo{XR_TYPE_ACTION_CREATE_INFO};
+                    strcpy(actionInfo.actionName, "eye_gaze");
+                    actionInfo.actionType = XR_ACTION_TYPE_POSE_INPUT;
+                    strcpy(actionInfo.localizedActionName, "Eye Gaze");
+                    CHECK_XRCMD(
+                        xrCreateAction(m_frameworkActions.actionSet, &actionInfo, &m_frameworkActions.eyeGazeAction));
+
+                    m_pathCache.getPath(EyeGazeInteractionProfile);
+                    m_pathCache.getPath(EyeGazePosePath);
+                }
             }
 
             // xrCreateSession(), xrDestroySession() and xrSuggestInteractionProfileBindings() function pointers are
             // chained.
+            m_hooks = {
+                {"xrCreateSession", &xrCreateSession, hookCreateSession},
+                {"xrDestroySession", &xrDestroySession, hookDestroySession},
+                {"xrPollEvent", &xrPollEvent, hookPollEvent},
+                {"xrSuggestInteractionProfileBindings",
+                 &xrSuggestInteractionProfileBindings,
+                 hookSuggestInteractionProfileBindings},
+                {"xrWaitFrame", &m_forwardDispatch.xrWaitFrame, hookWaitFrame},
+                {"xrBeginFrame", &m_forwardDispatch.xrBeginFrame, hookBeginFrame},
+                {"xrAttachSessionActionSets",
+                 &m_forwardDispatch.xrAttachSessionActionSets,
+                 hookAttachSessionActionSets},
+                {"xrSyncActions", &m_forwardDispatch.xrSyncActions, hookSyncActions},
+            };
 
             TraceLoggingWriteStop(local, "InputFrameworkFactory_Create", TLPArg(this, "InputFrameworkFactory"));
         }
@@ -757,6 +1250,9 @@ namespace {
                 if (m_frameworkActions.hapticAction != XR_NULL_HANDLE) {
                     xrDestroyAction(m_frameworkActions.hapticAction);
                 }
+                if (m_frameworkActions.eyeGazeAction != XR_NULL_HANDLE) {
+                    xrDestroyAction(m_frameworkActions.eyeGazeAction);
+                }
             }
 
             if (m_frameworkActions.actionSet != XR_NULL_HANDLE) {
@@ -778,59 +1274,38 @@ namespace {
         }
 
         void xrGetInstanceProcAddr_post(XrInstance instance, const char* name, PFN_xrVoidFunction* function) override {
-            const std::string_view functionName(name);
-            if (functionName == "xrCreateSession") {
-                xrCreateSession = reinterpret_cast<PFN_xrCreateSession>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookCreateSession);
-            } else if (functionName == "xrDestroySession") {
-                xrDestroySession = reinterpret_cast<PFN_xrDestroySession>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookDestroySession);
-            } else if (functionName == "xrPollEvent") {
-                xrPollEvent = reinterpret_cast<PFN_xrPollEvent>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookPollEvent);
-            } else if (functionName == "xrSuggestInteractionProfileBindings") {
-                xrSuggestInteractionProfileBindings =
-                    reinterpret_cast<PFN_xrSuggestInteractionProfileBindings>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookSuggestInteractionProfileBindings);
-            } else if (functionName == "xrWaitFrame") {
-                m_forwardDispatch.xrWaitFrame = reinterpret_cast<PFN_xrWaitFrame>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookWaitFrame);
-            } else if (functionName == "xrBeginFrame") {
-                m_forwardDispatch.xrBeginFrame = reinterpret_cast<PFN_xrBeginFrame>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookBeginFrame);
-            } else if (functionName == "xrAttachSessionActionSets") {
-                m_forwardDispatch.xrAttachSessionActionSets =
-                    reinterpret_cast<PFN_xrAttachSessionActionSets>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookAttachSessionActionSets);
-            } else if (functionName == "xrSyncActions") {
-                m_forwardDispatch.xrSyncActions = reinterpret_cast<PFN_xrSyncActions>(*function);
-                *function = reinterpret_cast<PFN_xrVoidFunction>(hookSyncActions);
-            }
+            m_hooks.hook(name, function);
         }
 
         XrResult xrPollEvent_subst(XrInstance instance, XrEventDataBuffer* eventData) {
-            TraceLocalActivity(local);
-            TraceLoggingWriteStart(local, "InputFrameworkFactory_xrPollEvent");
+            TraceHotPathActivity(local);
+            TraceHotPathWriteStart(local, "InputFrameworkFactory_xrPollEvent");
 
             const XrResult result = xrPollEvent(instance, eventData);
             if (XR_SUCCEEDED(result)) {
                 m_needPollEvent = false;
+
+                if (result == XR_SUCCESS && eventData->type == XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED) {
+                    InputFramework* const inputFramework = m_sessions.get(
+                        reinterpret_cast<const XrEventDataInteractionProfileChanged*>(eventData)->session);
+                    if (inputFramework) {
+                        inputFramework->invalidateInteractionProfile();
+                    }
+                }
             }
 
-            TraceLoggingWriteStop(local, "InputFrameworkFactory_xrPollEvent", TLArg(xr::ToCString(result), "Result"));
+            TraceHotPathWriteStop(local, "InputFrameworkFactory_xrPollEvent", TLArg(xr::ToCString(result), "Result"));
 
             return result;
         }
 
         IInputFramework* getInputFramework(XrSession session) override {
-            std::unique_lock lock(m_sessionsMutex);
-
-            auto it = m_sessions.find(session);
-            if (it == m_sessions.end()) {
+            IInputFramework* const framework = m_sessions.get(session);
+            if (!framework) {
                 throw std::runtime_error("No session found");
             }
 
-            return it->second.get();
+            return framework;
         }
 
         XrResult xrCreateSession_subst(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
@@ -839,19 +1314,17 @@ namespace {
 
             const XrResult result = xrCreateSession(instance, createInfo, session);
             if (XR_SUCCEEDED(result)) {
-                std::unique_lock lock(m_sessionsMutex);
-
-                m_sessions.insert_or_assign(
-                    *session,
-                    std::move(std::make_unique<InputFramework>(m_instanceInfo,
-                                                               m_instance,
-                                                               xrGetInstanceProcAddr,
-                                                               *createInfo,
-                                                               *session,
-                                                               m_frameworkActions,
-                                                               hookSuggestInteractionProfileBindings,
-                                                               m_forwardDispatch,
-                                                               m_methods)));
+                m_sessions.insert(*session,
+                                  std::make_unique<InputFramework>(m_instanceInfo,
+                                                                   m_instance,
+                                                                   xrGetInstanceProcAddr,
+                                                                   *createInfo,
+                                                                   *session,
+                                                                   m_frameworkActions,
+                                                                   hookSuggestInteractionProfileBindings,
+                                                                   m_forwardDispatch,
+                                                                   m_pathCache,
+                                                                   m_methods));
             }
 
             TraceLoggingWriteStop(local,
@@ -866,14 +1339,7 @@ namespace {
             TraceLocalActivity(local);
             TraceLoggingWriteStart(local, "InputFrameworkFactory_DestroySession", TLXArg(session, "Session"));
 
-            {
-                std::unique_lock lock(m_sessionsMutex);
-
-                auto it = m_sessions.find(session);
-                if (it != m_sessions.end()) {
-                    m_sessions.erase(it);
-                }
-            }
+            m_sessions.erase(session);
             const XrResult result = xrDestroySession(session);
 
             TraceLoggingWriteStop(
@@ -897,7 +1363,7 @@ namespace {
             std::vector<XrActionSuggestedBinding> updatedBindings(chainSuggestedBindings.suggestedBindings,
                                                                   chainSuggestedBindings.suggestedBindings +
                                                                       chainSuggestedBindings.countSuggestedBindings);
-            const std::string& interationProfile = getXrPath(suggestedBindings->interactionProfile);
+            const std::string& interationProfile = m_pathCache.getString(suggestedBindings->interactionProfile);
             TraceLoggingWriteTagged(local,
                                     "InputFrameworkFactory_SuggestInteractionProfileBindings",
                                     TLArg(interationProfile.c_str(), "InteractionProfile"));
@@ -944,14 +1410,12 @@ namespace {
                 XrPath leftActionPath = XR_NULL_PATH;
                 XrPath rightActionPath = XR_NULL_PATH;
                 if (startsWith(path, "left/")) {
-                    CHECK_XRCMD(
-                        xrStringToPath(m_instance, ("/user/hand/left" + path.substr(4)).c_str(), &leftActionPath));
+                    leftActionPath = m_pathCache.getPath("/user/hand/left" + path.substr(4));
                 } else if (startsWith(path, "right/")) {
-                    CHECK_XRCMD(
-                        xrStringToPath(m_instance, ("/user/hand/right" + path.substr(5)).c_str(), &rightActionPath));
+                    rightActionPath = m_pathCache.getPath("/user/hand/right" + path.substr(5));
                 } else {
-                    CHECK_XRCMD(xrStringToPath(m_instance, ("/user/hand/left" + path).c_str(), &leftActionPath));
-                    CHECK_XRCMD(xrStringToPath(m_instance, ("/user/hand/right" + path).c_str(), &rightActionPath));
+                    leftActionPath = m_pathCache.getPath("/user/hand/left" + path);
+                    rightActionPath = m_pathCache.getPath("/user/hand/right" + path);
                 }
                 if (leftActionPath != XR_NULL_PATH) {
                     TraceLoggingWriteTagged(local,
@@ -990,11 +1454,24 @@ namespace {
             if (capabilities.hasHaptic) {
                 injectLeftRightBinding(m_frameworkActions.hapticAction, "/output/haptic");
             }
+            const bool isEyeGazeInjected =
+                m_frameworkActions.eyeGazeAction != XR_NULL_HANDLE && interationProfile == EyeGazeInteractionProfile;
+            if (isEyeGazeInjected) {
+                TraceLoggingWriteTagged(local,
+                                        "InputFrameworkFactory_SuggestInteractionProfileBindings_Inject",
+                                        TLArg("Eyes", "Side"),
+                                        TLArg(EyeGazePosePath.data(), "ActionPath"));
+                updatedBindings.push_back({m_frameworkActions.eyeGazeAction, m_pathCache.getPath(EyeGazePosePath)});
+            }
 
             chainSuggestedBindings.suggestedBindings = updatedBindings.data();
             chainSuggestedBindings.countSuggestedBindings = static_cast<uint32_t>(updatedBindings.size());
 
             const XrResult result = xrSuggestInteractionProfileBindings(instance, &chainSuggestedBindings);
+            // Retry from xrAttachSessionActionSets() if the runtime did not accept our bindings.
+            if (isEyeGazeInjected && XR_SUCCEEDED(result)) {
+                m_wasEyeGazeProfileSuggested = true;
+            }
 
             TraceLoggingWriteStop(local,
                                   "InputFrameworkFactory_SuggestInteractionProfileBindings",
@@ -1015,6 +1492,18 @@ namespace {
         }
 
         XrResult xrAttachSessionActionSets_subst(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
+            // Applications rarely suggest bindings for eye gaze. Suggest ours before bindings become immutable.
+            if (m_frameworkActions.eyeGazeAction != XR_NULL_HANDLE && !m_wasEyeGazeProfileSuggested) {
+                XrInteractionProfileSuggestedBinding bindings{XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING};
+                bindings.interactionProfile = m_pathCache.getPath(EyeGazeInteractionProfile);
+                const XrResult suggestResult = xrSuggestInteractionProfileBindings_subst(m_instance, &bindings);
+                if (XR_FAILED(suggestResult)) {
+                    ErrorLog(fmt::format("Could not suggest framework's bindings for {}: {}\n",
+                                         EyeGazeInteractionProfile,
+                                         xr::ToCString(suggestResult)));
+                }
+            }
+
             return static_cast<InputFramework*>(getInputFramework(session))
                 ->xrAttachSessionActionSets_subst(session, attachInfo);
         }
@@ -1023,19 +1512,6 @@ namespace {
             return static_cast<InputFramework*>(getInputFramework(session))->xrSyncActions_subst(session, syncInfo);
         }
 
-        const std::string getXrPath(XrPath path) {
-            if (path == XR_NULL_PATH) {
-                return "<null>";
-            }
-
-            char buf[XR_MAX_PATH_LENGTH];
-            uint32_t count;
-            CHECK_XRCMD(xrPathToString(m_instance, path, sizeof(buf), &count, buf));
-            std::string str;
-            str.assign(buf, count - 1);
-            return str;
-        }
-
         const XrInstance m_instance;
         const PFN_xrGetInstanceProcAddr xrGetInstanceProcAddr;
         const InputMethod m_methods;
@@ -1043,8 +1519,8 @@ namespace {
         std::vector<std::string> m_instanceExtensions;
         std::vector<const char*> m_instanceExtensionsArray;
 
-        std::mutex m_sessionsMutex;
-        std::unordered_map<XrSession, std::unique_ptr<InputFramework>> m_sessions;
+        PathCache m_pathCache;
+        SessionRegistry<InputFramework> m_sessions;
 
         FrameworkActions m_frameworkActions;
 
@@ -1052,10 +1528,10 @@ namespace {
         PFN_xrDestroySession xrDestroySession{nullptr};
         PFN_xrPollEvent xrPollEvent{nullptr};
         PFN_xrSuggestInteractionProfileBindings xrSuggestInteractionProfileBindings{nullptr};
-        PFN_xrStringToPath xrStringToPath{nullptr};
-        PFN_xrPathToString xrPathToString{nullptr};
         ForwardDispatch m_forwardDispatch;
+        FunctionHooks m_hooks;
         bool m_needPollEvent{true};
+        bool m_wasEyeGazeProfileSuggested{false};
 
         static inline std::mutex factoryMutex;
         static inline InputFrameworkFactory* factory{nullptr};
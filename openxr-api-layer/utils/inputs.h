@@ -42,6 +42,10 @@ namespace openxr_api_layer::utils::inputs {
 
         // Use the motion controller haptics.
         MotionControllerHaptics = (1 << 2),
+
+        // Use the eye gaze. Requires the XR_EXT_eye_gaze_interaction extension to be enabled on the instance (see
+        // implicitExtensions in layer.cpp).
+        EyeGaze = (1 << 3),
     };
     DEFINE_ENUM_FLAG_OPERATORS(InputMethod);
 
@@ -71,10 +75,24 @@ namespace openxr_api_layer::utils::inputs {
 
         virtual void blockApplicationInput(bool blocked) = 0;
 
+        // The predicted display time of the frame in progress, or 0 before the first frame.
+        virtual XrTime getCurrentFrameTime() const = 0;
+
         // Can only be called if the MotionControllerSpatial input method was requested.
+        // Locate at the predicted display time of the frame in progress.
         virtual XrSpaceLocationFlags locateMotionController(uint32_t side, XrSpace baseSpace, XrPosef& pose) const = 0;
+        virtual XrSpaceLocationFlags
+        locateMotionController(uint32_t side, XrSpace baseSpace, XrTime time, XrPosef& pose) const = 0;
         virtual XrSpace getMotionControllerSpace(uint32_t side) const = 0;
 
+        // Can only be called if the MotionControllerSpatial input method was requested.
+        // Locate both motion controllers at once, at the given time or the predicted display time of the frame in
+        // progress when 0. This is meant to be called as late as possible, typically from the layer's xrEndFrame()
+        // right before composing. Until the next frame begins, locateMotionController() without a time parameter
+        // returns the latched poses for this baseSpace.
+        // Uses XR_KHR_locate_spaces when the application enabled it.
+        virtual void latchMotionControllerPoses(XrSpace baseSpace, XrTime time = 0) = 0;
+
         // Can only be called if the MotionControllerButtons input method was requested.
         virtual bool getMotionControllerButtonState(uint32_t side, MotionControllerButton button) const = 0;
         virtual XrVector2f getMotionControllerThumbstickState(uint32_t side) const = 0;
@@ -82,6 +100,19 @@ namespace openxr_api_layer::utils::inputs {
         // Can only be called if the MotionControllerHaptics input method was requested.
         virtual void pulseMotionControllerHaptics(uint32_t side, float strength) const = 0;
 
+        // Can only be called if the EyeGaze input method was requested.
+        // Returns false if the extension was not enabled or if the system does not support eye gaze interaction.
+        virtual bool isEyeGazeAvailable() const = 0;
+        // Locate at the predicted display time of the frame in progress. The pose is the gaze ray, looking down -Z.
+        virtual XrSpaceLocationFlags locateEyeGaze(XrSpace baseSpace, XrPosef& pose) const = 0;
+        virtual XrSpaceLocationFlags locateEyeGaze(XrSpace baseSpace, XrTime time, XrPosef& pose) const = 0;
+
+        // When enabled, the state of all the framework actions is fetched once per frame, right after the framework
+        // synchronizes its actions in xrBeginFrame(). The getters above then read from that snapshot instead of making
+        // a runtime call each. Motion controller poses are snapshotted relative to baseSpace; locating against a
+        // different space still makes a runtime call.
+        virtual void setActionStateSnapshot(bool enabled, XrSpace baseSpace = XR_NULL_HANDLE) = 0;
+
         template <typename SessionData>
         typename SessionData* getSessionData() const {
             return reinterpret_cast<SessionData*>(getSessionDataPtr());
@@ -0,0 +1,59 @@
+param(
+	[Parameter(Mandatory = $true)][int]$ProcessId,
+	[string]$LayerName = "XR_APILAYER_NOVENDOR_template",
+	[int]$Interval = 0
+)
+
+# Must match the Stage enum and the SharedMetrics layout in framework/metrics.h.
+$Stages = @(
+	"WaitFrame",
+	"WaitToBeginFrame",
+	"BeginFrame",
+	"BeginToEndFrame",
+	"EndFrame",
+	"SerializePreComposition",
+	"SerializePostComposition",
+	"GpuComposition",
+	"InputBeginFrame",
+	"InputQueries",
+	"SwapchainAcquire",
+	"SwapchainRelease"
+)
+$Version = 2
+
+$Mapping = [System.IO.MemoryMappedFiles.MemoryMappedFile]::OpenExisting("Local\$($LayerName)_Metrics_$ProcessId")
+$View = $Mapping.CreateViewAccessor()
+try {
+	do {
+		if ($View.ReadUInt32(0) -ne $Version -or $View.ReadUInt32(4) -ne $Stages.Count) {
+			throw "Unsupported metrics version"
+		}
+
+		# Retry until we read a consistent copy.
+		do {
+			$SequenceBefore = $View.ReadUInt32(8)
+			$FrameCount = $View.ReadUInt64(16)
+			$Rows = for ($i = 0; $i -lt $Stages.Count; $i++) {
+				$Offset = 24 + 16 * $i
+				[PSCustomObject]@{
+					Stage = $Stages[$i]
+					P50 = $View.ReadUInt32($Offset)
+					P99 = $View.ReadUInt32($Offset + 4)
+					Last = $View.ReadUInt32($Offset + 8)
+					Samples = $View.ReadUInt32($Offset + 12)
+				}
+			}
+		} while (($SequenceBefore -band 1) -or $View.ReadUInt32(8) -ne $SequenceBefore)
+
+		Write-Output "Frames: $FrameCount (durations in microseconds)"
+		$Rows | Format-Table -AutoSize | Out-String | Write-Output
+
+		if ($Interval -gt 0) {
+			Start-Sleep -Seconds $Interval
+		}
+	} while ($Interval -gt 0)
+}
+finally {
+	$View.Dispose()
+	$Mapping.Dispose()
+}
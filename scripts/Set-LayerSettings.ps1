@@ -0,0 +1,44 @@
+param(
+	[Parameter(Mandatory = $true)][string]$ApplicationName,
+	[string]$LayerName = "XR_APILAYER_NOVENDOR_template",
+	# Pairs of index and value, eg: @{ 0 = 1.5; 3 = 0.25 }
+	[hashtable]$Values = @{}
+)
+
+# Must match the Settings and SharedSettings layout in framework/settings.h.
+$Version = 2
+$ValueCount = 16
+$Size = 8 + 4 * $ValueCount
+
+$Name = "Local\$($LayerName)_Settings_$($ApplicationName.Replace('\', '_'))"
+$Mapping = [System.IO.MemoryMappedFiles.MemoryMappedFile]::OpenExisting($Name)
+$View = $Mapping.CreateViewAccessor(0, $Size)
+try {
+	if ($View.ReadUInt32(0) -ne $Version) {
+		throw "Unsupported settings version"
+	}
+
+	# An odd sequence tells the layer that the settings are being written.
+	$Sequence = $View.ReadUInt32(4)
+	if ($Sequence -band 1) {
+		throw "Another writer is in progress"
+	}
+	$View.Write(4, [uint32]($Sequence + 1))
+
+	foreach ($Index in $Values.Keys) {
+		if ($Index -lt 0 -or $Index -ge $ValueCount) {
+			throw "Invalid value index $Index"
+		}
+		$View.Write(8 + 4 * $Index, [single]$Values[$Index])
+	}
+
+	$View.Write(4, [uint32]($Sequence + 2))
+
+	for ($i = 0; $i -lt $ValueCount; $i++) {
+		Write-Output "Value[$i]: $($View.ReadSingle(8 + 4 * $i))"
+	}
+}
+finally {
+	$View.Dispose()
+	$Mapping.Dispose()
+}
@@ -0,0 +1,90 @@
+# Compile a JSON description of per-application profiles into the binary database read by the layer.
+# Must match the layout in framework/profiles.h.
+#
+# Usage: compile-profiles.py <profiles.json> <profiles.bin>
+#
+# The JSON file is a list of profiles, matched in order for a given application:
+# [
+#     {
+#         "application": "hello_xr",        // Required, exact match on XrApplicationInfo::applicationName.
+#         "engine": "UnrealEngine",         // Optional, exact match on XrApplicationInfo::engineName.
+#         "minEngineVersion": 0,            // Optional, inclusive.
+#         "maxEngineVersion": 4294967294,   // Optional, inclusive.
+#         "bypass": false,                  // Optional.
+#         "inputFramework": false,          // Optional.
+#         "compositionFramework": false,    // Optional.
+#         "compositionApi": "default"       // Optional, one of "default", "d3d11", "d3d12".
+#     }
+# ]
+
+import json
+import struct
+import sys
+
+MAGIC = 0x504C5258
+VERSION = 2
+ANY = 0xFFFFFFFF
+
+FLAG_BYPASS = 1 << 0
+FLAG_ENABLE_INPUT_FRAMEWORK = 1 << 1
+FLAG_ENABLE_COMPOSITION_FRAMEWORK = 1 << 2
+
+COMPOSITION_APIS = {'default': 0, 'd3d11': 1, 'd3d12': 2}
+
+class StringTable:
+    def __init__(self):
+        self.data = bytearray()
+        self.offsets = {}
+
+    def add(self, string):
+        if string not in self.offsets:
+            self.offsets[string] = len(self.data)
+            self.data += string.encode('utf-8') + b'\0'
+        return self.offsets[string]
+
+def compile_profiles(profiles):
+    strings = StringTable()
+    entries = []
+    for profile in profiles:
+        flags = 0
+        if profile.get('bypass', False):
+            flags |= FLAG_BYPASS
+        if profile.get('inputFramework', False):
+            flags |= FLAG_ENABLE_INPUT_FRAMEWORK
+        if profile.get('compositionFramework', False):
+            flags |= FLAG_ENABLE_COMPOSITION_FRAMEWORK
+
+        composition_api = profile.get('compositionApi', 'default').lower()
+        if composition_api not in COMPOSITION_APIS:
+            raise Exception(f"Invalid compositionApi \"{composition_api}\"")
+
+        application = profile['application']
+        engine = profile.get('engine')
+        entries.append((application.encode('utf-8'), struct.pack('<IIIIII',
+            strings.add(application),
+            strings.add(engine) if engine is not None else ANY,
+            profile.get('minEngineVersion', 0),
+            profile.get('maxEngineVersion', ANY),
+            flags,
+            COMPOSITION_APIS[composition_api])))
+
+    # The layer does a binary search on the application name, comparing bytes. The sort is stable, so that profiles for
+    # the same application are still matched in order.
+    entries.sort(key=lambda entry: entry[0])
+
+    # The string table is never empty.
+    if not strings.data:
+        strings.data += b'\0'
+
+    header = struct.pack('<IIII', MAGIC, VERSION, len(entries), len(strings.data))
+    return header + b''.join(entry[1] for entry in entries) + bytes(strings.data)
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print(f"Usage: {sys.argv[0]} <profiles.json> <profiles.bin>")
+        sys.exit(1)
+
+    with open(sys.argv[1], 'r', encoding='utf-8') as f:
+        profiles = json.load(f)
+    with open(sys.argv[2], 'wb') as f:
+        f.write(compile_profiles(profiles))